@@ -21,13 +21,21 @@
 
 #include <emscripten/bind.h>
 #include <emscripten/val.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <vector>
 #include <memory>
 #include <stdexcept>
-#include <map>
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
+#endif
 
 // Forward declarations for C APIs
 extern "C" {
@@ -35,87 +43,377 @@ extern "C" {
     #include "sonic2.h"
 }
 
-struct SonicStreamWrapper;
-
-// Static map to route callbacks
-static std::map<sonicStream, SonicStreamWrapper*> streamMap;
-static std::mutex streamMapMutex;
-
 // ============================================================================
 // Memory Management Helpers
 // ============================================================================
 
 namespace {
-    // Helper to convert JavaScript TypedArray to std::vector<float>
-    std::vector<float> jsArrayToFloatVector(const emscripten::val& js_array) {
+    // Copy a JavaScript array (typed or not) into a vector, reusing its
+    // storage.  TypedArray.set() does the copy in one call.
+    template <typename T>
+    void jsArrayToVector(const emscripten::val& js_array, std::vector<T>* result) {
+        result->clear();
         if (js_array.isUndefined() || js_array.isNull()) {
-            return std::vector<float>();
+            return;
         }
 
         const auto length = js_array["length"].as<unsigned>();
-        std::vector<float> result;
-        result.reserve(length);
-
-        // Use typed_memory_view for zero-copy access when possible
-        // For embind, we need to iterate through the array
-        for (unsigned i = 0; i < length; ++i) {
-            result.push_back(js_array[i].as<float>());
+        result->resize(length);
+        if (length > 0) {
+            emscripten::val(emscripten::typed_memory_view(length, result->data()))
+                .call<void>("set", js_array);
         }
+    }
 
+    // Helper to convert JavaScript TypedArray to std::vector<float>
+    std::vector<float> jsArrayToFloatVector(const emscripten::val& js_array) {
+        std::vector<float> result;
+        jsArrayToVector(js_array, &result);
         return result;
     }
 
     // Helper to convert JavaScript TypedArray to std::vector<int16_t>
     std::vector<int16_t> jsArrayToInt16Vector(const emscripten::val& js_array) {
-        if (js_array.isUndefined() || js_array.isNull()) {
-            return std::vector<int16_t>();
+        std::vector<int16_t> result;
+        jsArrayToVector(js_array, &result);
+        return result;
+    }
+
+    // Copy count values from WASM memory into a new JavaScript typed array
+    // (Float32Array or Int16Array, by T) in one call.
+    template <typename T>
+    emscripten::val copyToJsArray(const T* data, size_t count) {
+        if (count == 0) {
+            return emscripten::val::undefined();
         }
+        const char* type = sizeof(T) == sizeof(float) ? "Float32Array" : "Int16Array";
+        return emscripten::val::global(type).new_(
+            emscripten::typed_memory_view(count, data));
+    }
 
-        const auto length = js_array["length"].as<unsigned>();
-        std::vector<int16_t> result;
-        result.reserve(length);
+    // Helper to convert std::vector<float> to JavaScript Float32Array
+    emscripten::val floatVectorToJsArray(const std::vector<float>& vec) {
+        return copyToJsArray(vec.data(), vec.size());
+    }
 
-        for (unsigned i = 0; i < length; ++i) {
-            result.push_back(js_array[i].as<int16_t>());
+    // Return a typed array view of a staging buffer.  The cached view is
+    // reused, unless memory growth has detached it (its length drops to 0).
+    template <typename T>
+    emscripten::val stagingView(std::vector<T>& buffer, emscripten::val& view) {
+        if (view.isUndefined() || view["length"].as<size_t>() != buffer.size()) {
+            view = emscripten::val(emscripten::typed_memory_view(buffer.size(),
+                                                                 buffer.data()));
         }
+        return view;
+    }
 
+    // Convert per-stage counters (speedyStats) to a JavaScript object, with
+    // each stage as {ms, calls}.  The 64-bit counts become Numbers.
+    emscripten::val statsToJsObject(const speedyStats& stats, bool enabled) {
+        static const char* const kStageNames[kSpeedyStageCount] = {
+            "preemphasis", "spectrogram", "localEnergy", "hysteresis",
+            "spectralDifference", "tensionToSpeed", "sola"
+        };
+        emscripten::val stages = emscripten::val::object();
+        for (int i = 0; i < kSpeedyStageCount; i++) {
+            emscripten::val stage = emscripten::val::object();
+            stage.set("ms", stats.stage_nanoseconds[i] / 1e6);
+            stage.set("calls", static_cast<double>(stats.stage_calls[i]));
+            stages.set(kStageNames[i], stage);
+        }
+        emscripten::val result = emscripten::val::object();
+        result.set("enabled", enabled);
+        result.set("stages", stages);
+        result.set("skippedFrames", static_cast<double>(stats.skipped_frames));
+        result.set("gatedFrames", static_cast<double>(stats.gated_frames));
+        result.set("missingTensionFrames",
+                   static_cast<double>(stats.missing_tension_frames));
+        result.set("bufferedFramesHighWater", stats.buffered_frames_high_water);
         return result;
     }
+}
 
-    // Helper to convert std::vector<float> to JavaScript Float32Array
-    emscripten::val floatVectorToJsArray(const std::vector<float>& vec) {
-        if (vec.empty()) {
-            return emscripten::val::undefined();
+// ============================================================================
+// Telemetry Ring
+// ============================================================================
+
+/**
+ * Fixed-capacity, lock-free single-producer single-consumer ring of
+ * (frame, tension, speed) records.  The Sonic callbacks produce records on
+ * the thread running the stream; the consumer can be the same thread
+ * (SonicStream.getSpeedProfile) or JavaScript on any thread reading
+ * views of WASM memory (js/speedy-telemetry.js), which are shared when the
+ * module is built with shared memory.  When the ring is full new records
+ * are dropped and counted, so memory stays bounded if nobody polls.
+ */
+struct TelemetryRing {
+    // Header words, laid out for a Uint32Array view (see getTelemetryLayout)
+    enum { kWriteCount, kReadCount, kCapacity, kDropped, kHeaderSize };
+    static constexpr int kRecordSize = 3;   // frame, tension, speed
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                  "The header must look like a Uint32Array to JavaScript");
+    std::atomic<uint32_t> header[kHeaderSize];
+    std::vector<float> records;
+    float pendingTension = 0.0f;    // Tension of the frame whose speed is next
+
+    TelemetryRing() {
+        for (auto& word : header) {
+            word.store(0, std::memory_order_relaxed);
         }
+    }
 
-        // Create a Float32Array of the correct size
-        emscripten::val result = emscripten::val::global("Float32Array").new_(vec.size());
+    // Round the capacity up to a power of two so the counters can wrap.
+    void allocate(uint32_t capacity) {
+        uint32_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        records.assign(rounded * kRecordSize, 0.0f);
+        header[kWriteCount].store(0, std::memory_order_relaxed);
+        header[kReadCount].store(0, std::memory_order_relaxed);
+        header[kDropped].store(0, std::memory_order_relaxed);
+        header[kCapacity].store(rounded, std::memory_order_release);
+    }
 
-        // Copy each element from the vector to the JavaScript array
-        for (size_t i = 0; i < vec.size(); ++i) {
-            result.set(i, vec[i]);
+    uint32_t capacity() const {
+        return header[kCapacity].load(std::memory_order_relaxed);
+    }
+
+    // Producer side
+    void push(int frame, float tension, float speed) {
+        const uint32_t write = header[kWriteCount].load(std::memory_order_relaxed);
+        const uint32_t read = header[kReadCount].load(std::memory_order_acquire);
+        const uint32_t size = capacity();
+        if (write - read >= size) {
+            header[kDropped].fetch_add(1, std::memory_order_relaxed);
+            return;
         }
+        float* record = &records[(write & (size - 1)) * kRecordSize];
+        record[0] = static_cast<float>(frame);
+        record[1] = tension;
+        record[2] = speed;
+        header[kWriteCount].store(write + 1, std::memory_order_release);
+    }
 
-        return result;
+    // Consumer side: append the (frame, speed) pairs of all waiting records.
+    void drainSpeeds(std::vector<float>* output) {
+        const uint32_t write = header[kWriteCount].load(std::memory_order_acquire);
+        uint32_t read = header[kReadCount].load(std::memory_order_relaxed);
+        const uint32_t mask = capacity() - 1;
+        for (; read != write; ++read) {
+            const float* record = &records[(read & mask) * kRecordSize];
+            output->push_back(record[0]);
+            output->push_back(record[2]);
+        }
+        header[kReadCount].store(read, std::memory_order_release);
     }
+};
 
-    // Helper to convert std::vector<int16_t> to JavaScript Int16Array
-    emscripten::val int16VectorToJsArray(const std::vector<int16_t>& vec) {
-        if (vec.empty()) {
-            return emscripten::val::undefined();
+// ============================================================================
+// Input Ring
+// ============================================================================
+
+/**
+ * Fixed-capacity, lock-free single-producer single-consumer ring of
+ * interleaved input samples, laid out like the telemetry ring: a Uint32Array
+ * header (write count, read count, capacity and channel count, the counts in
+ * samples per channel) and the samples.  JavaScript produces, writing straight
+ * into WASM memory (js/speedy-ring.js); SonicStream.pullInputRing() consumes,
+ * handing the samples to Sonic where they lie.  With shared memory the
+ * producer can be on another thread, e.g. a decoder feeding an AudioWorklet.
+ */
+struct InputRing {
+    // Header words, laid out for a Uint32Array view (see getInputRingLayout)
+    enum { kWriteCount, kReadCount, kCapacity, kChannelCount, kHeaderSize };
+
+    std::atomic<uint32_t> header[kHeaderSize];
+    std::vector<float> samples;
+
+    InputRing() {
+        for (auto& word : header) {
+            word.store(0, std::memory_order_relaxed);
         }
+    }
 
-        // Create an Int16Array of the correct size
-        emscripten::val result = emscripten::val::global("Int16Array").new_(vec.size());
+    // Round the capacity up to a power of two so the counters can wrap.
+    void allocate(uint32_t capacity, int channel_count) {
+        uint32_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        samples.assign(static_cast<size_t>(rounded) * channel_count, 0.0f);
+        header[kWriteCount].store(0, std::memory_order_relaxed);
+        header[kReadCount].store(0, std::memory_order_relaxed);
+        header[kChannelCount].store(channel_count, std::memory_order_relaxed);
+        header[kCapacity].store(rounded, std::memory_order_release);
+    }
+
+    uint32_t capacity() const {
+        return header[kCapacity].load(std::memory_order_relaxed);
+    }
 
-        // Copy each element from the vector to the JavaScript array
-        for (size_t i = 0; i < vec.size(); ++i) {
-            result.set(i, vec[i]);
+    // Consumer side: pass up to max_samples waiting samples to consume, in at
+    // most two contiguous spans, then free their space.
+    template <typename Consumer>
+    uint32_t consume(uint32_t max_samples, Consumer consume_span) {
+        const uint32_t write = header[kWriteCount].load(std::memory_order_acquire);
+        const uint32_t read = header[kReadCount].load(std::memory_order_relaxed);
+        const uint32_t size = capacity();
+        const uint32_t channels = header[kChannelCount].load(std::memory_order_relaxed);
+        const uint32_t count = std::min(write - read, max_samples);
+        uint32_t done = 0;
+        while (done < count) {
+            const uint32_t offset = (read + done) & (size - 1);
+            const uint32_t span = std::min(count - done, size - offset);
+            consume_span(&samples[static_cast<size_t>(offset) * channels], span);
+            done += span;
         }
+        header[kReadCount].store(read + done, std::memory_order_release);
+        return done;
+    }
+};
 
-        return result;
+// ============================================================================
+// Analysis Taps
+// ============================================================================
+
+/**
+ * The last frames of analysis, for drawing: each record holds the frame
+ * index, its tension, the kFeatureValueCount features and either the
+ * half-spectrum magnitudes or their average over mel-spaced bands.  Unlike
+ * the telemetry ring nothing is consumed; the stream overwrites the oldest
+ * record and JavaScript reads whichever records it wants through views of
+ * WASM memory (js/speedy-taps.js), using the write count as a cursor.
+ *
+ * The spectrogram of a frame arrives when it is analyzed, but its tension and
+ * features only kTemporalHysteresisFuture frames later, so the spectrograms
+ * wait in a small private ring and each record is published (copied into
+ * place, then counted) once its features arrive.
+ */
+struct TapRing {
+    // Header words, laid out for a Uint32Array view (see getTapLayout)
+    enum { kWriteCount, kCapacity, kRecordSize, kBinCount, kFrameStride,
+           kHeaderSize };
+    static constexpr int kFrameOffset = 0;
+    static constexpr int kTensionOffset = 1;
+    static constexpr int kFeaturesOffset = 2;
+    static constexpr int kBinsOffset = kFeaturesOffset + kFeatureValueCount;
+    // Enough for every frame between its spectrogram and its features.
+    static constexpr int kPendingFrames = 2 * (2 + kTemporalHysteresisFuture);
+
+    std::atomic<uint32_t> header[kHeaderSize];
+    std::vector<float> records;
+    std::vector<float> pending;        // kPendingFrames spectrograms
+    std::vector<int> pendingFrames;    // Frame index of each, or -1
+    std::vector<int> bandEdges;        // bandCount+1 bin edges, if binned
+    int spectrogramBins = 0;           // Half-spectrum bins kept per frame
+    int stride = 1;
+
+    TapRing() {
+        for (auto& word : header) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t capacity() const {
+        return header[kCapacity].load(std::memory_order_relaxed);
+    }
+
+    uint32_t recordSize() const {
+        return header[kRecordSize].load(std::memory_order_relaxed);
+    }
+
+    // Keep capacity records (rounded up to a power of two) of every
+    // frame_stride-th frame, with band_count mel bands (0 for every bin).
+    void allocate(uint32_t capacity, int frame_stride, int band_count,
+                  sonicStream stream) {
+        spectrogramBins = sonicSpeedyFFTSize(stream) / 2 + 1;
+        stride = frame_stride;
+        int bin_count = spectrogramBins;
+        bandEdges.clear();
+        if (band_count > 0) {
+            bin_count = std::min(band_count, spectrogramBins);
+            designBands(bin_count, stream);
+        }
+        uint32_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        const uint32_t record_size = kBinsOffset + bin_count;
+        records.assign(rounded * record_size, 0.0f);
+        pending.assign(kPendingFrames * spectrogramBins, 0.0f);
+        pendingFrames.assign(kPendingFrames, -1);
+        header[kWriteCount].store(0, std::memory_order_relaxed);
+        header[kRecordSize].store(record_size, std::memory_order_relaxed);
+        header[kBinCount].store(bin_count, std::memory_order_relaxed);
+        header[kFrameStride].store(frame_stride, std::memory_order_relaxed);
+        header[kCapacity].store(rounded, std::memory_order_release);
     }
-}
+
+    // Band b averages bins [bandEdges[b], bandEdges[b+1]), mel spaced from 0
+    // to Nyquist, each at least one bin wide.
+    void designBands(int band_count, sonicStream stream) {
+        auto mel = [](float hz) { return 2595.0f * std::log10(1.0f + hz / 700.0f); };
+        const float nyquist = sonicSpeedyBinToFreq(stream, spectrogramBins - 1);
+        const float bin_width = sonicSpeedyBinToFreq(stream, 1);
+        bandEdges.resize(band_count + 1);
+        bandEdges[0] = 0;
+        for (int b = 1; b <= band_count; b++) {
+            float hz = 700.0f * (std::pow(10.0f, mel(nyquist) * b / band_count / 2595.0f) - 1.0f);
+            int edge = static_cast<int>(std::lround(hz / bin_width));
+            // Leave at least one bin for each remaining band.
+            edge = std::max(edge, bandEdges[b - 1] + 1);
+            edge = std::min(edge, spectrogramBins - (band_count - b));
+            bandEdges[b] = edge;
+        }
+        bandEdges[band_count] = spectrogramBins;
+    }
+
+    // Producer side: the spectrogram of a frame, when it is analyzed.
+    void pushSpectrogram(int frame, const float* spectrogram) {
+        if (records.empty() || frame < 0 || frame % stride != 0) {
+            return;
+        }
+        const int slot = frame % kPendingFrames;
+        std::memcpy(&pending[slot * spectrogramBins], spectrogram,
+                    spectrogramBins * sizeof(float));
+        pendingFrames[slot] = frame;
+    }
+
+    // Producer side: the frame's tension and features, which complete it.
+    void publish(int frame, float tension, const float* features) {
+        if (records.empty() || frame < 0 || frame % stride != 0) {
+            return;
+        }
+        const uint32_t write = header[kWriteCount].load(std::memory_order_relaxed);
+        const uint32_t record_size = recordSize();
+        float* record = &records[(write & (capacity() - 1)) * record_size];
+        record[kFrameOffset] = static_cast<float>(frame);
+        record[kTensionOffset] = tension;
+        std::memcpy(&record[kFeaturesOffset], features,
+                    kFeatureValueCount * sizeof(float));
+        const int slot = frame % kPendingFrames;
+        float* bins = &record[kBinsOffset];
+        if (pendingFrames[slot] != frame) {
+            // Analyzed before the taps were set up.
+            std::fill(bins, record + record_size, 0.0f);
+        } else if (bandEdges.empty()) {
+            std::memcpy(bins, &pending[slot * spectrogramBins],
+                        spectrogramBins * sizeof(float));
+        } else {
+            const float* spectrogram = &pending[slot * spectrogramBins];
+            for (size_t b = 0; b + 1 < bandEdges.size(); b++) {
+                float sum = 0.0f;
+                for (int i = bandEdges[b]; i < bandEdges[b + 1]; i++) {
+                    sum += spectrogram[i];
+                }
+                bins[b] = sum / (bandEdges[b + 1] - bandEdges[b]);
+            }
+        }
+        header[kWriteCount].store(write + 1, std::memory_order_release);
+    }
+};
 
 // ============================================================================
 // SpeedyStreamWrapper
@@ -129,6 +427,7 @@ namespace {
  */
 struct SpeedyStreamWrapper {
     speedyStream stream;
+    int batchThreadCount = 1;   // See setThreadCount()
 
     /**
      * Create a new Speedy stream.
@@ -227,6 +526,71 @@ struct SpeedyStreamWrapper {
         return tension;
     }
 
+    /**
+     * Analyze a whole mono signal at once (see speedyComputeTensionBatch).
+     * Frame t starts at sample t*inputFrameStep().  Use a new stream for this.
+     * @param input_array Float32Array containing the whole signal (-1.0 to 1.0)
+     * @return Float32Array with the tension of every frame, or undefined if the
+     *     signal is shorter than one frame
+     * @throws std::runtime_error if out of memory
+     */
+    emscripten::val computeTensionBatch(const emscripten::val& input_array) {
+        auto data = jsArrayToFloatVector(input_array);
+        std::vector<float> tension(speedyBatchFrameCount(stream, data.size()));
+        if (tension.empty()) {
+            return emscripten::val::undefined();
+        }
+        if (!speedyComputeTensionBatch(stream, data.data(), data.size(),
+                                       tension.data(), nullptr,
+                                       batchThreadCount)) {
+            throw std::runtime_error("Failed to compute tensions: out of memory");
+        }
+        return floatVectorToJsArray(tension);
+    }
+
+    /**
+     * Set how many threads computeTensionBatch() splits the per-frame
+     * spectral analysis over.  Single-threaded builds always use one.
+     * Blocking the browser main thread is not allowed, so call
+     * computeTensionBatch() from a worker when using more than one.
+     * @param thread_count Threads to use, e.g. navigator.hardwareConcurrency
+     * @return The number of threads computeTensionBatch() will use
+     */
+    int setThreadCount(int thread_count) {
+#ifdef __EMSCRIPTEN_PTHREADS__
+        batchThreadCount = std::max(1, thread_count);
+#else
+        batchThreadCount = 1;
+#endif
+        return batchThreadCount;
+    }
+
+    /**
+     * Reset the stream for a seek, reusing its allocations (see
+     * speedyResetStream).  The tuning parameters are kept.
+     */
+    void reset() {
+        speedyResetStream(stream, nullptr);
+    }
+
+    /**
+     * Reset the stream, restarting its filters from a saved checkpoint.
+     * @param checkpoint Object returned by getCheckpoint()
+     */
+    void resetWithCheckpoint(const speedyCheckpoint& checkpoint) {
+        speedyResetStream(stream, &checkpoint);
+    }
+
+    /**
+     * Save the slowly changing state of the stream, for a later reset.
+     * @return {energyLp, emphasisWeightedLpf, currentDuration, desiredDuration}
+     */
+    speedyCheckpoint getCheckpoint() {
+        speedyCheckpoint checkpoint;
+        speedyGetCheckpoint(stream, &checkpoint);
+        return checkpoint;
+    }
+
     /**
      * Convert tension to playback speed.
      * @param tension Tension value from computeTension()
@@ -263,6 +627,32 @@ struct SpeedyStreamWrapper {
         speedySetSpeechChangeCapMultiplier(stream, multiplier);
     }
 
+    /**
+     * Set how many frames ahead the analysis looks before computing a
+     * tension: temporalHysteresisFuture() at most (the default), 0 for a
+     * causal analysis.  Set it before adding data.
+     * @param frames Lookahead in frames, clamped to [0, the default]
+     */
+    void setLookahead(int frames) {
+        speedySetLookahead(stream, frames);
+    }
+
+    int getLookahead() {
+        return speedyGetLookahead(stream);
+    }
+
+    /**
+     * Skip the FFT of frames too quiet to count (off by default).  Their
+     * spectrograms are then zeros; tensions change only by rounding.
+     */
+    void setSilenceGate(bool enabled) {
+        speedySetSilenceGate(stream, enabled);
+    }
+
+    bool getSilenceGate() {
+        return speedyGetSilenceGate(stream);
+    }
+
     /**
      * Get the current frame time in the stream.
      * @return Current frame index
@@ -288,23 +678,22 @@ struct SpeedyStreamWrapper {
     }
 
     /**
-     * Get the preemphasis filter coefficient.
-     * @return Preemphasis coefficient (0.97)
+     * Get the preemphasis filter coefficient (see setPreemphasisFactor).
+     * @return Preemphasis coefficient, 0.97 by default
      */
     float preemphasisCoefficient() {
-        return 0.97f;
+        float parameters[kSpeedyTuningParameterCount];
+        speedyGetTuningParameters(stream, parameters);
+        return parameters[0];
     }
 
     /**
-     * Get the temporal hysteresis future frame count.
+     * Get the temporal hysteresis future frame count: the longest (and
+     * default) lookahead.
      * @return Number of future frames for hysteresis
      */
     int temporalHysteresisFuture() {
-#ifdef MATCH_MATLAB
-        return 8;  // kTemporalHysteresisFuture
-#else
-        return 12;  // kTemporalHysteresisFuture
-#endif
+        return kTemporalHysteresisFuture;
     }
 
     /**
@@ -312,11 +701,26 @@ struct SpeedyStreamWrapper {
      * @return Number of past frames for hysteresis
      */
     int temporalHysteresisPast() {
-#ifdef MATCH_MATLAB
-        return 12;  // kTemporalHysteresisPast
-#else
-        return 8;  // kTemporalHysteresisPast
-#endif
+        return kTemporalHysteresisPast;
+    }
+
+    /**
+     * Get the per-stage cost counters of the analysis (see speedyStats).
+     * @return {enabled, stages: {preemphasis: {ms, calls}, ...},
+     *     skippedFrames, ...}; enabled is false, and everything 0, unless
+     *     the module was built with SPEEDY_STATS (make STATS=1)
+     */
+    emscripten::val getStats() {
+        speedyStats stats;
+        bool enabled = speedyGetStats(stream, &stats);
+        return statsToJsObject(stats, enabled);
+    }
+
+    /**
+     * Zero the counters returned by getStats().
+     */
+    void resetStats() {
+        speedyResetStats(stream);
     }
 
     // Prevent copying
@@ -324,6 +728,184 @@ struct SpeedyStreamWrapper {
     SpeedyStreamWrapper& operator=(const SpeedyStreamWrapper&) = delete;
 };
 
+// ============================================================================
+// Async Analysis
+// ============================================================================
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+/**
+ * Speedy analysis on a worker thread, for a SonicStream in tension source
+ * mode (sonicSetTensionSource).  The thread writing the stream pushes the mono
+ * downmix of its input into a lock-free ring; the worker analyzes it frame by
+ * frame and publishes the tensions into a second lock-free ring that the
+ * stream reads while playing.  The writing thread then runs only SOLA, and
+ * never blocks or allocates.
+ *
+ * If the worker falls so far behind that the input ring fills, the samples
+ * that don't fit are dropped and the analysis is abandoned (later frames play
+ * with the average tension) until the next restart.
+ */
+struct AsyncAnalysis {
+    speedyStream stream = nullptr;
+    int frameStep = 0;
+    int frameSize = 0;
+    int bufferedFrames = 0;     // Whole frames before a speedy window is full
+    int baseFrame = 0;          // Stream frame index of tension 0
+
+    // Audio, from the writing thread to the worker
+    std::vector<float> input;
+    std::atomic<uint32_t> inputWrite{0};
+    std::atomic<uint32_t> inputRead{0};
+    std::atomic<uint32_t> droppedSamples{0};
+
+    // Tensions, from the worker to the writing thread, indexed from baseFrame
+    static constexpr uint32_t kTensionCapacity = 128;
+    std::vector<float> tensions = std::vector<float>(kTensionCapacity);
+    std::atomic<uint32_t> tensionWrite{0};
+    std::atomic<uint32_t> tensionRead{0};
+
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+
+    /**
+     * Create the worker's Speedy stream, with the given tuning, lookahead
+     * and silence gate, and an input ring of at least input_capacity mono samples.
+     * @throws std::runtime_error if the stream can't be created
+     */
+    AsyncAnalysis(int sample_rate, const float tuning[kSpeedyTuningParameterCount],
+                  int lookahead, bool silence_gate, uint32_t input_capacity) {
+        stream = speedyCreateStream(sample_rate);
+        if (!stream) {
+            throw std::runtime_error("Failed to create Speedy stream: out of memory");
+        }
+        speedySetTuningParameters(stream, tuning);
+        speedySetLookahead(stream, lookahead);
+        speedySetSilenceGate(stream, silence_gate);
+        frameStep = speedyInputFrameStep(stream);
+        frameSize = speedyInputFrameSize(stream);
+        bufferedFrames = frameSize / frameStep;
+        uint32_t rounded = 1;
+        while (rounded < input_capacity) {
+            rounded <<= 1;
+        }
+        input.assign(rounded, 0.0f);
+    }
+
+    ~AsyncAnalysis() {
+        stop();
+        speedyDestroyStream(stream);
+    }
+
+    /**
+     * Restart the analysis, with the next input sample at the start of
+     * frame_index.  Not real-time safe: it joins and starts the worker.
+     */
+    void start(int frame_index, const speedyCheckpoint* checkpoint) {
+        stop();
+        speedyResetStream(stream, checkpoint);
+        baseFrame = frame_index;
+        inputWrite.store(0, std::memory_order_relaxed);
+        inputRead.store(0, std::memory_order_relaxed);
+        droppedSamples.store(0, std::memory_order_relaxed);
+        tensionWrite.store(0, std::memory_order_relaxed);
+        tensionRead.store(0, std::memory_order_relaxed);
+        stopping.store(false, std::memory_order_relaxed);
+        worker = std::thread(&AsyncAnalysis::run, this);
+    }
+
+    void stop() {
+        if (worker.joinable()) {
+            stopping.store(true, std::memory_order_release);
+            worker.join();
+        }
+    }
+
+    // --- Writing thread ---
+
+    // Push sample_count interleaved samples, averaging the channels.
+    template <typename T>
+    void push(const T* samples, int sample_count, int channel_count, float scale) {
+        const uint32_t write = inputWrite.load(std::memory_order_relaxed);
+        const uint32_t read = inputRead.load(std::memory_order_acquire);
+        if (droppedSamples.load(std::memory_order_relaxed) ||
+            input.size() - (write - read) < static_cast<uint32_t>(sample_count)) {
+            droppedSamples.fetch_add(sample_count, std::memory_order_relaxed);
+            return;
+        }
+        const uint32_t mask = input.size() - 1;
+        const float channel_scale = scale / channel_count;
+        for (int i = 0; i < sample_count; i++) {
+            float sum = 0.0f;
+            for (int k = 0; k < channel_count; k++) {
+                sum += samples[i * channel_count + k];
+            }
+            input[(write + i) & mask] = sum * channel_scale;
+        }
+        inputWrite.store(write + sample_count, std::memory_order_release);
+    }
+
+    // The tension source: 1 and the tension if frame_index has been analyzed.
+    int tensionFor(int frame_index, float* tension) {
+        if (droppedSamples.load(std::memory_order_relaxed)) {
+            *tension = 0.0f;
+            return 1;
+        }
+        const uint32_t frame = frame_index - baseFrame;
+        // Frames before this one are played, so the worker may reuse them.
+        tensionRead.store(frame, std::memory_order_release);
+        if (static_cast<int32_t>(tensionWrite.load(std::memory_order_acquire) - frame) <= 0) {
+            return 0;
+        }
+        *tension = tensions[frame & (kTensionCapacity - 1)];
+        return 1;
+    }
+
+    // --- Worker ---
+
+    // Mirror the frame timing of the synchronous analysis in soniclib.c.
+    // Input is only taken from the ring while there is room for its tension,
+    // so a stalled player fills the ring and push() drops, rather than the
+    // worker buffering without bound.
+    void run() {
+        std::vector<float> frame(frameSize);   // The frame being gathered
+        int filled = 0;
+        int64_t analysis_frame = 0;
+        uint32_t next_tension = 0;
+        const uint32_t mask = input.size() - 1;
+        while (!stopping.load(std::memory_order_acquire)) {
+            bool analyzed = false;
+            while (static_cast<int32_t>(next_tension -
+                                        tensionRead.load(std::memory_order_acquire)) <
+                   static_cast<int32_t>(kTensionCapacity)) {
+                const uint32_t write = inputWrite.load(std::memory_order_acquire);
+                uint32_t read = inputRead.load(std::memory_order_relaxed);
+                for (; read != write && filled < frameSize; ++read) {
+                    frame[filled++] = input[read & mask];
+                }
+                inputRead.store(read, std::memory_order_release);
+                if (filled < frameSize) {
+                    break;
+                }
+                speedyAddData(stream, frame.data(), analysis_frame + bufferedFrames);
+                analysis_frame++;
+                analyzed = true;
+                float tension;
+                if (speedyComputeTension(stream, next_tension, &tension)) {
+                    tensions[next_tension & (kTensionCapacity - 1)] = tension;
+                    tensionWrite.store(++next_tension, std::memory_order_release);
+                }
+                // Keep the overlap with the next frame.
+                std::copy(frame.begin() + frameStep, frame.end(), frame.begin());
+                filled -= frameStep;
+            }
+            if (!analyzed) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+};
+#endif
+
 // ============================================================================
 // SonicStreamWrapper
 // ============================================================================
@@ -339,8 +921,31 @@ struct SonicStreamWrapper {
     int numChannels;
     int sampleRate;
     
-    // Buffer for speed profile
-    std::vector<float> speedProfile;
+    // Per-frame telemetry and analysis taps, filled by the Sonic callbacks
+    TelemetryRing telemetry;
+    TapRing taps;
+    std::vector<float> speedProfile;    // Scratch for getSpeedProfile
+
+    // Input written by JavaScript in place, see setupInputRing()
+    InputRing inputRing;
+
+    // Scratch space reused by the copying read and write calls
+    std::vector<float> floatScratch;
+    std::vector<int16_t> shortScratch;
+
+    // Staging buffers owned by the stream (see setStagingBufferSize), and
+    // their cached Float32Array views
+    std::vector<float> inputStaging;
+    std::vector<float> outputStaging;
+    std::vector<float> planarStaging;   // Deinterleaved output, by channel
+    emscripten::val inputView = emscripten::val::undefined();
+    emscripten::val outputView = emscripten::val::undefined();
+    emscripten::val planarView = emscripten::val::undefined();
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+    // Analysis on a worker thread, see enableAsyncAnalysis()
+    std::unique_ptr<AsyncAnalysis> analysis;
+#endif
 
     /**
      * Create a new Sonic stream.
@@ -354,9 +959,8 @@ struct SonicStreamWrapper {
         if (!stream) {
             throw std::runtime_error("Failed to create Sonic stream: out of memory");
         }
-        
-        std::lock_guard<std::mutex> lock(streamMapMutex);
-        streamMap[stream] = this;
+        // The callbacks reach this wrapper through the stream itself.
+        sonicSetCallbackUserData(stream, this);
     }
 
     /**
@@ -364,9 +968,6 @@ struct SonicStreamWrapper {
      */
     ~SonicStreamWrapper() {
         if (stream) {
-            std::lock_guard<std::mutex> lock(streamMapMutex);
-            streamMap.erase(stream);
-            
             sonicDestroyStream(stream);
             stream = nullptr;
         }
@@ -379,11 +980,11 @@ struct SonicStreamWrapper {
      * @return Number of samples actually written
      */
     int writeFloatToStream(const emscripten::val& input_buffer, int sample_count) {
-        auto data = jsArrayToFloatVector(input_buffer);
-        if (data.empty()) {
+        jsArrayToVector(input_buffer, &floatScratch);
+        if (floatScratch.empty()) {
             return 0;
         }
-        return sonicWriteFloatToStream(stream, data.data(), sample_count);
+        return writeFloat(floatScratch.data(), sample_count);
     }
 
     /**
@@ -394,7 +995,7 @@ struct SonicStreamWrapper {
      */
     int writeFloatToStreamPtr(uintptr_t input_ptr, int sample_count) {
         const float* data = reinterpret_cast<const float*>(input_ptr);
-        return sonicWriteFloatToStream(stream, data, sample_count);
+        return writeFloat(data, sample_count);
     }
 
     /**
@@ -403,19 +1004,17 @@ struct SonicStreamWrapper {
      * @return Float32Array with samples, or undefined if no data available
      */
     emscripten::val readFloatFromStream(int buffer_size) {
-        // Allocate buffer for output (account for channels)
-        std::vector<float> output(buffer_size * numChannels);
+        // Reuse the scratch buffer for output (account for channels)
+        floatScratch.resize(buffer_size * numChannels);
 
-        int samples_read = sonicReadFloatFromStream(stream, output.data(), buffer_size);
+        int samples_read = sonicReadFloatFromStream(stream, floatScratch.data(),
+                                                    buffer_size);
 
         if (samples_read <= 0) {
             return emscripten::val::undefined();
         }
 
-        // Resize to actual samples read
-        output.resize(samples_read * numChannels);
-
-        return floatVectorToJsArray(output);
+        return copyToJsArray(floatScratch.data(), samples_read * numChannels);
     }
 
     /**
@@ -436,11 +1035,17 @@ struct SonicStreamWrapper {
      * @return Number of samples actually written
      */
     int writeShortToStream(const emscripten::val& input_buffer, int sample_count) {
-        auto data = jsArrayToInt16Vector(input_buffer);
-        if (data.empty()) {
+        jsArrayToVector(input_buffer, &shortScratch);
+        if (shortScratch.empty()) {
             return 0;
         }
-        return sonicWriteShortToStream(stream, data.data(), sample_count);
+#ifdef __EMSCRIPTEN_PTHREADS__
+        if (analysis) {
+            analysis->push(shortScratch.data(), sample_count, numChannels,
+                           1.0f / 32768.0f);
+        }
+#endif
+        return sonicWriteShortToStream(stream, shortScratch.data(), sample_count);
     }
 
     /**
@@ -449,17 +1054,179 @@ struct SonicStreamWrapper {
      * @return Int16Array with samples, or undefined if no data available
      */
     emscripten::val readShortFromStream(int buffer_size) {
-        std::vector<int16_t> output(buffer_size * numChannels);
+        shortScratch.resize(buffer_size * numChannels);
 
-        int samples_read = sonicReadShortFromStream(stream, output.data(), buffer_size);
+        int samples_read = sonicReadShortFromStream(stream, shortScratch.data(),
+                                                    buffer_size);
 
         if (samples_read <= 0) {
             return emscripten::val::undefined();
         }
 
-        output.resize(samples_read * numChannels);
+        return copyToJsArray(shortScratch.data(), samples_read * numChannels);
+    }
+
+    // --- Staging Buffers ---
+
+    /**
+     * Allocate the stream's own input and output staging buffers, for I/O
+     * without allocation and without raw pointers.  Fill getInputBuffer() and
+     * call writeInputBuffer(), then call readOutputBuffer() and use the start
+     * of getOutputBuffer().
+     * @param sample_count Capacity of each buffer, in samples per channel
+     * @throws std::runtime_error if sample_count is not positive
+     */
+    void setStagingBufferSize(int sample_count) {
+        if (sample_count <= 0) {
+            throw std::runtime_error("Staging buffer size must be positive");
+        }
+        inputStaging.assign(sample_count * numChannels, 0.0f);
+        outputStaging.assign(sample_count * numChannels, 0.0f);
+        planarStaging.assign(sample_count * numChannels, 0.0f);
+        inputView = emscripten::val::undefined();
+        outputView = emscripten::val::undefined();
+        planarView = emscripten::val::undefined();
+    }
+
+    /**
+     * Get the staging buffer capacity.
+     * @return Samples per channel, 0 until setStagingBufferSize() is called
+     */
+    int stagingBufferSize() {
+        return inputStaging.size() / numChannels;
+    }
+
+    /**
+     * Get a Float32Array view of the input staging buffer (interleaved).
+     * The view is cached, so this is cheap; call it again after any call that
+     * may grow the WASM heap (writes, reads), since growth detaches old views.
+     */
+    emscripten::val getInputBuffer() {
+        return stagingView(inputStaging, inputView);
+    }
+
+    /**
+     * Get a Float32Array view of the output staging buffer (interleaved).
+     * Like getInputBuffer(), fetch it again after each call.
+     */
+    emscripten::val getOutputBuffer() {
+        return stagingView(outputStaging, outputView);
+    }
+
+    /**
+     * Write the first sample_count samples of the input staging buffer.
+     * @param sample_count Number of samples to write (per channel)
+     * @return Number of samples actually written
+     * @throws std::runtime_error if sample_count exceeds the buffer
+     */
+    int writeInputBuffer(int sample_count) {
+        if (sample_count < 0 ||
+            static_cast<size_t>(sample_count) * numChannels > inputStaging.size()) {
+            throw std::runtime_error("Sample count exceeds the staging buffer size");
+        }
+        return writeFloat(inputStaging.data(), sample_count);
+    }
+
+    /**
+     * Read as many samples as fit into the output staging buffer.
+     * @return Number of samples read (per channel)
+     * @throws std::runtime_error if the staging buffers are not allocated
+     */
+    int readOutputBuffer() {
+        if (outputStaging.empty()) {
+            throw std::runtime_error("Call setStagingBufferSize() first");
+        }
+        return sonicReadFloatFromStream(stream, outputStaging.data(),
+                                        outputStaging.size() / numChannels);
+    }
+
+    /**
+     * Get a Float32Array view of the planar output staging buffer: channel c
+     * starts at c * stagingBufferSize().  Like getInputBuffer(), fetch it
+     * again after any call that may grow the WASM heap.
+     */
+    emscripten::val getPlanarOutputBuffer() {
+        return stagingView(planarStaging, planarView);
+    }
+
+    /**
+     * Read up to sample_count samples and deinterleave them into the planar
+     * output staging buffer, so an AudioWorklet can copy each channel to its
+     * output with a single TypedArray.set().
+     * @param sample_count Samples per channel wanted, at most
+     *     stagingBufferSize()
+     * @return Number of samples read (per channel)
+     * @throws std::runtime_error if the staging buffers are not allocated
+     */
+    int readPlanarOutput(int sample_count) {
+        const int capacity = stagingBufferSize();
+        if (capacity == 0) {
+            throw std::runtime_error("Call setStagingBufferSize() first");
+        }
+        sample_count = std::max(0, std::min(sample_count, capacity));
+        if (numChannels == 1) {
+            return std::max(sonicReadFloatFromStream(stream, planarStaging.data(),
+                                                     sample_count), 0);
+        }
+        const int samples_read = sonicReadFloatFromStream(
+            stream, outputStaging.data(), sample_count);
+        for (int c = 0; c < numChannels; c++) {
+            float* plane = &planarStaging[c * capacity];
+            const float* interleaved = &outputStaging[c];
+            for (int i = 0; i < samples_read; i++) {
+                plane[i] = interleaved[i * numChannels];
+            }
+        }
+        return std::max(samples_read, 0);
+    }
+
+    // --- Input Ring ---
+
+    /**
+     * Allocate a ring in WASM memory that JavaScript writes interleaved input
+     * into directly (see js/speedy-ring.js), for pullInputRing() to hand to
+     * Sonic without copies.  Any samples in an earlier ring are dropped.
+     * @param capacity Samples per channel, rounded up to a power of two
+     * @throws std::runtime_error if capacity is not positive
+     */
+    void setupInputRing(int capacity) {
+        if (capacity <= 0) {
+            throw std::runtime_error("Input ring capacity must be positive");
+        }
+        inputRing.allocate(capacity, numChannels);
+    }
 
-        return int16VectorToJsArray(output);
+    /**
+     * Get where the input ring lives in WASM memory.
+     * @return {headerOffset, samplesOffset, capacity, channelCount}: byte
+     *     offsets into the module memory of the Uint32Array header (write
+     *     count, read count, capacity, channel count) and of the Float32Array
+     *     samples
+     */
+    emscripten::val getInputRingLayout() {
+        emscripten::val layout = emscripten::val::object();
+        layout.set("headerOffset", reinterpret_cast<uintptr_t>(inputRing.header));
+        layout.set("samplesOffset", reinterpret_cast<uintptr_t>(inputRing.samples.data()));
+        layout.set("capacity", inputRing.capacity());
+        layout.set("channelCount", numChannels);
+        return layout;
+    }
+
+    /**
+     * Write up to max_samples waiting samples of the input ring to the
+     * stream, straight from the ring.
+     * @param max_samples Samples per channel to take, at most
+     * @return Number of samples written (per channel)
+     * @throws std::runtime_error if the input ring is not allocated
+     */
+    int pullInputRing(int max_samples) {
+        if (inputRing.samples.empty()) {
+            throw std::runtime_error("Call setupInputRing() first");
+        }
+        return inputRing.consume(std::max(max_samples, 0),
+                                 [this](const float* data, uint32_t count) {
+                                     writeFloat(data, count);
+                                 });
     }
 
     /**
@@ -471,6 +1238,43 @@ struct SonicStreamWrapper {
         return sonicFlushStream(stream);
     }
 
+    /**
+     * Seek without recreating the stream.  All buffered input and output is
+     * dropped and the analysis restarts.
+     * @param frame_index Frame (of getSpeedyFrameRate() per second) where the
+     *     next write starts
+     */
+    void seek(int frame_index) {
+        sonicSeekStream(stream, frame_index, nullptr);
+#ifdef __EMSCRIPTEN_PTHREADS__
+        if (analysis) {
+            analysis->start(frame_index, nullptr);
+        }
+#endif
+    }
+
+    /**
+     * Like seek, but restart the Speedy filters from a checkpoint saved with
+     * getSpeedyCheckpoint() when playback last passed this point.
+     */
+    void seekWithCheckpoint(int frame_index, const speedyCheckpoint& checkpoint) {
+        sonicSeekStream(stream, frame_index, &checkpoint);
+#ifdef __EMSCRIPTEN_PTHREADS__
+        if (analysis) {
+            analysis->start(frame_index, &checkpoint);
+        }
+#endif
+    }
+
+    /**
+     * Save the slowly changing Speedy state, for a later seekWithCheckpoint.
+     */
+    speedyCheckpoint getSpeedyCheckpoint() {
+        speedyCheckpoint checkpoint;
+        sonicGetSpeedyCheckpoint(stream, &checkpoint);
+        return checkpoint;
+    }
+
     /**
      * Set the playback speed.
      * Values > 1.0 speed up, values < 1.0 slow down.
@@ -538,6 +1342,184 @@ struct SonicStreamWrapper {
         sonicSetSpeedySpeechChangeCapMultiplier(stream, multiplier);
     }
 
+    /**
+     * Set how many 10 ms frames ahead the Speedy analysis looks, from 0
+     * (causal) to the default getSpeedyTemporalHysteresisFuture().  A shorter
+     * lookahead lowers the latency; the speed then reacts a little later to
+     * coming speech.  Call before writing any data.
+     * @throws std::runtime_error if the stream already has data or frames is
+     *     out of range
+     */
+    void setSpeedyLookahead(int frames) {
+        if (!sonicSetSpeedyLookahead(stream, frames)) {
+            throw std::runtime_error("Failed to set the Speedy lookahead: the "
+                                     "stream already has data or the lookahead "
+                                     "is out of range");
+        }
+    }
+
+    int getSpeedyLookahead() {
+        return sonicGetSpeedyLookahead(stream);
+    }
+
+    /**
+     * Skip the FFT of frames too quiet to count (off by default), which are
+     * most of the pauses in speech.  Tensions change only by rounding, but
+     * the spectrogram taps show these frames as zeros.  Call before writing
+     * any data.
+     */
+    void setSpeedySilenceGate(bool enabled) {
+        sonicSetSpeedySilenceGate(stream, enabled);
+    }
+
+    bool getSpeedySilenceGate() {
+        return sonicGetSpeedySilenceGate(stream);
+    }
+
+    /**
+     * Use the longest lookahead whose latency (see getSpeedyLatency) fits in
+     * seconds, or none if even a causal analysis doesn't fit.  Call after
+     * enableNonlinearSpeedup and before writing any data.
+     * @return The lookahead chosen, in frames
+     * @throws std::runtime_error if the stream already has data
+     */
+    int setSpeedyLatencyBudget(float seconds) {
+        int frames = kTemporalHysteresisFuture;
+        setSpeedyLookahead(frames);
+        while (frames > 0 && sonicGetSpeedyLatency(stream) > seconds * sampleRate) {
+            setSpeedyLookahead(--frames);
+        }
+        return frames;
+    }
+
+    /**
+     * Get how long the input waits in the Speedy shim before SOLA, which is
+     * what the lookahead sets.  It is 0 with linear speedup, so call it after
+     * enableNonlinearSpeedup and the tension track or async settings.
+     * @return Latency in seconds
+     */
+    float getSpeedyLatency() {
+        return sonicGetSpeedyLatency(stream) / static_cast<float>(sampleRate);
+    }
+
+    /**
+     * Play with a precomputed tension track (one value per Speedy frame, e.g.
+     * from SpeedyStream.computeTensionBatch) instead of analyzing the audio.
+     * Speed changes then cost only the SOLA processing.  Call before writing
+     * any data.
+     * @param tension_array Float32Array of per-frame tensions, or null to go
+     *     back to live analysis
+     * @throws std::runtime_error if the stream already has data
+     */
+    void setTensionTrack(const emscripten::val& tension_array) {
+        auto track = jsArrayToFloatVector(tension_array);
+        if (!sonicSetTensionTrack(stream, track.empty() ? nullptr : track.data(),
+                                  track.size())) {
+            throw std::runtime_error("Failed to set tension track: the stream "
+                                     "already has data or is out of memory");
+        }
+    }
+
+    /**
+     * Zero-copy version of setTensionTrack (the track is copied by Sonic).
+     * @param tension_ptr Pointer to float array in WASM memory
+     * @param frame_count Number of frames in the track
+     */
+    void setTensionTrackPtr(uintptr_t tension_ptr, int frame_count) {
+        const float* track = reinterpret_cast<const float*>(tension_ptr);
+        if (!sonicSetTensionTrack(stream, track, frame_count)) {
+            throw std::runtime_error("Failed to set tension track: the stream "
+                                     "already has data or is out of memory");
+        }
+    }
+
+    /**
+     * Analyze a copy of the input decimated to 16 kHz, with a power of two
+     * FFT, instead of the full rate input.  This makes the nonlinear speedup
+     * several times cheaper at 44.1 and 48 kHz, with tensions close to the
+     * full rate ones.  Call before writing any data.  Async analysis, if
+     * enabled, still analyzes the full rate input.
+     * @throws std::runtime_error if the stream already has data
+     */
+    void enableDecimatedAnalysis() {
+        if (!sonicEnableDecimatedAnalysis(stream)) {
+            throw std::runtime_error("Failed to enable decimated analysis: the "
+                                     "stream already has data or is out of memory");
+        }
+    }
+
+    /**
+     * Run the Speedy analysis on a worker thread, so the thread writing this
+     * stream only runs SOLA.  Each frame waits for its tension from the
+     * worker, which adds a little latency.  Set the Speedy tuning, lookahead
+     * and silence gate first (they are copied to the worker) and call this before writing any data, from a
+     * thread that can start threads (not an AudioWorklet).  Needs the
+     * pthreads build.
+     * @param input_seconds How far the worker may fall behind before the
+     *     analysis is abandoned until the next seek
+     * @throws std::runtime_error without pthreads, or if the stream already
+     *     has data
+     */
+    void enableAsyncAnalysis(float input_seconds) {
+#ifdef __EMSCRIPTEN_PTHREADS__
+        if (analysis || !sonicSetTensionSource(stream, asyncTensionSourceStatic)) {
+            throw std::runtime_error("Failed to enable async analysis: the "
+                                     "stream already has data");
+        }
+        float tuning[kSpeedyTuningParameterCount];
+        sonicGetSpeedyTuningParameters(stream, tuning);
+        analysis.reset(new AsyncAnalysis(sampleRate, tuning,
+                                         sonicGetSpeedyLookahead(stream),
+                                         sonicGetSpeedySilenceGate(stream),
+                                         std::max(1.0f, input_seconds * sampleRate)));
+        analysis->start(0, nullptr);
+#else
+        throw std::runtime_error("Async analysis needs the pthreads build");
+#endif
+    }
+
+    /**
+     * Get the progress of the async analysis.
+     * @return {analyzedFrames, droppedSamples}; droppedSamples is not 0 once
+     *     the worker fell too far behind
+     */
+    emscripten::val getAsyncAnalysisStats() {
+        emscripten::val stats = emscripten::val::object();
+#ifdef __EMSCRIPTEN_PTHREADS__
+        if (analysis) {
+            stats.set("analyzedFrames", analysis->tensionWrite.load(std::memory_order_relaxed));
+            stats.set("droppedSamples", analysis->droppedSamples.load(std::memory_order_relaxed));
+            return stats;
+        }
+#endif
+        stats.set("analyzedFrames", 0);
+        stats.set("droppedSamples", 0);
+        return stats;
+    }
+
+    /**
+     * Get the per-stage cost counters: the Speedy analysis stages, the time
+     * in libsonic's SOLA, frames played without a tension and the most
+     * frames waiting in the internal ring.  With async analysis the analysis
+     * runs on the worker and is not counted here.
+     * @return {enabled, stages: {preemphasis: {ms, calls}, ..., sola},
+     *     skippedFrames, missingTensionFrames, bufferedFramesHighWater};
+     *     enabled is false, and everything 0, unless the module was built
+     *     with SPEEDY_STATS (make STATS=1)
+     */
+    emscripten::val getStats() {
+        speedyStats stats;
+        bool enabled = sonicGetSpeedyStats(stream, &stats);
+        return statsToJsObject(stats, enabled);
+    }
+
+    /**
+     * Zero the counters returned by getStats().  Seeks keep them.
+     */
+    void resetStats() {
+        sonicResetSpeedyStats(stream);
+    }
+
     /**
      * Get the number of samples available to read.
      * @return Number of samples available (per channel)
@@ -546,38 +1528,141 @@ struct SonicStreamWrapper {
         return sonicSamplesAvailable(stream);
     }
     
+#ifdef __EMSCRIPTEN_PTHREADS__
+    static int asyncTensionSourceStatic(sonicStream stream, int frame_index, float* tension) {
+        auto* self = static_cast<SonicStreamWrapper*>(sonicGetCallbackUserData(stream));
+        return self->analysis->tensionFor(frame_index, tension);
+    }
+#endif
+
+    // Write float samples, handing a copy to the async analysis if enabled.
+    int writeFloat(const float* data, int sample_count) {
+#ifdef __EMSCRIPTEN_PTHREADS__
+        if (analysis && data) {
+            analysis->push(data, sample_count, numChannels, 1.0f);
+        }
+#endif
+        return sonicWriteFloatToStream(stream, data, sample_count);
+    }
+
     // --- Speed Profile Callback Support ---
 
+    // Each frame's tension callback comes just before its speed callback.
+    static void tensionCallbackStatic(sonicStream stream, int time, float tension) {
+        auto* self = static_cast<SonicStreamWrapper*>(sonicGetCallbackUserData(stream));
+        self->telemetry.pendingTension = tension;
+    }
+
     static void speedCallbackStatic(sonicStream stream, int time, float speed) {
-        std::lock_guard<std::mutex> lock(streamMapMutex);
-        auto it = streamMap.find(stream);
-        if (it != streamMap.end()) {
-            it->second->recordSpeed(time, speed);
-        }
+        auto* self = static_cast<SonicStreamWrapper*>(sonicGetCallbackUserData(stream));
+        self->telemetry.push(time, self->telemetry.pendingTension, speed);
     }
 
-    void recordSpeed(int time, float speed) {
-        // time is frame index. We return (time, speed) pairs flat.
-        speedProfile.push_back(static_cast<float>(time));
-        speedProfile.push_back(speed);
+    static void spectrogramCallbackStatic(sonicStream stream, int time,
+                                          float* spectrogram) {
+        auto* self = static_cast<SonicStreamWrapper*>(sonicGetCallbackUserData(stream));
+        self->taps.pushSpectrogram(time, spectrogram);
     }
 
-    void setupSpeedCallback() {
+    // Each frame's features come just after its tension.
+    static void featuresCallbackStatic(sonicStream stream, int time,
+                                       float* features) {
+        auto* self = static_cast<SonicStreamWrapper*>(sonicGetCallbackUserData(stream));
+        self->taps.publish(time, self->telemetry.pendingTension, features);
+    }
+
+    /**
+     * Start recording (frame, tension, speed) for every frame in a ring of
+     * the given capacity (rounded up to a power of two).  This reallocates
+     * the ring, so fetch the telemetry views again afterwards.
+     * @param capacity Number of records to keep (100 per second of input)
+     */
+    void setupTelemetry(int capacity) {
+        if (capacity <= 0) {
+            throw std::runtime_error("Telemetry capacity must be positive");
+        }
+        telemetry.allocate(capacity);
+        sonicTensionCallback(stream, tensionCallbackStatic);
         sonicSpeedCallback(stream, speedCallbackStatic);
     }
 
+    /**
+     * Enable speed profile tracking, with room for 10 s of frames between
+     * calls to getSpeedProfile().
+     */
+    void setupSpeedCallback() {
+        setupTelemetry(1024);
+    }
+
     /**
      * Get the accumulated speed profile and clear the buffer.
      * Returns a Float32Array where [i] = time (frame index), [i+1] = speed.
      */
     emscripten::val getSpeedProfile() {
-        if (speedProfile.empty()) {
+        if (telemetry.records.empty()) {
             return emscripten::val::undefined();
         }
-
-        emscripten::val result = floatVectorToJsArray(speedProfile);
         speedProfile.clear();
-        return result;
+        telemetry.drainSpeeds(&speedProfile);
+        return floatVectorToJsArray(speedProfile);
+    }
+
+    /**
+     * Get where the telemetry ring lives in WASM memory, so JavaScript can
+     * read it without calling into WASM (see js/speedy-telemetry.js).
+     * @return {headerOffset, recordsOffset, capacity}: byte offsets into the
+     *     module memory of the Uint32Array header (write count, read count,
+     *     capacity, dropped count) and of the Float32Array records
+     */
+    emscripten::val getTelemetryLayout() {
+        emscripten::val layout = emscripten::val::object();
+        layout.set("headerOffset", reinterpret_cast<uintptr_t>(telemetry.header));
+        layout.set("recordsOffset", reinterpret_cast<uintptr_t>(telemetry.records.data()));
+        layout.set("capacity", telemetry.capacity());
+        return layout;
+    }
+
+    /**
+     * Keep the analysis of the last frames (tension, features and spectrogram)
+     * in a ring JavaScript can draw from without copies or calls (see
+     * js/speedy-taps.js).  Only frames analyzed by this stream are recorded,
+     * not those of a tension track or async analysis.  This reallocates the
+     * ring, so fetch the tap views again afterwards.  Set up decimated
+     * analysis, if wanted, first.
+     * @param capacity Number of records to keep (rounded up to a power of two)
+     * @param frame_stride Record every frame_stride-th frame
+     * @param band_count Average the magnitudes over this many mel-spaced
+     *     bands, or 0 for the whole half-spectrum
+     */
+    void setupTaps(int capacity, int frame_stride, int band_count) {
+        if (capacity <= 0 || frame_stride <= 0 || band_count < 0) {
+            throw std::runtime_error("Tap capacity and frame stride must be "
+                                     "positive and band count not negative");
+        }
+        taps.allocate(capacity, frame_stride, band_count, stream);
+        sonicTensionCallback(stream, tensionCallbackStatic);
+        sonicSpectrogramCallback(stream, spectrogramCallbackStatic);
+        sonicFeaturesCallback(stream, featuresCallbackStatic);
+    }
+
+    /**
+     * Get where the tap ring lives in WASM memory.
+     * @return {headerOffset, recordsOffset, capacity, recordSize, binCount,
+     *     featureCount, frameStride}: byte offsets of the Uint32Array header
+     *     (write count, capacity, record size, bin count, frame stride) and
+     *     of the Float32Array records, each [frame, tension, features...,
+     *     bins...]
+     */
+    emscripten::val getTapLayout() {
+        emscripten::val layout = emscripten::val::object();
+        layout.set("headerOffset", reinterpret_cast<uintptr_t>(taps.header));
+        layout.set("recordsOffset", reinterpret_cast<uintptr_t>(taps.records.data()));
+        layout.set("capacity", taps.capacity());
+        layout.set("recordSize", taps.recordSize());
+        layout.set("binCount", taps.header[TapRing::kBinCount].load(std::memory_order_relaxed));
+        layout.set("featureCount", kFeatureValueCount);
+        layout.set("frameStride", taps.stride);
+        return layout;
     }
 
     /**
@@ -589,23 +1674,23 @@ struct SonicStreamWrapper {
     }
 
     /**
-     * Get Speedy preemphasis filter coefficient.
-     * @return Preemphasis coefficient (0.97)
+     * Get Speedy preemphasis filter coefficient (see
+     * setSpeedyPreemphasisFactor).
+     * @return Preemphasis coefficient, 0.97 by default
      */
     float getSpeedyPreemphasisCoefficient() {
-        return 0.97f;
+        float parameters[kSpeedyTuningParameterCount];
+        sonicGetSpeedyTuningParameters(stream, parameters);
+        return parameters[0];
     }
 
     /**
-     * Get Speedy temporal hysteresis future frame count.
+     * Get Speedy temporal hysteresis future frame count, which is the
+     * lookahead (see setSpeedyLookahead).
      * @return Number of future frames for hysteresis
      */
     int getSpeedyTemporalHysteresisFuture() {
-#ifdef MATCH_MATLAB
-        return 8;  // kTemporalHysteresisFuture
-#else
-        return 12;  // kTemporalHysteresisFuture
-#endif
+        return sonicGetSpeedyLookahead(stream);
     }
 
     // Prevent copying
@@ -613,6 +1698,400 @@ struct SonicStreamWrapper {
     SonicStreamWrapper& operator=(const SonicStreamWrapper&) = delete;
 };
 
+// ============================================================================
+// SonicStreamPool
+// ============================================================================
+
+/**
+ * A set of Sonic streams with the same format, processed together.
+ *
+ * The pool owns one contiguous input slab and one output slab, split into a
+ * fixed-size, planar block per stream (one run of samples per channel, as an
+ * AudioWorklet has them), plus Int32Array counts of the samples in each
+ * block.  Fill the input blocks and counts, then call process() once per
+ * quantum: every stream runs in a single call into WASM, instead of two calls
+ * per stream, and the (de)interleaving Sonic needs happens there too.  In a
+ * pthreads build setThreadCount() spreads the streams over worker threads.
+ */
+struct SonicStreamPool {
+    int numChannels;
+    int sampleRate;
+    int quantumSize;        // Input block capacity, samples per channel
+    int outputCapacity;     // Output block capacity, samples per channel
+
+    std::vector<std::unique_ptr<SonicStreamWrapper>> streams;
+    std::vector<float> inputSlab;
+    std::vector<float> outputSlab;
+    std::vector<int32_t> inputCounts;
+    std::vector<int32_t> outputCounts;
+    // Each stream's samples interleaved on their way to and from Sonic; only
+    // used with more than one channel.  A stream is processed by one thread.
+    std::vector<std::vector<float>> interleaved;
+
+    // Cached typed array views of the slabs and counts
+    emscripten::val inputSlabView = emscripten::val::undefined();
+    emscripten::val outputSlabView = emscripten::val::undefined();
+    emscripten::val inputCountsView = emscripten::val::undefined();
+    emscripten::val outputCountsView = emscripten::val::undefined();
+
+    // Next stream for process() to claim, shared by all threads
+    std::atomic<int> nextStream{0};
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+    // Workers sleep until process() bumps the generation, then help claim
+    // streams.  The calling thread works too, then waits for the workers.
+    std::vector<std::thread> workers;
+    std::mutex workMutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    uint64_t generation = 0;
+    int busyWorkers = 0;
+    bool stopping = false;
+#endif
+
+    /**
+     * Create a pool of streams.
+     * @param sample_rate Audio sample rate in Hz, shared by all streams
+     * @param num_channels Number of channels, shared by all streams
+     * @param stream_count Number of streams
+     * @param quantum_size Samples per channel that each stream's input and
+     *     output blocks hold (e.g. 128 for an AudioWorklet)
+     * @throws std::runtime_error if the sizes are not positive or stream
+     *     creation fails
+     */
+    SonicStreamPool(int sample_rate, int num_channels, int stream_count, int quantum_size)
+        : numChannels(num_channels), sampleRate(sample_rate),
+          quantumSize(quantum_size), outputCapacity(quantum_size) {
+        if (num_channels <= 0 || stream_count <= 0 || quantum_size <= 0) {
+            throw std::runtime_error("Pool channel, stream and quantum sizes must be positive");
+        }
+        streams.reserve(stream_count);
+        for (int i = 0; i < stream_count; i++) {
+            streams.emplace_back(new SonicStreamWrapper(sample_rate, num_channels));
+        }
+        inputSlab.assign(static_cast<size_t>(stream_count) * inputStride(), 0.0f);
+        outputSlab.assign(static_cast<size_t>(stream_count) * outputStride(), 0.0f);
+        inputCounts.assign(stream_count, 0);
+        outputCounts.assign(stream_count, 0);
+        interleaved.resize(stream_count);
+        allocateInterleaved();
+    }
+
+    ~SonicStreamPool() {
+        setThreadCount(1);
+    }
+
+    int streamCount() {
+        return streams.size();
+    }
+
+    /**
+     * Floats between the starts of consecutive streams' input blocks.
+     * Channel c of stream i starts at i * inputStride() + c * quantumSize.
+     */
+    int inputStride() {
+        return quantumSize * numChannels;
+    }
+
+    /**
+     * Floats between the starts of consecutive streams' output blocks.
+     * Channel c of stream i starts at i * outputStride() + c * the output
+     * capacity (quantumSize unless setOutputCapacity() changed it).
+     */
+    int outputStride() {
+        return outputCapacity * numChannels;
+    }
+
+    /**
+     * Change how many samples per channel each output block holds.  Output
+     * that doesn't fit stays in its stream until the next process().  Make it
+     * larger than the quantum when slowing down, or to drain faster.
+     * @throws std::runtime_error if sample_count is not positive
+     */
+    void setOutputCapacity(int sample_count) {
+        if (sample_count <= 0) {
+            throw std::runtime_error("Output capacity must be positive");
+        }
+        outputCapacity = sample_count;
+        outputSlab.assign(streams.size() * outputStride(), 0.0f);
+        outputSlabView = emscripten::val::undefined();
+        allocateInterleaved();
+    }
+
+    // --- Slabs ---
+    // Like SonicStream.getInputBuffer(), fetch these views again after any
+    // call that may grow the WASM heap.
+
+    /**
+     * Float32Array of all the planar input blocks; stream i starts at
+     * i * inputStride().
+     */
+    emscripten::val getInputSlab() {
+        return stagingView(inputSlab, inputSlabView);
+    }
+
+    /**
+     * Float32Array of all the planar output blocks; stream i starts at
+     * i * outputStride().
+     */
+    emscripten::val getOutputSlab() {
+        return stagingView(outputSlab, outputSlabView);
+    }
+
+    /**
+     * Int32Array of the samples per channel in each stream's input block.
+     * process() writes them and sets them back to 0.
+     */
+    emscripten::val getInputCounts() {
+        return stagingView(inputCounts, inputCountsView);
+    }
+
+    /**
+     * Int32Array of the samples per channel process() left in each stream's
+     * output block.
+     */
+    emscripten::val getOutputCounts() {
+        return stagingView(outputCounts, outputCountsView);
+    }
+
+    // --- Processing ---
+
+    /**
+     * Use up to thread_count threads, counting the caller, in process().
+     * Single-threaded builds always use one.  Blocking the browser main
+     * thread is not allowed, so call process() from a worker when using more
+     * than one.
+     * @return The number of threads process() will use
+     */
+    int setThreadCount(int thread_count) {
+#ifdef __EMSCRIPTEN_PTHREADS__
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            stopping = true;
+        }
+        workReady.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        stopping = false;
+        const int wanted = std::min<int>(thread_count, streams.size());
+        for (int i = 1; i < wanted; i++) {
+            workers.emplace_back(&SonicStreamPool::workerLoop, this, generation);
+        }
+        return workers.size() + 1;
+#else
+        return 1;
+#endif
+    }
+
+    /**
+     * Write each stream's input block and read as much of its output as fits
+     * into its output block.
+     * @return Total samples per channel read, over all streams
+     * @throws std::runtime_error if an input count exceeds the quantum size
+     */
+    int process() {
+        for (int32_t count : inputCounts) {
+            if (count < 0 || count > quantumSize) {
+                throw std::runtime_error("Input count exceeds the pool quantum size");
+            }
+        }
+        nextStream.store(0, std::memory_order_relaxed);
+#ifdef __EMSCRIPTEN_PTHREADS__
+        if (!workers.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(workMutex);
+                busyWorkers = workers.size();
+                generation++;
+            }
+            workReady.notify_all();
+            processClaimedStreams();
+            std::unique_lock<std::mutex> lock(workMutex);
+            workDone.wait(lock, [this] { return busyWorkers == 0; });
+        } else {
+            processClaimedStreams();
+        }
+#else
+        processClaimedStreams();
+#endif
+        int total = 0;
+        for (int32_t count : outputCounts) {
+            total += count;
+        }
+        return total;
+    }
+
+    // --- Per-Stream Control ---
+    // These mirror the SonicStream methods of the same names, with the stream
+    // index first.
+
+    void setSpeed(int index, float rate) {
+        at(index).setSpeed(rate);
+    }
+
+    float getSpeed(int index) {
+        return at(index).getSpeed();
+    }
+
+    void setRate(int index, float rate) {
+        at(index).setRate(rate);
+    }
+
+    void enableNonlinearSpeedup(int index, float nonlinear_factor) {
+        at(index).enableNonlinearSpeedup(nonlinear_factor);
+    }
+
+    void setDurationFeedbackStrength(int index, float factor) {
+        at(index).setDurationFeedbackStrength(factor);
+    }
+
+    void setTensionTrack(int index, const emscripten::val& tension_array) {
+        at(index).setTensionTrack(tension_array);
+    }
+
+    void enableDecimatedAnalysis(int index) {
+        at(index).enableDecimatedAnalysis();
+    }
+
+    void setSpeedyLookahead(int index, int frames) {
+        at(index).setSpeedyLookahead(frames);
+    }
+
+    void setSpeedySilenceGate(int index, bool enabled) {
+        at(index).setSpeedySilenceGate(enabled);
+    }
+
+    int setSpeedyLatencyBudget(int index, float seconds) {
+        return at(index).setSpeedyLatencyBudget(seconds);
+    }
+
+    float getSpeedyLatency(int index) {
+        return at(index).getSpeedyLatency();
+    }
+
+    void seek(int index, int frame_index) {
+        at(index).seek(frame_index);
+    }
+
+    int flushStream(int index) {
+        return at(index).flushStream();
+    }
+
+    int samplesAvailable(int index) {
+        return at(index).samplesAvailable();
+    }
+
+    void setupTelemetry(int index, int capacity) {
+        at(index).setupTelemetry(capacity);
+    }
+
+    emscripten::val getTelemetryLayout(int index) {
+        return at(index).getTelemetryLayout();
+    }
+
+    void setupTaps(int index, int capacity, int frame_stride, int band_count) {
+        at(index).setupTaps(capacity, frame_stride, band_count);
+    }
+
+    emscripten::val getTapLayout(int index) {
+        return at(index).getTapLayout();
+    }
+
+    emscripten::val getStats(int index) {
+        return at(index).getStats();
+    }
+
+    void resetStats(int index) {
+        at(index).resetStats();
+    }
+
+    // Prevent copying
+    SonicStreamPool(const SonicStreamPool&) = delete;
+    SonicStreamPool& operator=(const SonicStreamPool&) = delete;
+
+private:
+    SonicStreamWrapper& at(int index) {
+        if (index < 0 || index >= static_cast<int>(streams.size())) {
+            throw std::runtime_error("Stream index out of range");
+        }
+        return *streams[index];
+    }
+
+    void allocateInterleaved() {
+        if (numChannels > 1) {
+            const int samples = std::max(quantumSize, outputCapacity);
+            for (auto& buffer : interleaved) {
+                buffer.assign(static_cast<size_t>(samples) * numChannels, 0.0f);
+            }
+        }
+    }
+
+    void processStream(int index) {
+        const int count = inputCounts[index];
+        if (count > 0) {
+            const float* block = &inputSlab[index * inputStride()];
+            if (numChannels == 1) {
+                streams[index]->writeFloat(block, count);
+            } else {
+                float* samples = interleaved[index].data();
+                for (int c = 0; c < numChannels; c++) {
+                    const float* plane = block + c * quantumSize;
+                    for (int i = 0; i < count; i++) {
+                        samples[i * numChannels + c] = plane[i];
+                    }
+                }
+                streams[index]->writeFloat(samples, count);
+            }
+            inputCounts[index] = 0;
+        }
+        float* block = &outputSlab[index * outputStride()];
+        float* samples = numChannels == 1 ? block : interleaved[index].data();
+        const int samples_read = std::max(sonicReadFloatFromStream(
+            streams[index]->stream, samples, outputCapacity), 0);
+        if (numChannels > 1) {
+            for (int c = 0; c < numChannels; c++) {
+                float* plane = block + c * outputCapacity;
+                for (int i = 0; i < samples_read; i++) {
+                    plane[i] = samples[i * numChannels + c];
+                }
+            }
+        }
+        outputCounts[index] = samples_read;
+    }
+
+    void processClaimedStreams() {
+        const int count = streams.size();
+        for (int index = nextStream.fetch_add(1, std::memory_order_relaxed);
+             index < count;
+             index = nextStream.fetch_add(1, std::memory_order_relaxed)) {
+            processStream(index);
+        }
+    }
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+    void workerLoop(uint64_t seen_generation) {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(workMutex);
+                workReady.wait(lock, [&] {
+                    return stopping || generation != seen_generation;
+                });
+                if (stopping) {
+                    return;
+                }
+                seen_generation = generation;
+            }
+            processClaimedStreams();
+            std::lock_guard<std::mutex> lock(workMutex);
+            if (--busyWorkers == 0) {
+                workDone.notify_one();
+            }
+        }
+    }
+#endif
+};
+
 // ============================================================================
 // Emscripten Bindings
 // ============================================================================
@@ -640,6 +2119,14 @@ struct SonicStreamWrapper {
  * ```
  */
 EMSCRIPTEN_BINDINGS(speedy_module) {
+    // Checkpoints are plain JavaScript objects
+    emscripten::value_object<speedyCheckpoint>("SpeedyCheckpoint")
+        .field("energyLp", &speedyCheckpoint::energy_lp)
+        .field("emphasisWeightedLpf", &speedyCheckpoint::emphasis_weighted_lpf)
+        .field("currentDuration", &speedyCheckpoint::current_duration)
+        .field("desiredDuration", &speedyCheckpoint::desired_duration)
+        ;
+
     // Bind SpeedyStreamWrapper as SpeedyStream
     emscripten::class_<SpeedyStreamWrapper>("SpeedyStream")
         .constructor<int>()
@@ -649,19 +2136,30 @@ EMSCRIPTEN_BINDINGS(speedy_module) {
         .function("addDataPtr", &SpeedyStreamWrapper::addDataPtr, emscripten::allow_raw_pointers())
         .function("addDataShort", &SpeedyStreamWrapper::addDataShort)
         .function("computeTension", &SpeedyStreamWrapper::computeTension)
+        .function("computeTensionBatch", &SpeedyStreamWrapper::computeTensionBatch)
+        .function("setThreadCount", &SpeedyStreamWrapper::setThreadCount)
         .function("computeSpeedFromTension", &SpeedyStreamWrapper::computeSpeedFromTension)
+        .function("reset", &SpeedyStreamWrapper::reset)
+        .function("resetWithCheckpoint", &SpeedyStreamWrapper::resetWithCheckpoint)
+        .function("getCheckpoint", &SpeedyStreamWrapper::getCheckpoint)
         .function("getCurrentTime", &SpeedyStreamWrapper::getCurrentTime)
         .function("fftSize", &SpeedyStreamWrapper::fftSize)
         .function("frameRate", &SpeedyStreamWrapper::frameRate)
         .function("preemphasisCoefficient", &SpeedyStreamWrapper::preemphasisCoefficient)
         .function("temporalHysteresisFuture", &SpeedyStreamWrapper::temporalHysteresisFuture)
         .function("temporalHysteresisPast", &SpeedyStreamWrapper::temporalHysteresisPast)
+        .function("getStats", &SpeedyStreamWrapper::getStats)
+        .function("resetStats", &SpeedyStreamWrapper::resetStats)
         .function("setPreemphasisFactor", &SpeedyStreamWrapper::setPreemphasisFactor)
         .function("setLowEnergyThresholdScale", &SpeedyStreamWrapper::setLowEnergyThresholdScale)
         .function("setBinThresholdDivisor", &SpeedyStreamWrapper::setBinThresholdDivisor)
         .function("setTensionWeights", &SpeedyStreamWrapper::setTensionWeights)
         .function("setTensionOffsets", &SpeedyStreamWrapper::setTensionOffsets)
         .function("setSpeechChangeCapMultiplier", &SpeedyStreamWrapper::setSpeechChangeCapMultiplier)
+        .function("setLookahead", &SpeedyStreamWrapper::setLookahead)
+        .function("getLookahead", &SpeedyStreamWrapper::getLookahead)
+        .function("setSilenceGate", &SpeedyStreamWrapper::setSilenceGate)
+        .function("getSilenceGate", &SpeedyStreamWrapper::getSilenceGate)
         ;
 
     // Bind SonicStreamWrapper as SonicStream
@@ -673,7 +2171,21 @@ EMSCRIPTEN_BINDINGS(speedy_module) {
         .function("readFloatFromStreamPtr", &SonicStreamWrapper::readFloatFromStreamPtr, emscripten::allow_raw_pointers())
         .function("writeShortToStream", &SonicStreamWrapper::writeShortToStream)
         .function("readShortFromStream", &SonicStreamWrapper::readShortFromStream)
+        .function("setStagingBufferSize", &SonicStreamWrapper::setStagingBufferSize)
+        .function("stagingBufferSize", &SonicStreamWrapper::stagingBufferSize)
+        .function("getInputBuffer", &SonicStreamWrapper::getInputBuffer)
+        .function("getOutputBuffer", &SonicStreamWrapper::getOutputBuffer)
+        .function("writeInputBuffer", &SonicStreamWrapper::writeInputBuffer)
+        .function("readOutputBuffer", &SonicStreamWrapper::readOutputBuffer)
+        .function("getPlanarOutputBuffer", &SonicStreamWrapper::getPlanarOutputBuffer)
+        .function("readPlanarOutput", &SonicStreamWrapper::readPlanarOutput)
+        .function("setupInputRing", &SonicStreamWrapper::setupInputRing)
+        .function("getInputRingLayout", &SonicStreamWrapper::getInputRingLayout)
+        .function("pullInputRing", &SonicStreamWrapper::pullInputRing)
         .function("flushStream", &SonicStreamWrapper::flushStream)
+        .function("seek", &SonicStreamWrapper::seek)
+        .function("seekWithCheckpoint", &SonicStreamWrapper::seekWithCheckpoint)
+        .function("getSpeedyCheckpoint", &SonicStreamWrapper::getSpeedyCheckpoint)
         .function("setSpeed", &SonicStreamWrapper::setSpeed)
         .function("getSpeed", &SonicStreamWrapper::getSpeed)
         .function("setRate", &SonicStreamWrapper::setRate)
@@ -685,14 +2197,66 @@ EMSCRIPTEN_BINDINGS(speedy_module) {
         .function("setSpeedyTensionWeights", &SonicStreamWrapper::setSpeedyTensionWeights)
         .function("setSpeedyTensionOffsets", &SonicStreamWrapper::setSpeedyTensionOffsets)
         .function("setSpeedySpeechChangeCapMultiplier", &SonicStreamWrapper::setSpeedySpeechChangeCapMultiplier)
+        .function("setSpeedyLookahead", &SonicStreamWrapper::setSpeedyLookahead)
+        .function("getSpeedyLookahead", &SonicStreamWrapper::getSpeedyLookahead)
+        .function("setSpeedySilenceGate", &SonicStreamWrapper::setSpeedySilenceGate)
+        .function("getSpeedySilenceGate", &SonicStreamWrapper::getSpeedySilenceGate)
+        .function("setSpeedyLatencyBudget", &SonicStreamWrapper::setSpeedyLatencyBudget)
+        .function("getSpeedyLatency", &SonicStreamWrapper::getSpeedyLatency)
+        .function("setTensionTrack", &SonicStreamWrapper::setTensionTrack)
+        .function("setTensionTrackPtr", &SonicStreamWrapper::setTensionTrackPtr, emscripten::allow_raw_pointers())
+        .function("enableDecimatedAnalysis", &SonicStreamWrapper::enableDecimatedAnalysis)
+        .function("enableAsyncAnalysis", &SonicStreamWrapper::enableAsyncAnalysis)
+        .function("getAsyncAnalysisStats", &SonicStreamWrapper::getAsyncAnalysisStats)
+        .function("getStats", &SonicStreamWrapper::getStats)
+        .function("resetStats", &SonicStreamWrapper::resetStats)
         .function("samplesAvailable", &SonicStreamWrapper::samplesAvailable)
         .function("setupSpeedCallback", &SonicStreamWrapper::setupSpeedCallback)
+        .function("setupTelemetry", &SonicStreamWrapper::setupTelemetry)
+        .function("getTelemetryLayout", &SonicStreamWrapper::getTelemetryLayout)
+        .function("setupTaps", &SonicStreamWrapper::setupTaps)
+        .function("getTapLayout", &SonicStreamWrapper::getTapLayout)
         .function("getSpeedProfile", &SonicStreamWrapper::getSpeedProfile)
         .function("getSpeedyFrameRate", &SonicStreamWrapper::getSpeedyFrameRate)
         .function("getSpeedyPreemphasisCoefficient", &SonicStreamWrapper::getSpeedyPreemphasisCoefficient)
         .function("getSpeedyTemporalHysteresisFuture", &SonicStreamWrapper::getSpeedyTemporalHysteresisFuture)
         ;
 
+    // Bind SonicStreamPool
+    emscripten::class_<SonicStreamPool>("SonicStreamPool")
+        .constructor<int, int, int, int>()
+        .function("streamCount", &SonicStreamPool::streamCount)
+        .function("inputStride", &SonicStreamPool::inputStride)
+        .function("outputStride", &SonicStreamPool::outputStride)
+        .function("setOutputCapacity", &SonicStreamPool::setOutputCapacity)
+        .function("getInputSlab", &SonicStreamPool::getInputSlab)
+        .function("getOutputSlab", &SonicStreamPool::getOutputSlab)
+        .function("getInputCounts", &SonicStreamPool::getInputCounts)
+        .function("getOutputCounts", &SonicStreamPool::getOutputCounts)
+        .function("setThreadCount", &SonicStreamPool::setThreadCount)
+        .function("process", &SonicStreamPool::process)
+        .function("setSpeed", &SonicStreamPool::setSpeed)
+        .function("getSpeed", &SonicStreamPool::getSpeed)
+        .function("setRate", &SonicStreamPool::setRate)
+        .function("enableNonlinearSpeedup", &SonicStreamPool::enableNonlinearSpeedup)
+        .function("setDurationFeedbackStrength", &SonicStreamPool::setDurationFeedbackStrength)
+        .function("setTensionTrack", &SonicStreamPool::setTensionTrack)
+        .function("enableDecimatedAnalysis", &SonicStreamPool::enableDecimatedAnalysis)
+        .function("setSpeedyLookahead", &SonicStreamPool::setSpeedyLookahead)
+        .function("setSpeedySilenceGate", &SonicStreamPool::setSpeedySilenceGate)
+        .function("setSpeedyLatencyBudget", &SonicStreamPool::setSpeedyLatencyBudget)
+        .function("getSpeedyLatency", &SonicStreamPool::getSpeedyLatency)
+        .function("seek", &SonicStreamPool::seek)
+        .function("flushStream", &SonicStreamPool::flushStream)
+        .function("samplesAvailable", &SonicStreamPool::samplesAvailable)
+        .function("setupTelemetry", &SonicStreamPool::setupTelemetry)
+        .function("getTelemetryLayout", &SonicStreamPool::getTelemetryLayout)
+        .function("setupTaps", &SonicStreamPool::setupTaps)
+        .function("getTapLayout", &SonicStreamPool::getTapLayout)
+        .function("getStats", &SonicStreamPool::getStats)
+        .function("resetStats", &SonicStreamPool::resetStats)
+        ;
+
     // Register std::vector types for return values
     emscripten::register_vector<float>("VectorFloat");
     emscripten::register_vector<int16_t>("VectorInt16");
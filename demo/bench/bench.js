@@ -0,0 +1,146 @@
+import initSpeedy, { supportsSimd, supportsThreads } from '../../dist/speedy-loader.js';
+
+const SAMPLE_RATES = [16000, 22050, 44100, 48000];
+const QUANTUM = 128;            // AudioWorklet render quantum
+const SPEED = 2.0;
+
+const runBtn = document.getElementById('runBtn');
+const audioFile = document.getElementById('audioFile');
+const statusEl = document.getElementById('status');
+const resultsEl = document.getElementById('results');
+
+function log(msg) {
+    statusEl.textContent += '\n' + msg;
+    statusEl.scrollTop = statusEl.scrollHeight;
+}
+
+// Let the page repaint between measurements.
+function yieldToBrowser() {
+    return new Promise(resolve => setTimeout(resolve, 0));
+}
+
+async function loadInput() {
+    const data = audioFile.files.length > 0 ?
+        await audioFile.files[0].arrayBuffer() :
+        await (await fetch('../test_data/tapestry.wav')).arrayBuffer();
+    const context = new AudioContext();
+    try {
+        return await context.decodeAudioData(data);
+    } finally {
+        context.close();
+    }
+}
+
+// Resample to sample_rate with channel_count channels, interleaved.
+async function convert(buffer, sampleRate, channelCount) {
+    const length = Math.ceil(buffer.duration * sampleRate);
+    const context = new OfflineAudioContext(channelCount, length, sampleRate);
+    const source = context.createBufferSource();
+    source.buffer = buffer;
+    source.connect(context.destination);
+    source.start();
+    const rendered = await context.startRendering();
+    const interleaved = new Float32Array(length * channelCount);
+    for (let c = 0; c < channelCount; c++) {
+        const channel = rendered.getChannelData(c);
+        for (let i = 0; i < length; i++) {
+            interleaved[i * channelCount + c] = channel[i];
+        }
+    }
+    return interleaved;
+}
+
+// Time one pass over the input, the way a worklet would drive the stream.
+function timeStream(Module, input, sampleRate, channelCount, nonlinear) {
+    const stream = new Module.SonicStream(sampleRate, channelCount);
+    try {
+        stream.setSpeed(SPEED);
+        stream.enableNonlinearSpeedup(nonlinear ? 1.0 : 0.0);
+        stream.setStagingBufferSize(4 * QUANTUM);
+        const sampleCount = input.length / channelCount;
+        const start = performance.now();
+        for (let t = 0; t < sampleCount; t += QUANTUM) {
+            const count = Math.min(QUANTUM, sampleCount - t);
+            stream.getInputBuffer().set(
+                input.subarray(t * channelCount, (t + count) * channelCount));
+            stream.writeInputBuffer(count);
+            while (stream.readOutputBuffer() > 0) {
+            }
+        }
+        stream.flushStream();
+        while (stream.readOutputBuffer() > 0) {
+        }
+        return (performance.now() - start) / 1000;
+    } finally {
+        stream.delete();
+    }
+}
+
+function addRow(build, sampleRate, channelCount, nonlinear, seconds, audioSeconds) {
+    const frames = audioSeconds * 100;
+    const row = document.createElement('tr');
+    for (const text of [
+        build,
+        sampleRate,
+        channelCount,
+        nonlinear ? 'nonlinear' : 'linear',
+        (audioSeconds / seconds).toFixed(1),
+        (seconds / frames * 1e6).toFixed(1) + ' us',
+    ]) {
+        const cell = document.createElement('td');
+        cell.textContent = text;
+        row.appendChild(cell);
+    }
+    resultsEl.appendChild(row);
+}
+
+async function run() {
+    runBtn.disabled = true;
+    resultsEl.textContent = '';
+    statusEl.textContent = 'Decoding input...';
+    try {
+        const buffer = await loadInput();
+        const inputs = {};
+        for (const sampleRate of SAMPLE_RATES) {
+            for (const channelCount of [1, 2]) {
+                inputs[`${sampleRate}/${channelCount}`] =
+                    await convert(buffer, sampleRate, channelCount);
+            }
+        }
+
+        const builds = [{ name: 'scalar', options: { simd: false } }];
+        if (supportsSimd()) {
+            builds.push({ name: 'simd', options: { simd: true } });
+        }
+        if (supportsThreads()) {
+            builds.push({ name: 'pthreads', options: { threads: true } });
+        } else {
+            log('Skipping the pthreads build: the page is not cross-origin isolated.');
+        }
+
+        for (const build of builds) {
+            log(`Loading the ${build.name} build...`);
+            const Module = await initSpeedy({}, build.options);
+            for (const sampleRate of SAMPLE_RATES) {
+                for (const channelCount of [1, 2]) {
+                    const input = inputs[`${sampleRate}/${channelCount}`];
+                    const audioSeconds = input.length / channelCount / sampleRate;
+                    for (const nonlinear of [false, true]) {
+                        await yieldToBrowser();
+                        const seconds = timeStream(Module, input, sampleRate,
+                                                   channelCount, nonlinear);
+                        addRow(build.name, sampleRate, channelCount, nonlinear,
+                               seconds, audioSeconds);
+                    }
+                }
+            }
+        }
+        log('Done.');
+    } catch (e) {
+        log('Error: ' + e.message);
+    } finally {
+        runBtn.disabled = false;
+    }
+}
+
+runBtn.addEventListener('click', run);
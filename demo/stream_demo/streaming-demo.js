@@ -1,4 +1,5 @@
-import { AudioRingBuffer } from './ring-buffer.js';
+import { SpeedyRingBuffer } from '../../dist/speedy-ring.js';
+import { createTelemetryBuffer, TelemetryReader } from '../../dist/speedy-telemetry.js';
 
 class StreamingDemo {
     constructor() {
@@ -8,6 +9,7 @@ class StreamingDemo {
         this.sourceBuffer = null;
         this.isPlaying = false;
         this.pushInterval = null;
+        this.telemetry = null;
         
         // UI
         this.logEl = document.getElementById('statusLog');
@@ -63,52 +65,48 @@ class StreamingDemo {
         this.log('Initializing AudioWorklet...');
         
         try {
-            await this.context.audioWorklet.addModule('speedy-worklet.js');
-            
+            await this.context.audioWorklet.addModule('../../dist/speedy-worklet.js');
+            // Worklets can't fetch, so compile the module here.
+            const wasmModule = await WebAssembly.compileStreaming(
+                fetch('../../dist/speedy.wasm'));
+
             // Create Ring Buffer (1 second buffer)
-            const capacity = this.context.sampleRate * 1; 
             const channels = 1; // Mono for now (simplifies demo)
-            
-            this.ringBuffer = new AudioRingBuffer(capacity, channels);
-            
+            this.ringBuffer = SpeedyRingBuffer.create(this.context.sampleRate,
+                                                      channels);
+            const telemetry = createTelemetryBuffer(1024);
+            this.telemetry = new TelemetryReader(telemetry.buffer,
+                                                 telemetry.layout);
+
             this.workletNode = new AudioWorkletNode(this.context, 'speedy-processor', {
                 processorOptions: {
-                    ringBuffer: this.ringBuffer.sharedBuffer,
-                    capacity: capacity,
-                    channels: channels
+                    channels: channels,
+                    wasmModule: wasmModule,
+                    ring: { buffer: this.ringBuffer.buffer,
+                            layout: this.ringBuffer.layout },
+                    telemetry: telemetry
                 },
                 outputChannelCount: [channels]
             });
-            
+
             this.workletNode.connect(this.context.destination);
-            
+
             this.workletNode.port.onmessage = (e) => {
                 if (e.data.type === 'ready') {
                     this.log('Worklet Ready!');
                     // Set initial speed
-                    this.workletNode.port.postMessage({ 
-                        type: 'setSpeed', 
-                        payload: parseFloat(this.speedSlider.value) 
+                    this.workletNode.port.postMessage({
+                        type: 'setSpeed',
+                        payload: parseFloat(this.speedSlider.value)
                     });
-                    
+
                     // Enable nonlinear for demo
                     this.workletNode.port.postMessage({ type: 'setNonlinear', payload: 1.0 });
-                } else if (e.data.type === 'speedProfile') {
-                     const profile = e.data.payload;
-                     // Profile is [time1, speed1, time2, speed2...]
-                     // Just show the last one for now to prove it works
-                     if (profile.length >= 2) {
-                         const lastSpeed = profile[profile.length - 1];
-                         const lastTime = profile[profile.length - 2]; // Frame index
-                         // Update a debug element (if exists) or just log occasionally
-                         if (Math.random() < 0.05) { // Throttle logs
-                             // this.log(`Speedy Sync: Frame ${lastTime} -> Speed ${lastSpeed.toFixed(3)}x`);
-                         }
-                         document.getElementById('realtimeSpeed').textContent = lastSpeed.toFixed(3) + 'x';
-                     }
+                } else if (e.data.type === 'error') {
+                    this.log('Worklet Error: ' + e.data.message);
                 }
             };
-            
+
         } catch (e) {
             this.log('Worklet Error: ' + e.message);
             throw e;
@@ -140,31 +138,29 @@ class StreamingDemo {
         const pushLoop = () => {
             if (!this.isPlaying) return;
             
-            // Push as much as we can fit
-            const availableSpace = this.ringBuffer.capacity - this.ringBuffer.available();
-            
             // Keep buffer ~80% full
-            if (this.ringBuffer.available() < this.ringBuffer.capacity * 0.8) {
-                const toWrite = Math.min(chunkSize * 4, rawData.length - offset);
-                
-                if (toWrite > 0) {
-                    const chunk = rawData.subarray(offset, offset + toWrite);
-                    // Wrap in array of channels
-                    const success = this.ringBuffer.write([chunk]);
-                    
-                    if (success) {
-                        offset += toWrite;
-                        if (offset >= rawData.length) {
-                            this.log('End of file reached');
-                            this.stop();
-                            return;
-                        }
-                    }
+            if (this.ringBuffer.available < this.ringBuffer.capacity * 0.8) {
+                const toWrite = Math.min(chunkSize * 4, rawData.length - offset,
+                                         this.ringBuffer.space);
+                offset += this.ringBuffer.write(
+                    [rawData.subarray(offset, offset + toWrite)]);
+                if (offset >= rawData.length) {
+                    this.log('End of file reached');
+                    this.stop();
+                    return;
                 }
             }
-            
+
+            // The speed of the latest frame, from the worklet's telemetry
+            let lastSpeed = null;
+            this.telemetry.read((frame, tension, speed) => { lastSpeed = speed; });
+            if (lastSpeed !== null) {
+                document.getElementById('realtimeSpeed').textContent =
+                    lastSpeed.toFixed(3) + 'x';
+            }
+
             // Update UI Meter
-            const fill = (this.ringBuffer.available() / this.ringBuffer.capacity) * 100;
+            const fill = (this.ringBuffer.available / this.ringBuffer.capacity) * 100;
             this.bufferMeter.style.width = `${fill}%`;
             
             this.pushInterval = requestAnimationFrame(pushLoop);
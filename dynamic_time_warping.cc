@@ -152,3 +152,67 @@ void DynamicTimeWarping::DisplayDebugInformation(
     std::cout << std::endl;
   }
 }
+
+WarpingWindow::WarpingWindow(int height, int width)
+    : width_(width), start_(height, width), end_(height, 0) {}
+
+WarpingWindow WarpingWindow::Band(int height, int width, int radius) {
+  CHECK_GT(height, 0);
+  CHECK_GT(width, 0);
+  CHECK_GE(radius, 0);
+  WarpingWindow window(height, width);
+  for (int i = 0; i < height; ++i) {
+    const int center = height > 1 ?
+        static_cast<int>((static_cast<int64_t>(i) * (width - 1) +
+                          (height - 1) / 2) / (height - 1)) : 0;
+    window.start_[i] = center - radius;
+    window.end_[i] = center + radius + 1;
+  }
+  window.Finish();
+  return window;
+}
+
+WarpingWindow WarpingWindow::AroundCoarsePath(const std::vector<int>& path1,
+                                              const std::vector<int>& path2,
+                                              int height, int width,
+                                              int radius) {
+  CHECK_EQ(path1.size(), path2.size());
+  CHECK_GT(height, 0);
+  CHECK_GT(width, 0);
+  CHECK_GE(radius, 0);
+  WarpingWindow window(height, width);
+  for (std::size_t k = 0; k < path1.size(); ++k) {
+    // Coarse cell (i, j) covers fine rows 2i, 2i+1 and columns 2j, 2j+1.
+    const int first_row = std::max(0, 2 * path1[k] - radius);
+    const int last_row = std::min(height - 1, 2 * path1[k] + 1 + radius);
+    const int start = 2 * path2[k] - radius;
+    const int end = 2 * path2[k] + 2 + radius;
+    for (int i = first_row; i <= last_row; ++i) {
+      window.start_[i] = std::min(window.start_[i], start);
+      window.end_[i] = std::max(window.end_[i], end);
+    }
+  }
+  window.Finish();
+  return window;
+}
+
+void WarpingWindow::Finish() {
+  const int height = start_.size();
+  offset_.resize(height + 1);
+  offset_[0] = 0;
+  for (int i = 0; i < height; ++i) {
+    if (i == 0) {
+      start_[i] = 0;
+    } else {
+      // A path can only enter this row from the previous one.
+      start_[i] = std::min(start_[i], end_[i - 1]);
+      end_[i] = std::max(end_[i], end_[i - 1]);
+    }
+    start_[i] = std::min(std::max(start_[i], 0), width_ - 1);
+    end_[i] = std::min(std::max(end_[i], start_[i] + 1), width_);
+    offset_[i + 1] = offset_[i] + (end_[i] - start_[i]);
+  }
+  end_[height - 1] = width_;
+  offset_[height] = offset_[height - 1] + (end_[height - 1] -
+                                           start_[height - 1]);
+}
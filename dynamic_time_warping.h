@@ -16,8 +16,14 @@
 #define THIRD_PARTY_SPEEDY_DYNAMIC_TIME_WARPING_H_
 
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <utility>
 #include <vector>
 
 // #include "third_party/absl/synchronization/mutex.h"
@@ -118,4 +124,245 @@ class DynamicTimeWarping {
   int ArgMin(float a, float b, float c) const;
 };
 
+// Point distances for BandedDynamicTimeWarping, called with two points of
+// `dimension` contiguous floats.  They keep four partial sums so the loops
+// vectorize without reassociating floating point math.
+struct DtwEuclideanDistance {
+  float operator()(const float* a, const float* b,
+                   std::size_t dimension) const {
+    float sums[4] = {0.f, 0.f, 0.f, 0.f};
+    std::size_t i = 0;
+    for (; i + 4 <= dimension; i += 4) {
+      for (int k = 0; k < 4; ++k) {
+        const float diff = a[i + k] - b[i + k];
+        sums[k] += diff * diff;
+      }
+    }
+    for (; i < dimension; ++i) {
+      const float diff = a[i] - b[i];
+      sums[0] += diff * diff;
+    }
+    return std::sqrt((sums[0] + sums[1]) + (sums[2] + sums[3]));
+  }
+};
+
+// One minus the cosine of the angle between the points: 0 when they point the
+// same way, 1 when orthogonal.  Two zero points are at distance 0, a zero and
+// a non-zero point at distance 1.
+struct DtwCosineDistance {
+  float operator()(const float* a, const float* b,
+                   std::size_t dimension) const {
+    float dots[4] = {0.f, 0.f, 0.f, 0.f};
+    float norms_a[4] = {0.f, 0.f, 0.f, 0.f};
+    float norms_b[4] = {0.f, 0.f, 0.f, 0.f};
+    std::size_t i = 0;
+    for (; i + 4 <= dimension; i += 4) {
+      for (int k = 0; k < 4; ++k) {
+        dots[k] += a[i + k] * b[i + k];
+        norms_a[k] += a[i + k] * a[i + k];
+        norms_b[k] += b[i + k] * b[i + k];
+      }
+    }
+    for (; i < dimension; ++i) {
+      dots[0] += a[i] * b[i];
+      norms_a[0] += a[i] * a[i];
+      norms_b[0] += b[i] * b[i];
+    }
+    const float dot = (dots[0] + dots[1]) + (dots[2] + dots[3]);
+    const float norm_a = (norms_a[0] + norms_a[1]) + (norms_a[2] + norms_a[3]);
+    const float norm_b = (norms_b[0] + norms_b[1]) + (norms_b[2] + norms_b[3]);
+    if (norm_a == 0.f || norm_b == 0.f) {
+      return norm_a == norm_b ? 0.f : 1.f;
+    }
+    return 1.f - dot / std::sqrt(norm_a * norm_b);
+  }
+};
+
+// The cells a constrained warping path may visit: columns [start(i), end(i))
+// of each row i of the height x width cost matrix.  Windows are always
+// connected, so some path from (0, 0) to (height-1, width-1) stays inside.
+class WarpingWindow {
+ public:
+  // A Sakoe-Chiba band: the cells within `radius` columns of the straight line
+  // from (0, 0) to (height-1, width-1), widened where the line is steeper
+  // than the band so consecutive rows overlap.
+  // Dies with a fatal error if a length is not positive or radius is negative.
+  static WarpingWindow Band(int height, int width, int radius);
+
+  // The cells within `radius` cells of a path found at half the resolution
+  // (each coarse point the average of two points), as FastDTW does.
+  // Dies with a fatal error if the paths have different lengths.
+  static WarpingWindow AroundCoarsePath(const std::vector<int>& path1,
+                                        const std::vector<int>& path2,
+                                        int height, int width, int radius);
+
+  int height() const { return static_cast<int>(start_.size()); }
+  int width() const { return width_; }
+  int start(int row) const { return start_[row]; }
+  int end(int row) const { return end_[row]; }
+  // Index of the first cell of the row when the window is stored row by row.
+  std::size_t offset(int row) const { return offset_[row]; }
+  // The number of cells in the window.
+  std::size_t size() const { return offset_.back(); }
+
+ private:
+  WarpingWindow(int height, int width);
+
+  // Clamps the rows to the matrix, makes them overlap and computes offsets.
+  void Finish();
+
+  int width_;
+  std::vector<int> start_;
+  std::vector<int> end_;
+  std::vector<std::size_t> offset_;   // height+1 entries
+};
+
+// Dynamic time warping restricted to a WarpingWindow, for sequences too long
+// for DynamicTimeWarping's full height*width matrices.  Memory is one byte
+// per window cell (for the path) plus two rows of costs, so a Sakoe-Chiba
+// band of radius r needs O((height+width)*r) bytes.  Sequences are
+// contiguous row-major arrays of points, and the point distance is a functor
+// the compiler can inline.  With a window covering the whole matrix, the cost
+// and path match DynamicTimeWarping exactly (it is the reference); narrower
+// windows return the best path inside the window, which may cost more than
+// the optimal one.  Compute and BestPathSequence share state, so use one
+// object per thread.
+template <typename Distance = DtwEuclideanDistance>
+class BandedDynamicTimeWarping {
+ public:
+  explicit BandedDynamicTimeWarping(std::size_t dimension,
+                                    Distance distance = Distance())
+      : dimension_(dimension), distance_(std::move(distance)) {}
+
+  // Returns the cost of the best path within `radius` columns of the diagonal.
+  // `sequence1` has `length1` points of `dimension` floats, one after another,
+  // and likewise `sequence2`.
+  float Compute(const float* sequence1, int length1, const float* sequence2,
+                int length2, int radius) {
+    return ComputeInWindow(sequence1, sequence2,
+                           WarpingWindow::Band(length1, length2, radius));
+  }
+
+  // Returns the cost of the best path found by FastDTW: the path of the
+  // sequences averaged down to half their length (found the same way, down
+  // to `radius`+2 points), refined within `radius` cells of it.  This
+  // follows warps of any slope in O((length1+length2)*radius) time and
+  // memory, but may miss the optimal path.
+  float ComputeMultiscale(const float* sequence1, int length1,
+                          const float* sequence2, int length2, int radius) {
+    const int min_length = radius + 2;
+    if (length1 <= min_length || length2 <= min_length) {
+      return ComputeInWindow(
+          sequence1, sequence2,
+          WarpingWindow::Band(length1, length2, std::max(length1, length2)));
+    }
+    const std::vector<float> coarse1 = Coarsen(sequence1, length1);
+    const std::vector<float> coarse2 = Coarsen(sequence2, length2);
+    const int coarse_length1 = (length1 + 1) / 2;
+    const int coarse_length2 = (length2 + 1) / 2;
+    ComputeMultiscale(coarse1.data(), coarse_length1, coarse2.data(),
+                      coarse_length2, radius);
+    std::vector<int> path1, path2;
+    BestPathSequence(&path1, &path2);
+    return ComputeInWindow(
+        sequence1, sequence2,
+        WarpingWindow::AroundCoarsePath(path1, path2, length1, length2,
+                                        radius));
+  }
+
+  // Returns the cost of the best path inside `window`, whose height and width
+  // are the lengths of the sequences.
+  float ComputeInWindow(const float* sequence1, const float* sequence2,
+                        WarpingWindow window) {
+    window_ = std::move(window);
+    const float kInfinity = std::numeric_limits<float>::infinity();
+    best_directions_.resize(window_.size());
+    previous_row_.resize(window_.width());
+    current_row_.resize(window_.width());
+    for (int i = 0; i < window_.height(); ++i) {
+      const float* point1 = sequence1 + i * dimension_;
+      const int start = window_.start(i);
+      const int end = window_.end(i);
+      const int previous_start = i > 0 ? window_.start(i - 1) : 0;
+      const int previous_end = i > 0 ? window_.end(i - 1) : 0;
+      int8_t* directions = &best_directions_[window_.offset(i)] - start;
+      for (int j = start; j < end; ++j) {
+        const float distance = distance_(point1, sequence2 + j * dimension_,
+                                         dimension_);
+        if (i == 0 && j == 0) {
+          current_row_[0] = distance;
+          directions[0] = 0;
+          continue;
+        }
+        const float up = j >= previous_start && j < previous_end ?
+            previous_row_[j] : kInfinity;
+        const float diagonal = j > previous_start && j <= previous_end ?
+            previous_row_[j - 1] : kInfinity;
+        const float left = j > start ? current_row_[j - 1] : kInfinity;
+        // Same order and ties as DynamicTimeWarping::ArgMin.
+        if (up < diagonal && up < left) {
+          current_row_[j] = distance + up;
+          directions[j] = -1;
+        } else if (left < up && left < diagonal) {
+          current_row_[j] = distance + left;
+          directions[j] = 1;
+        } else {
+          current_row_[j] = distance + std::min(diagonal, std::min(up, left));
+          directions[j] = 0;
+        }
+      }
+      std::swap(previous_row_, current_row_);
+    }
+    return previous_row_[window_.width() - 1];
+  }
+
+  // Appends the best path found by the last Compute call to path1 and path2,
+  // like DynamicTimeWarping::BestPathSequence.
+  void BestPathSequence(std::vector<int>* path1,
+                        std::vector<int>* path2) const {
+    assert(path1 != nullptr && path2 != nullptr);
+    const std::size_t first = path1->size();
+    for (int i = window_.height() - 1, j = window_.width() - 1;
+         i >= 0 && j >= 0;) {
+      assert(j >= window_.start(i) && j < window_.end(i));
+      const int direction =
+          best_directions_[window_.offset(i) + j - window_.start(i)];
+      path1->push_back(i);
+      path2->push_back(j);
+      if (direction <= 0) --i;
+      if (direction >= 0) --j;
+    }
+    std::reverse(path1->begin() + first, path1->end());
+    std::reverse(path2->begin() + first, path2->end());
+  }
+
+  // The window used by the last Compute call.
+  const WarpingWindow& window() const { return window_; }
+
+ private:
+  // Averages pairs of points; an odd last point is kept as is.
+  std::vector<float> Coarsen(const float* sequence, int length) const {
+    std::vector<float> coarse(((length + 1) / 2) * dimension_);
+    for (int i = 0; i < length / 2; ++i) {
+      for (std::size_t k = 0; k < dimension_; ++k) {
+        coarse[i * dimension_ + k] = 0.5f * (sequence[2 * i * dimension_ + k] +
+            sequence[(2 * i + 1) * dimension_ + k]);
+      }
+    }
+    if (length % 2) {
+      std::copy(sequence + (length - 1) * dimension_,
+                sequence + length * dimension_,
+                coarse.end() - dimension_);
+    }
+    return coarse;
+  }
+
+  const std::size_t dimension_;
+  const Distance distance_;
+  WarpingWindow window_ = WarpingWindow::Band(1, 1, 0);
+  std::vector<int8_t> best_directions_;   // -1 up, 0 diagonal, 1 left
+  std::vector<float> previous_row_;       // Accumulated costs, by column
+  std::vector<float> current_row_;
+};
+
 #endif  // THIRD_PARTY_SPEEDY_DYNAMIC_TIME_WARPING_H_
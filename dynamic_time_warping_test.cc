@@ -78,6 +78,105 @@ TEST(DynamicTimeWarpingTest, DownsampledSequence) {
   EXPECT_EQ(path1, expected1);
   EXPECT_EQ(path2, expected2);
 }
+
+// Two-dimensional points along a curve, sampled `length` times.
+std::vector<std::vector<float>> Curve(int length, float phase) {
+  std::vector<std::vector<float>> points;
+  for (int i = 0; i < length; ++i) {
+    const float t = 6.f * i / length + phase;
+    points.push_back({std::sin(t) + 0.3f * std::sin(5.f * t),
+                      std::cos(0.7f * t)});
+  }
+  return points;
+}
+
+std::vector<float> Flatten(const std::vector<std::vector<float>>& sequence) {
+  std::vector<float> flat;
+  for (const auto& point : sequence) {
+    flat.insert(flat.end(), point.begin(), point.end());
+  }
+  return flat;
+}
+
+float EuclideanDistance(const std::vector<float>& sequence1,
+                        const std::vector<float>& sequence2) {
+  return DtwEuclideanDistance()(sequence1.data(), sequence2.data(),
+                                sequence1.size());
+}
+
+TEST(DynamicTimeWarpingTest, DistanceFunctors) {
+  const float a[5] = {1.f, 2.f, 3.f, 4.f, 5.f};
+  const float b[5] = {1.f, 2.f, 3.f, 4.f, 2.f};
+  const float c[5] = {2.f, 4.f, 6.f, 8.f, 10.f};
+  const float zero[5] = {0.f, 0.f, 0.f, 0.f, 0.f};
+  EXPECT_FLOAT_EQ(DtwEuclideanDistance()(a, b, 5), 3.f);
+  EXPECT_FLOAT_EQ(DtwEuclideanDistance()(a, a, 5), 0.f);
+  EXPECT_NEAR(DtwCosineDistance()(a, c, 5), 0.f, 1e-6);
+  EXPECT_FLOAT_EQ(DtwCosineDistance()(a, zero, 5), 1.f);
+  EXPECT_FLOAT_EQ(DtwCosineDistance()(zero, zero, 5), 0.f);
+}
+
+// With a band covering the whole matrix, the banded version is the reference.
+TEST(DynamicTimeWarpingTest, WideBandMatchesReference) {
+  const auto sequence1 = Curve(60, 0.f);
+  const auto sequence2 = Curve(37, 0.4f);
+  const DynamicTimeWarping dtw(2, EuclideanDistance);
+  const float cost = dtw.Compute(sequence1, sequence2);
+  std::vector<int> path1, path2;
+  dtw.BestPathSequence(sequence1, sequence2, &path1, &path2);
+
+  const std::vector<float> flat1 = Flatten(sequence1);
+  const std::vector<float> flat2 = Flatten(sequence2);
+  BandedDynamicTimeWarping<> banded(2);
+  EXPECT_EQ(banded.Compute(flat1.data(), 60, flat2.data(), 37, 60), cost);
+  std::vector<int> banded_path1, banded_path2;
+  banded.BestPathSequence(&banded_path1, &banded_path2);
+  EXPECT_EQ(banded_path1, path1);
+  EXPECT_EQ(banded_path2, path2);
+}
+
+TEST(DynamicTimeWarpingTest, NarrowBandAndMultiscale) {
+  constexpr int kLength1 = 600;
+  constexpr int kLength2 = 400;
+  constexpr int kRadius = 10;
+  const auto sequence1 = Curve(kLength1, 0.f);
+  const auto sequence2 = Curve(kLength2, 0.f);
+  const DynamicTimeWarping dtw(2, EuclideanDistance);
+  const float cost = dtw.Compute(sequence1, sequence2);
+
+  const std::vector<float> flat1 = Flatten(sequence1);
+  const std::vector<float> flat2 = Flatten(sequence2);
+  BandedDynamicTimeWarping<> banded(2);
+  const float banded_cost = banded.Compute(flat1.data(), kLength1,
+                                           flat2.data(), kLength2, kRadius);
+  EXPECT_LT(banded.window().size(), kLength1 * (2 * kRadius + 2));
+  EXPECT_GE(banded_cost, cost);
+  EXPECT_LT(banded_cost, 1.01f * cost);
+
+  const float multiscale_cost = banded.ComputeMultiscale(
+      flat1.data(), kLength1, flat2.data(), kLength2, kRadius);
+  EXPECT_LT(banded.window().size(), 4 * (kLength1 + kLength2) * kRadius);
+  EXPECT_GE(multiscale_cost, cost);
+  EXPECT_LT(multiscale_cost, 1.01f * cost);
+  std::vector<int> path1, path2;
+  banded.BestPathSequence(&path1, &path2);
+  ASSERT_EQ(path1.size(), path2.size());
+  EXPECT_EQ(path1.front(), 0);
+  EXPECT_EQ(path2.front(), 0);
+  EXPECT_EQ(path1.back(), kLength1 - 1);
+  EXPECT_EQ(path2.back(), kLength2 - 1);
+}
+
+// A window narrower than the slope still leaves a path to the corner.
+TEST(DynamicTimeWarpingTest, SteepBandIsConnected) {
+  const WarpingWindow window = WarpingWindow::Band(10, 100, 1);
+  EXPECT_EQ(window.start(0), 0);
+  EXPECT_EQ(window.end(9), 100);
+  for (int i = 1; i < window.height(); ++i) {
+    EXPECT_LE(window.start(i), window.end(i - 1));
+    EXPECT_GE(window.end(i), window.end(i - 1));
+  }
+}
 }  // namespace
 
 
@@ -0,0 +1,79 @@
+/**
+ * Speedy WASM loader.
+ *
+ * Loads the WebAssembly SIMD build (speedy.simd.js) when the runtime supports
+ * 128-bit SIMD, and falls back to the scalar build (speedy.js) otherwise.  Both
+ * builds expose the same API.  The shared-memory build (speedy.pthreads.js)
+ * is only loaded on request, since it needs a cross-origin isolated page.
+ *
+ *   import initSpeedy from './dist/speedy-loader.js';
+ *   const Module = await initSpeedy();
+ *   const stream = new Module.SonicStream(44100, 1);
+ */
+
+// Smallest module that uses a SIMD instruction:
+//   (func (result v128) (i8x16.popcnt (i8x16.splat (i32.const 0)))).
+// WebAssembly.validate() rejects it when SIMD is not supported.
+const SIMD_PROBE = new Uint8Array([
+    0, 97, 115, 109, 1, 0, 0, 0,           // magic, version
+    1, 5, 1, 96, 0, 1, 123,                // type: () -> v128
+    3, 2, 1, 0,                            // function table
+    10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11  // code
+]);
+
+let simdSupport = null;
+
+/**
+ * Check whether this runtime can run the WebAssembly SIMD build.
+ * @returns {boolean}
+ */
+export function supportsSimd() {
+    if (simdSupport === null) {
+        try {
+            simdSupport = typeof WebAssembly === 'object' &&
+                WebAssembly.validate(SIMD_PROBE);
+        } catch (e) {
+            simdSupport = false;
+        }
+    }
+    return simdSupport;
+}
+
+/**
+ * Check whether this page can run the shared-memory (pthreads) build.
+ * @returns {boolean}
+ */
+export function supportsThreads() {
+    return typeof SharedArrayBuffer === 'function' &&
+        globalThis.crossOriginIsolated === true;
+}
+
+/**
+ * Load and instantiate the fastest Speedy build available.
+ * @param {Object} [moduleArgs] - Passed to the Emscripten module factory
+ *     (e.g. locateFile).
+ * @param {Object} [options]
+ * @param {boolean} [options.simd] - Force (true) or disable (false) the SIMD
+ *     build. Defaults to feature detection.
+ * @param {boolean} [options.threads] - Load the pthreads build if the page
+ *     supports it (see supportsThreads).  Defaults to false.
+ * @returns {Promise<Object>} The initialized module.  Module.simd and
+ *     Module.threads tell which build was loaded.
+ */
+export default async function initSpeedy(moduleArgs = {}, options = {}) {
+    const useThreads = options.threads === true && supportsThreads();
+    const useSimd = !useThreads &&
+        (options.simd !== undefined ? options.simd : supportsSimd());
+    let factory;
+    if (useThreads) {
+        factory = (await import('./speedy.pthreads.js')).default;
+    } else if (useSimd) {
+        factory = (await import('./speedy.simd.js')).default;
+    } else {
+        factory = (await import('./speedy.js')).default;
+    }
+    const Module = await factory(moduleArgs);
+    Module.simd = useSimd;
+    Module.threads = useThreads;
+    return Module;
+}
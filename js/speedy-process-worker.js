@@ -0,0 +1,136 @@
+/**
+ * Speedy whole-file processing worker, the worker half of speedy-process.js.
+ *
+ * A classic worker script, so it loads the UMD build with importScripts() and
+ * serves pages using either bundle.  Each job streams the input through a
+ * SonicStream in bounded chunks: planar input is interleaved straight into the
+ * stream's input staging buffer, and the output staging buffer is copied
+ * straight into one output buffer, sized from the predicted duration and only
+ * grown if the prediction falls short.  Nothing else scales with the file.
+ *
+ * Messages in:
+ *   {type: 'process', id, channels, sampleRate, speed, rate, nonlinear,
+ *    settings, chunkSize, bundle, factory} - channels is one Float32Array per
+ *    channel; settings an optional {methodName: [args]} map of SonicStream
+ *    setters; bundle and factory name the UMD build to load (by default
+ *    speedy.umd.js and SpeedyWasm)
+ * Messages out:
+ *   {type: 'progress', id, fraction} - about every percent of the input
+ *   {type: 'done', id, buffer, length} - buffer (transferred) holds length
+ *    interleaved samples per channel
+ *   {type: 'error', id, message}
+ */
+
+// Samples per channel written to the stream at a time.
+const DEFAULT_CHUNK_SIZE = 16384;
+
+let modulePromise = null;
+
+function loadModule(bundle, factory) {
+    if (!modulePromise) {
+        importScripts(bundle || 'speedy.umd.js');
+        modulePromise = self[factory || 'SpeedyWasm']();
+    }
+    return modulePromise;
+}
+
+// Output samples per channel expected for length input samples.  With
+// nonlinear speedup the duration feedback keeps the average speed near the
+// requested one.
+function predictLength(length, speed, rate) {
+    return Math.ceil(length / (speed * rate) * 1.05);
+}
+
+// A bigger buffer holding the first used floats of buffer.
+function grow(buffer, used, minFloats) {
+    const floats = Math.max(minFloats, Math.ceil(buffer.byteLength / 4 * 1.5));
+    if (buffer.transfer) {
+        return buffer.transfer(floats * 4);
+    }
+    const grown = new ArrayBuffer(floats * 4);
+    new Float32Array(grown).set(new Float32Array(buffer, 0, used));
+    return grown;
+}
+
+function processJob(Module, job) {
+    const channels = job.channels;
+    const channelCount = channels.length;
+    const length = channels[0].length;
+    const speed = job.speed || 1;
+    const rate = job.rate || 1;
+    const chunkSize = job.chunkSize || DEFAULT_CHUNK_SIZE;
+
+    const stream = new Module.SonicStream(job.sampleRate, channelCount);
+    try {
+        for (const [method, args] of Object.entries(job.settings || {})) {
+            stream[method](...args);
+        }
+        stream.setSpeed(speed);
+        stream.setRate(rate);
+        stream.enableNonlinearSpeedup(job.nonlinear || 0);
+        stream.setStagingBufferSize(chunkSize);
+
+        let buffer = new ArrayBuffer(
+            (predictLength(length, speed, rate) + chunkSize) * channelCount * 4);
+        let output = new Float32Array(buffer);
+        let used = 0;   // Floats
+        const drain = () => {
+            let samplesRead;
+            while ((samplesRead = stream.readOutputBuffer()) > 0) {
+                const floats = samplesRead * channelCount;
+                if (used + floats > output.length) {
+                    buffer = grow(buffer, used, used + floats);
+                    output = new Float32Array(buffer);
+                }
+                // Fetch the view each time: WASM memory growth detaches it.
+                output.set(stream.getOutputBuffer().subarray(0, floats), used);
+                used += floats;
+            }
+        };
+
+        let lastProgress = 0;
+        for (let position = 0; position < length; position += chunkSize) {
+            const count = Math.min(chunkSize, length - position);
+            const input = stream.getInputBuffer();
+            if (channelCount === 1) {
+                input.set(channels[0].subarray(position, position + count));
+            } else {
+                for (let c = 0; c < channelCount; c++) {
+                    const planar = channels[c];
+                    for (let i = 0; i < count; i++) {
+                        input[i * channelCount + c] = planar[position + i];
+                    }
+                }
+            }
+            stream.writeInputBuffer(count);
+            drain();
+            const fraction = (position + count) / length;
+            if (fraction - lastProgress >= 0.01) {
+                self.postMessage({ type: 'progress', id: job.id, fraction });
+                lastProgress = fraction;
+            }
+        }
+        stream.flushStream();
+        drain();
+        if (buffer.transfer && used * 4 < buffer.byteLength) {
+            buffer = buffer.transfer(used * 4);   // Drop the slack, if cheaply
+        }
+        return { buffer, length: used / channelCount };
+    } finally {
+        stream.delete();
+    }
+}
+
+self.onmessage = async (event) => {
+    const job = event.data;
+    if (job.type !== 'process') {
+        return;
+    }
+    try {
+        const Module = await loadModule(job.bundle, job.factory);
+        const { buffer, length } = processJob(Module, job);
+        self.postMessage({ type: 'done', id: job.id, buffer, length }, [buffer]);
+    } catch (e) {
+        self.postMessage({ type: 'error', id: job.id, message: e.toString() });
+    }
+};
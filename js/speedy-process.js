@@ -0,0 +1,124 @@
+/**
+ * Speedy whole-file processing off the main thread.
+ *
+ * processBuffer() runs a whole signal through a SonicStream on a worker
+ * (speedy-process-worker.js), in bounded chunks, and resolves with the output
+ * in one transferred ArrayBuffer.  The worker writes into a single buffer
+ * sized from the predicted duration, so the peak memory is about the size of
+ * the output, and the page stays responsive however long the file is.
+ *
+ *   import { processBuffer } from './dist/speedy-process.js';
+ *   const result = await processBuffer(
+ *       [audio.getChannelData(0), audio.getChannelData(1)], audio.sampleRate,
+ *       { speed: 2.0, nonlinear: 1.0, onProgress: (f) => bar.value = f });
+ *   const left = result.getChannelData(0);   // Or result.interleaved
+ *
+ * The worker is a classic script that loads the UMD build, so pages that only
+ * use speedy.umd.js can post it the same 'process' message directly.
+ */
+
+import { supportsSimd } from './speedy-loader.js';
+
+let nextId = 0;
+
+/**
+ * Process a whole signal on a worker.
+ * @param {Float32Array[]} channels - One array per channel, all the same
+ *     length (an AudioBuffer's getChannelData()).  They are copied to the
+ *     worker unless options.transfer is set.
+ * @param {number} sampleRate
+ * @param {Object} [options]
+ * @param {number} [options.speed] - Default 1.
+ * @param {number} [options.rate] - Playback rate (pitch and speed), default 1.
+ * @param {number} [options.nonlinear] - Nonlinear factor, default 0.
+ * @param {Object} [options.settings] - {methodName: [args]} map of other
+ *     SonicStream setters, e.g. {setSpeedySilenceGate: [1]}.
+ * @param {number} [options.chunkSize] - Samples per channel written at a
+ *     time, 16384 by default.
+ * @param {function(number)} [options.onProgress] - Called with the fraction
+ *     of the input processed, about every percent.
+ * @param {AbortSignal} [options.signal] - Stops the worker and rejects.
+ * @param {boolean} [options.transfer] - Transfer the channel buffers instead
+ *     of copying them (they are detached here).
+ * @param {boolean} [options.simd] - Load the SIMD build, by default if the
+ *     runtime supports it.
+ * @param {string|URL} [options.workerUrl] - Where the worker is; the UMD
+ *     builds are loaded from next to it.
+ * @returns {Promise<Object>} {buffer, interleaved, length, channelCount,
+ *     sampleRate, getChannelData(c)}: buffer holds length interleaved samples
+ *     per channel.
+ */
+export function processBuffer(channels, sampleRate, options = {}) {
+    const simd = options.simd !== undefined ? options.simd : supportsSimd();
+    const worker = new Worker(options.workerUrl ||
+                              new URL('./speedy-process-worker.js', import.meta.url));
+    const id = nextId++;
+    const channelCount = channels.length;
+    return new Promise((resolve, reject) => {
+        const onAbort = () => {
+            worker.terminate();
+            reject(new DOMException('processBuffer aborted', 'AbortError'));
+        };
+        const finish = () => {
+            worker.terminate();
+            if (options.signal) {
+                options.signal.removeEventListener('abort', onAbort);
+            }
+        };
+        if (options.signal) {
+            if (options.signal.aborted) {
+                onAbort();
+                return;
+            }
+            options.signal.addEventListener('abort', onAbort);
+        }
+        worker.onmessage = (event) => {
+            const message = event.data;
+            if (message.id !== id) {
+                return;
+            }
+            if (message.type === 'progress') {
+                if (options.onProgress) {
+                    options.onProgress(message.fraction);
+                }
+            } else if (message.type === 'done') {
+                finish();
+                resolve(makeResult(message.buffer, message.length,
+                                   channelCount, sampleRate));
+            } else if (message.type === 'error') {
+                finish();
+                reject(new Error(message.message));
+            }
+        };
+        worker.onerror = (event) => {
+            finish();
+            reject(new Error(event.message));
+        };
+        worker.postMessage({
+            type: 'process', id, channels, sampleRate,
+            speed: options.speed, rate: options.rate,
+            nonlinear: options.nonlinear, settings: options.settings,
+            chunkSize: options.chunkSize,
+            bundle: simd ? 'speedy.simd.umd.js' : 'speedy.umd.js',
+            factory: simd ? 'SpeedyWasmSimd' : 'SpeedyWasm'
+        }, options.transfer ? channels.map((c) => c.buffer) : []);
+    });
+}
+
+function makeResult(buffer, length, channelCount, sampleRate) {
+    const interleaved = new Float32Array(buffer, 0, length * channelCount);
+    return {
+        buffer, interleaved, length, channelCount, sampleRate,
+        // Deinterleave one channel, e.g. for AudioBuffer.copyToChannel().
+        getChannelData(c) {
+            if (channelCount === 1) {
+                return interleaved;
+            }
+            const data = new Float32Array(length);
+            for (let i = 0; i < length; i++) {
+                data[i] = interleaved[i * channelCount + c];
+            }
+            return data;
+        }
+    };
+}
@@ -0,0 +1,309 @@
+/**
+ * Speedy render cache.
+ *
+ * Renders a source in fixed-length segments on a worker (speedy-render-worker.js)
+ * and keeps the output in memory, keyed by segment, speed, nonlinear factor and
+ * stream settings, so that playing a section again, or going back to a speed
+ * heard before, costs a copy instead of the whole Speedy and SOLA chain.  While
+ * playing, the segments after the playhead are rendered ahead at the current
+ * speed.  The least recently used segments are dropped to stay within a byte
+ * budget.
+ *
+ * Each segment is rendered on its own from a stream seeked to its start, with
+ * the Speedy filters restored to where a play-through from the start of the
+ * source would have them, plus a little of the next segment.  So a segment
+ * sounds the same whichever order the segments were rendered in, and play()
+ * crossfades the overlap into the head of the next segment.
+ *
+ *   import { SpeedyRenderCache } from './dist/speedy-render-cache.js';
+ *   const cache = await SpeedyRenderCache.create(
+ *       [audio.getChannelData(0), audio.getChannelData(1)], audio.sampleRate);
+ *   const params = { speed: 2.0, nonlinear: 1.0 };
+ *   for await (const chunk of cache.play(cache.segmentAt(seconds), params)) {
+ *       ring.writeInterleaved(chunk);   // params.speed may change in between
+ *   }
+ */
+
+const DEFAULTS = {
+    segmentSeconds: 5,
+    overlapSeconds: 0.05,
+    lookahead: 3,
+    budgetBytes: 64 * 1024 * 1024
+};
+
+export class SpeedyRenderCache {
+    /**
+     * Start a worker and hand it the source.
+     * @param {Float32Array[]} channels - One array per channel, all the same
+     *     length (an AudioBuffer's getChannelData()).
+     * @param {number} sampleRate
+     * @param {Object} [options]
+     * @param {number} [options.segmentSeconds] - Length of a cached segment,
+     *     5 s by default.
+     * @param {number} [options.overlapSeconds] - Input rendered past each
+     *     segment and crossfaded into the next, 50 ms by default.
+     * @param {number} [options.lookahead] - Segments rendered ahead of the
+     *     playhead, 3 by default.
+     * @param {number} [options.budgetBytes] - Most output kept, 64 MB by
+     *     default.
+     * @param {string|URL} [options.workerUrl] - Where the render worker is.
+     * @returns {Promise<SpeedyRenderCache>}
+     */
+    static async create(channels, sampleRate, options = {}) {
+        const channelCount = channels.length;
+        const length = channels[0].length;
+        const source = new Float32Array(length * channelCount);
+        for (let c = 0; c < channelCount; c++) {
+            const input = channels[c];
+            for (let i = 0; i < length; i++) {
+                source[i * channelCount + c] = input[i];
+            }
+        }
+        const opts = Object.assign({}, DEFAULTS, options);
+        const worker = new Worker(
+            opts.workerUrl || new URL('./speedy-render-worker.js', import.meta.url),
+            { type: 'module' });
+        const cache = new SpeedyRenderCache(worker, sampleRate, channelCount, opts);
+        await cache.start(source);
+        return cache;
+    }
+
+    constructor(worker, sampleRate, channelCount, options) {
+        this.worker = worker;
+        this.sampleRate = sampleRate;
+        this.channelCount = channelCount;
+        this.options = options;
+        this.budgetBytes = options.budgetBytes;
+        // Key -> {output, overlap}, in least recently used order.
+        this.entries = new Map();
+        // Key -> {segment, params, waiters: [{resolve, reject}]}, not rendered
+        // yet.  queue holds the keys in the order they will be rendered.
+        this.pending = new Map();
+        this.queue = [];
+        this.inFlight = null;
+        this.nextId = 0;
+        this.stats = { hits: 0, misses: 0, renders: 0, evictions: 0, bytes: 0 };
+        this.worker.onmessage = (event) => this.handleMessage(event.data);
+    }
+
+    start(source) {
+        return new Promise((resolve, reject) => {
+            this.onReady = (message) => {
+                this.frameStep = message.frameStep;
+                this.segmentFrames = message.segmentFrames;
+                this.segmentCount = message.segmentCount;
+                this.segmentSamples = message.segmentFrames * message.frameStep;
+                resolve();
+            };
+            this.onInitError = reject;
+            this.worker.postMessage({
+                type: 'init', source, sampleRate: this.sampleRate,
+                channels: this.channelCount,
+                segmentSeconds: this.options.segmentSeconds,
+                overlapSeconds: this.options.overlapSeconds
+            }, [source.buffer]);
+        });
+    }
+
+    /**
+     * @param {number} seconds - Position in the source.
+     * @returns {number} The segment that holds it.
+     */
+    segmentAt(seconds) {
+        return Math.min(this.segmentCount - 1, Math.max(0,
+            Math.floor(seconds * this.sampleRate / this.segmentSamples)));
+    }
+
+    /**
+     * Get a rendered segment, from the cache or else from the worker ahead of
+     * anything only prefetched.
+     * @param {number} segment
+     * @param {Object} params - {speed, nonlinear, settings}; settings is an
+     *     optional {methodName: [args]} map of SonicStream setters, e.g.
+     *     {setSpeedySilenceGate: [1]}.
+     * @returns {Promise<{output: Float32Array, overlap: number}>} output is
+     *     interleaved; its last overlap samples per channel are the head of
+     *     the next segment.  Don't modify it: it is the cached copy.
+     */
+    getSegment(segment, params) {
+        const key = this.keyOf(segment, params);
+        const entry = this.entries.get(key);
+        if (entry) {
+            this.stats.hits++;
+            this.entries.delete(key);   // Most recently used
+            this.entries.set(key, entry);
+            return Promise.resolve(entry);
+        }
+        this.stats.misses++;
+        return new Promise((resolve, reject) => {
+            const request = this.request(key, segment, params);
+            request.waiters.push({ resolve, reject });
+            if (request !== this.inFlight) {
+                this.queue.splice(this.queue.indexOf(key), 1);
+                this.queue.unshift(key);
+                this.pump();
+            }
+        });
+    }
+
+    /**
+     * Render segments after segment (the playhead) at params, nearest first,
+     * dropping what is still queued for an earlier playhead but nobody is
+     * waiting for.
+     * @param {number} segment
+     * @param {Object} params
+     * @param {number} [count] - Segments, options.lookahead by default.
+     */
+    prefetch(segment, params, count = this.options.lookahead) {
+        this.queue = this.queue.filter((key) => {
+            if (this.pending.get(key).waiters.length > 0) {
+                return true;
+            }
+            this.pending.delete(key);
+            return false;
+        });
+        const last = Math.min(segment + count, this.segmentCount - 1);
+        for (let s = segment + 1; s <= last; s++) {
+            const key = this.keyOf(s, params);
+            if (!this.entries.has(key) && !this.pending.has(key) &&
+                (!this.inFlight || this.inFlight.key !== key)) {
+                this.request(key, s, params);
+            }
+        }
+        this.pump();
+    }
+
+    /**
+     * Play from a segment to the end, crossfading the segment joins.  The
+     * params are read again at each segment, so changing them takes effect at
+     * the next join.
+     * @param {number} segment - First segment, e.g. from segmentAt().
+     * @param {Object} params - As for getSegment().
+     * @yields {Float32Array} Interleaved output, a new array each time.
+     */
+    async *play(segment, params) {
+        const channels = this.channelCount;
+        let tail = null;
+        for (let s = segment; s < this.segmentCount; s++) {
+            const { output, overlap } = await this.getSegment(s, params);
+            this.prefetch(s, params);
+            const bodyEnd = output.length - overlap * channels;
+            const chunk = output.slice(0, bodyEnd);
+            if (tail) {
+                const fade = Math.min(tail.length, chunk.length) / channels;
+                for (let i = 0; i < fade; i++) {
+                    const gain = (i + 0.5) / fade;
+                    for (let c = 0; c < channels; c++) {
+                        const j = i * channels + c;
+                        chunk[j] = tail[j] * (1 - gain) + chunk[j] * gain;
+                    }
+                }
+            }
+            tail = output.subarray(bodyEnd);
+            yield chunk;
+        }
+    }
+
+    /**
+     * Drop every cached segment, e.g. when the budget changes.
+     * @param {number} [budgetBytes] - A new budget.
+     */
+    clear(budgetBytes = this.budgetBytes) {
+        this.budgetBytes = budgetBytes;
+        this.entries.clear();
+        this.stats.bytes = 0;
+    }
+
+    /** Stop the worker.  Waiting requests are rejected. */
+    terminate() {
+        this.worker.terminate();
+        const error = new Error('SpeedyRenderCache terminated');
+        for (const request of this.pending.values()) {
+            request.waiters.forEach((waiter) => waiter.reject(error));
+        }
+        if (this.inFlight) {
+            this.inFlight.waiters.forEach((waiter) => waiter.reject(error));
+        }
+        this.pending.clear();
+        this.queue = [];
+        this.inFlight = null;
+        this.clear();
+    }
+
+    keyOf(segment, params) {
+        return `${segment}:${params.speed}:${params.nonlinear || 0}:` +
+            JSON.stringify(params.settings || {});
+    }
+
+    request(key, segment, params) {
+        if (this.inFlight && this.inFlight.key === key) {
+            return this.inFlight;
+        }
+        let request = this.pending.get(key);
+        if (!request) {
+            request = {
+                key, segment, waiters: [],
+                params: { speed: params.speed, nonlinear: params.nonlinear || 0,
+                          settings: params.settings || {} }
+            };
+            this.pending.set(key, request);
+            this.queue.push(key);
+        }
+        return request;
+    }
+
+    // Send the next queued render if the worker is idle.  Only one at a time,
+    // so a new playhead can still reorder everything behind it.
+    pump() {
+        this.queue = this.queue.filter((key) => this.pending.has(key));
+        if (this.inFlight || this.queue.length === 0) {
+            return;
+        }
+        const key = this.queue.shift();
+        const request = this.pending.get(key);
+        this.pending.delete(key);
+        request.id = this.nextId++;
+        this.inFlight = request;
+        this.worker.postMessage({
+            type: 'render', id: request.id, segment: request.segment,
+            params: request.params
+        });
+    }
+
+    handleMessage(message) {
+        if (message.type === 'ready') {
+            this.onReady(message);
+            return;
+        }
+        const request = this.inFlight;
+        if (!request) {
+            if (message.type === 'error') {
+                this.onInitError(new Error(message.message));
+            }
+            return;
+        }
+        this.inFlight = null;
+        if (message.type === 'segment') {
+            this.stats.renders++;
+            const entry = { output: message.output, overlap: message.overlap };
+            this.store(request.key, entry);
+            request.waiters.forEach((waiter) => waiter.resolve(entry));
+        } else if (message.type === 'error') {
+            const error = new Error(message.message);
+            request.waiters.forEach((waiter) => waiter.reject(error));
+        }
+        this.pump();
+    }
+
+    store(key, entry) {
+        this.entries.set(key, entry);
+        this.stats.bytes += entry.output.byteLength;
+        // Keep the newest segment even if it alone is over the budget.
+        while (this.stats.bytes > this.budgetBytes && this.entries.size > 1) {
+            const [oldestKey, oldest] = this.entries.entries().next().value;
+            this.entries.delete(oldestKey);
+            this.stats.bytes -= oldest.output.byteLength;
+            this.stats.evictions++;
+        }
+    }
+}
@@ -0,0 +1,187 @@
+/**
+ * Speedy render worker, the rendering half of speedy-render-cache.js.
+ *
+ * Holds one source signal and renders segments of it on request, each one
+ * independently: seek to the segment, restoring the Speedy filters from the
+ * checkpoint a play-through from the start of the source would have there,
+ * write the segment plus a short overlap into the next one, flush, and send
+ * the output back as a transferable buffer.  The checkpoints come from a
+ * separate analysis stream that only ever moves forward through the source,
+ * so a segment renders the same whatever was rendered before it, and any two
+ * neighbors can be stitched by crossfading the overlap.
+ *
+ * Messages in:
+ *   {type: 'init', source, sampleRate, channels, segmentSeconds,
+ *    overlapSeconds} - source is interleaved (transfer its buffer)
+ *   {type: 'render', id, segment, params} - params is {speed, nonlinear,
+ *    settings}, settings a {methodName: [args]} map of SonicStream setters
+ * Messages out:
+ *   {type: 'ready', frameStep, segmentFrames, segmentCount}
+ *   {type: 'segment', id, output, overlap} - overlap is how many samples per
+ *    channel at the end of output belong to the next segment
+ *   {type: 'error', id, message}
+ */
+
+import initSpeedy from './speedy-loader.js';
+
+// Streams kept, one per distinct settings, before the oldest is destroyed.
+const MAX_STREAMS = 4;
+// Samples per channel moved through the staging buffers at a time.
+const CHUNK_SIZE = 8192;
+
+let Module = null;
+let source = null;
+let sampleRate = 0;
+let channels = 1;
+let frameStep = 0;
+let segmentFrames = 0;
+let overlapFrames = 0;
+let frameCount = 0;
+// Settings key -> {stream, analyzer, analyzed, checkpoints: Map(segment ->
+// checkpoint)}, in least recently used order.
+const streams = new Map();
+
+function createStream(settings) {
+    const stream = new Module.SonicStream(sampleRate, channels);
+    for (const [method, args] of Object.entries(settings || {})) {
+        stream[method](...args);
+    }
+    stream.setStagingBufferSize(CHUNK_SIZE);
+    return stream;
+}
+
+function getStream(settings) {
+    const key = JSON.stringify(settings || {});
+    let state = streams.get(key);
+    if (state) {
+        streams.delete(key);
+    } else {
+        // The analyzer plays the source from its start at speed 1; only its
+        // Speedy filters are used, and they don't depend on the speed.
+        const analyzer = createStream(settings);
+        analyzer.enableNonlinearSpeedup(1.0);
+        state = {
+            stream: createStream(settings), analyzer, analyzed: 0,
+            checkpoints: new Map()
+        };
+        if (streams.size >= MAX_STREAMS) {
+            const [oldestKey, oldest] = streams.entries().next().value;
+            oldest.stream.delete();
+            oldest.analyzer.delete();
+            streams.delete(oldestKey);
+        }
+    }
+    streams.set(key, state);
+    return state;
+}
+
+// Write frames [first, last) of the source.  outputs collects what comes out,
+// unless it is null.
+function writeFrames(stream, first, last, outputs) {
+    let position = first * frameStep;
+    const end = Math.min(last * frameStep, source.length / channels);
+    while (position < end) {
+        const count = Math.min(CHUNK_SIZE, end - position);
+        stream.getInputBuffer().set(
+            source.subarray(position * channels, (position + count) * channels));
+        stream.writeInputBuffer(count);
+        drain(stream, outputs);
+        position += count;
+    }
+}
+
+function drain(stream, outputs) {
+    let samplesRead;
+    while ((samplesRead = stream.readOutputBuffer()) > 0) {
+        if (outputs) {
+            outputs.push(stream.getOutputBuffer().slice(0, samplesRead * channels));
+        }
+    }
+}
+
+// The checkpoint at the start of segment, with the duration feedback zeroed so
+// it restarts with each segment.  Segment 0 starts from the defaults.
+function checkpointAt(state, segment) {
+    while (state.analyzed < segment) {
+        const first = state.analyzed * segmentFrames;
+        writeFrames(state.analyzer, first, first + segmentFrames, null);
+        const checkpoint = state.analyzer.getSpeedyCheckpoint();
+        checkpoint.currentDuration = 0;
+        checkpoint.desiredDuration = 0;
+        state.checkpoints.set(++state.analyzed, checkpoint);
+    }
+    return state.checkpoints.get(segment);
+}
+
+function render(segment, params) {
+    const state = getStream(params.settings);
+    const stream = state.stream;
+    const first = segment * segmentFrames;
+    const last = Math.min(first + segmentFrames, frameCount);
+    stream.setSpeed(params.speed);
+    stream.enableNonlinearSpeedup(params.nonlinear);
+    const checkpoint = checkpointAt(state, segment);
+    if (checkpoint) {
+        stream.seekWithCheckpoint(first, checkpoint);
+    } else {
+        stream.seek(first);
+    }
+
+    const outputs = [];
+    writeFrames(stream, first, last, outputs);
+    // The overlap is what comes out once its input starts going in.  Under
+    // nonlinear speedup the output rate varies, so this count, not the input
+    // lengths, says where it starts.
+    let bodyLength = 0;
+    for (const chunk of outputs) {
+        bodyLength += chunk.length;
+    }
+    const overlapEnd = Math.min(last + overlapFrames, frameCount);
+    writeFrames(stream, last, overlapEnd, outputs);
+    stream.flushStream();
+    drain(stream, outputs);
+
+    let length = 0;
+    for (const chunk of outputs) {
+        length += chunk.length;
+    }
+    const output = new Float32Array(length);
+    let offset = 0;
+    for (const chunk of outputs) {
+        output.set(chunk, offset);
+        offset += chunk.length;
+    }
+    // The last segment has no overlap: everything flushed belongs to it.
+    const overlap = overlapEnd > last ? (length - bodyLength) / channels : 0;
+    return { output, overlap };
+}
+
+self.onmessage = async (event) => {
+    const message = event.data;
+    try {
+        if (message.type === 'init') {
+            Module = await initSpeedy();
+            source = message.source;
+            sampleRate = message.sampleRate;
+            channels = message.channels;
+            const speedy = new Module.SpeedyStream(sampleRate);
+            frameStep = speedy.inputFrameStep();
+            speedy.delete();
+            frameCount = Math.ceil(source.length / channels / frameStep);
+            segmentFrames = Math.max(1, Math.round(
+                message.segmentSeconds * sampleRate / frameStep));
+            overlapFrames = Math.max(1, Math.round(
+                message.overlapSeconds * sampleRate / frameStep));
+            self.postMessage({
+                type: 'ready', frameStep, segmentFrames,
+                segmentCount: Math.ceil(frameCount / segmentFrames)
+            });
+        } else if (message.type === 'render') {
+            const { output, overlap } = render(message.segment, message.params);
+            self.postMessage({ type: 'segment', id: message.id, output, overlap },
+                             [output.buffer]);
+        }
+    } catch (e) {
+        self.postMessage({ type: 'error', id: message.id, message: e.toString() });
+    }
+};
@@ -0,0 +1,170 @@
+/**
+ * Speedy input ring.
+ *
+ * A lock-free single-producer single-consumer ring of interleaved float
+ * samples, for feeding a SonicStream in an AudioWorklet from another thread.
+ * The header is a Uint32Array (write count, read count, capacity, channel
+ * count; the counts are in samples per channel and wrap at 2^32), followed by
+ * capacity * channelCount samples.  The same layout lives in two places:
+ *
+ * - In WASM memory, from SonicStream.setupInputRing() and
+ *   getInputRingLayout().  The producer writes where Sonic reads, and
+ *   pullInputRing() consumes without a copy.  Another thread can only see it
+ *   when the module memory is shared.
+ * - In a SharedArrayBuffer from SpeedyRingBuffer.create(), for builds without
+ *   shared memory.  The consumer copies straight into the stream's input
+ *   staging buffer with copyTo(), one TypedArray.set() per span.
+ *
+ *   const ring = SpeedyRingBuffer.create(sampleRate, 2);  // One second
+ *   ring.write([left, right]);                           // Producer
+ *   const count = ring.copyTo(stream.getInputBuffer());  // Consumer
+ *   stream.writeInputBuffer(count);
+ */
+
+const WRITE_COUNT = 0;
+const READ_COUNT = 1;
+const CAPACITY = 2;
+const CHANNEL_COUNT = 3;
+const HEADER_SIZE = 4;
+
+export class SpeedyRingBuffer {
+    /**
+     * Create a ring in a new SharedArrayBuffer.
+     * @param {number} capacity - Samples per channel, rounded up to a power
+     *     of two.
+     * @param {number} channelCount
+     * @returns {SpeedyRingBuffer} Pass ring.buffer and ring.layout to the
+     *     other thread to rebuild it there.
+     */
+    static create(capacity, channelCount) {
+        let rounded = 1;
+        while (rounded < capacity) {
+            rounded *= 2;
+        }
+        const samplesOffset = HEADER_SIZE * Uint32Array.BYTES_PER_ELEMENT;
+        const buffer = new SharedArrayBuffer(
+            samplesOffset + rounded * channelCount * Float32Array.BYTES_PER_ELEMENT);
+        const header = new Uint32Array(buffer, 0, HEADER_SIZE);
+        header[CAPACITY] = rounded;
+        header[CHANNEL_COUNT] = channelCount;
+        return new SpeedyRingBuffer(buffer, {
+            headerOffset: 0, samplesOffset, capacity: rounded, channelCount
+        });
+    }
+
+    /**
+     * @param {ArrayBuffer|SharedArrayBuffer} buffer - The ring's buffer, or
+     *     the module memory.
+     * @param {Object} layout - {headerOffset, samplesOffset, capacity,
+     *     channelCount}, from create() or SonicStream.getInputRingLayout().
+     */
+    constructor(buffer, layout) {
+        this.layout = layout;
+        this.capacity = layout.capacity;
+        this.channelCount = layout.channelCount;
+        this.attach(buffer);
+    }
+
+    /**
+     * Rebuild the views, e.g. after the (unshared) WASM memory has grown and
+     * detached the old buffer.
+     * @param {ArrayBuffer|SharedArrayBuffer} buffer
+     */
+    attach(buffer) {
+        this.buffer = buffer;
+        this.header = new Uint32Array(buffer, this.layout.headerOffset,
+                                      HEADER_SIZE);
+        this.samples = new Float32Array(buffer, this.layout.samplesOffset,
+                                        this.capacity * this.channelCount);
+    }
+
+    /** @returns {boolean} Whether memory growth has detached the views. */
+    get detached() {
+        return this.header.length === 0;
+    }
+
+    /** @returns {number} Samples per channel waiting to be read. */
+    get available() {
+        return (Atomics.load(this.header, WRITE_COUNT) -
+                Atomics.load(this.header, READ_COUNT)) >>> 0;
+    }
+
+    /** @returns {number} Samples per channel that can be written. */
+    get space() {
+        return this.capacity - this.available;
+    }
+
+    /**
+     * Producer: append planar channel data, interleaving it into the ring.
+     * @param {Float32Array[]} channels - One array per channel (an
+     *     AudioBuffer's getChannelData()), all at least count long.
+     * @param {number} [count] - Samples per channel, by default all.
+     * @returns {number} Samples written, fewer than count if the ring fills.
+     */
+    write(channels, count = channels[0].length) {
+        const write = Atomics.load(this.header, WRITE_COUNT);
+        const read = Atomics.load(this.header, READ_COUNT);
+        const total = Math.min(count, this.capacity - ((write - read) >>> 0));
+        const mask = this.capacity - 1;
+        const stride = this.channelCount;
+        for (let c = 0; c < stride; c++) {
+            const input = channels[c];
+            for (let i = 0; i < total; i++) {
+                this.samples[((write + i) & mask) * stride + c] = input[i];
+            }
+        }
+        Atomics.store(this.header, WRITE_COUNT, (write + total) >>> 0);
+        return total;
+    }
+
+    /**
+     * Producer: append already interleaved samples.
+     * @param {Float32Array} interleaved - Whole frames of channelCount
+     *     samples.
+     * @returns {number} Samples per channel written.
+     */
+    writeInterleaved(interleaved) {
+        const stride = this.channelCount;
+        const write = Atomics.load(this.header, WRITE_COUNT);
+        const read = Atomics.load(this.header, READ_COUNT);
+        const total = Math.min(interleaved.length / stride | 0,
+                               this.capacity - ((write - read) >>> 0));
+        let done = 0;
+        while (done < total) {
+            const offset = (write + done) & (this.capacity - 1);
+            const span = Math.min(total - done, this.capacity - offset);
+            this.samples.set(
+                interleaved.subarray(done * stride, (done + span) * stride),
+                offset * stride);
+            done += span;
+        }
+        Atomics.store(this.header, WRITE_COUNT, (write + total) >>> 0);
+        return total;
+    }
+
+    /**
+     * Consumer: move waiting samples, still interleaved, into target (e.g.
+     * SonicStream.getInputBuffer()) in at most two copies.
+     * @param {Float32Array} target
+     * @param {number} [maxSamples] - Samples per channel, at most.
+     * @returns {number} Samples per channel copied.
+     */
+    copyTo(target, maxSamples = Infinity) {
+        const stride = this.channelCount;
+        const write = Atomics.load(this.header, WRITE_COUNT);
+        const read = Atomics.load(this.header, READ_COUNT);
+        const total = Math.min((write - read) >>> 0, maxSamples,
+                               target.length / stride | 0);
+        let done = 0;
+        while (done < total) {
+            const offset = (read + done) & (this.capacity - 1);
+            const span = Math.min(total - done, this.capacity - offset);
+            target.set(this.samples.subarray(offset * stride,
+                                             (offset + span) * stride),
+                       done * stride);
+            done += span;
+        }
+        Atomics.store(this.header, READ_COUNT, (read + total) >>> 0);
+        return total;
+    }
+}
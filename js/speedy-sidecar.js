@@ -0,0 +1,92 @@
+/**
+ * Speedy tension sidecar reader.
+ *
+ * Reads the binary sidecar written by speedySidecarWrite() (see
+ * speedy_sidecar.h, or speedy_wave --sidecar_file) straight out of an
+ * ArrayBuffer.  The tension and feature arrays are views into the buffer, not
+ * copies.
+ *
+ *   import { parseSidecar } from './dist/speedy-sidecar.js';
+ *   const sidecar = parseSidecar(await (await fetch('talk.spdt')).arrayBuffer());
+ *   stream.setTensionTrack(sidecar.decodeTension());
+ */
+
+const MAGIC = 'SPDT';
+const VERSION = 1;
+const HEADER_SIZE = 72;
+const TUNING_PARAMETER_COUNT = 8;
+
+export const FLOAT32 = 0;
+export const INT16 = 1;
+
+/**
+ * Parse a sidecar file.
+ * @param {ArrayBuffer} buffer - The file contents.
+ * @param {number} [byteOffset=0] - Where the sidecar starts in the buffer
+ *     (must be a multiple of 4).
+ * @returns {Object} The header fields, plus tension (Float32Array or
+ *     Int16Array, by encoding), features (Float32Array, frame-major, or null)
+ *     and decodeTension(), which returns the tensions as a Float32Array.
+ * @throws {Error} If the buffer does not hold a valid sidecar.
+ */
+export function parseSidecar(buffer, byteOffset = 0) {
+    if (byteOffset % 4 !== 0 || buffer.byteLength - byteOffset < HEADER_SIZE) {
+        throw new Error('Not a Speedy sidecar: too short or misaligned');
+    }
+    const view = new DataView(buffer, byteOffset);
+    const magic = String.fromCharCode(view.getUint8(0), view.getUint8(1),
+                                      view.getUint8(2), view.getUint8(3));
+    const version = view.getUint16(4, true);
+    const headerSize = view.getUint16(6, true);
+    const encoding = view.getUint16(28, true);
+    if (magic !== MAGIC || version < VERSION || headerSize < HEADER_SIZE ||
+        headerSize % 4 !== 0 || (encoding !== FLOAT32 && encoding !== INT16)) {
+        throw new Error('Not a Speedy sidecar: bad header');
+    }
+
+    const sidecar = {
+        version,
+        sampleRate: view.getUint32(8, true),
+        frameStep: view.getUint32(12, true),
+        frameRate: view.getFloat32(16, true),
+        frameCount: view.getUint32(20, true),
+        hysteresisFuture: view.getInt16(24, true),
+        hysteresisPast: view.getInt16(26, true),
+        encoding,
+        featureCount: view.getUint16(30, true),
+        tensionScale: view.getFloat32(32, true),
+        tensionOffset: view.getFloat32(36, true),
+        tuning: []
+    };
+    for (let i = 0; i < TUNING_PARAMETER_COUNT; i++) {
+        sidecar.tuning.push(view.getFloat32(40 + 4*i, true));
+    }
+
+    const count = sidecar.frameCount;
+    const tensionStart = byteOffset + headerSize;
+    const tensionBytes = (count * (encoding === INT16 ? 2 : 4) + 3) & ~3;
+    const featureStart = tensionStart + tensionBytes;
+    const featureBytes = count * sidecar.featureCount * 4;
+    if (buffer.byteLength < featureStart + featureBytes) {
+        throw new Error('Not a Speedy sidecar: truncated data');
+    }
+    sidecar.tension = encoding === INT16 ?
+        new Int16Array(buffer, tensionStart, count) :
+        new Float32Array(buffer, tensionStart, count);
+    sidecar.features = sidecar.featureCount ?
+        new Float32Array(buffer, featureStart, count * sidecar.featureCount) :
+        null;
+
+    sidecar.decodeTension = function() {
+        if (encoding === FLOAT32) {
+            return sidecar.tension;
+        }
+        const tension = new Float32Array(count);
+        for (let i = 0; i < count; i++) {
+            tension[i] = sidecar.tension[i] * sidecar.tensionScale +
+                sidecar.tensionOffset;
+        }
+        return tension;
+    };
+    return sidecar;
+}
@@ -0,0 +1,95 @@
+/**
+ * Speedy analysis tap reader.
+ *
+ * Reads the per-frame analysis (frame, tension, features and spectrogram)
+ * that a SonicStream keeps after setupTaps(), straight from WASM memory,
+ * without copies or calls into WASM.  The stream overwrites the oldest
+ * records, so nothing is consumed: each caller keeps its own cursor (a write
+ * count) and reads what arrived since.  When the module is built with shared
+ * memory, the reader can run on another thread, like the TelemetryReader.
+ *
+ *   stream.setupTaps(256, 1, 40);  // 40 mel bands of every frame
+ *   const taps = new TapReader(Module.HEAPU8.buffer, stream.getTapLayout());
+ *   let cursor = 0;
+ *   function draw() {
+ *       cursor = taps.forEachSince(cursor, (frame, tension, features, bins) =>
+ *           drawColumn(frame, bins));
+ *       requestAnimationFrame(draw);
+ *   }
+ */
+
+const WRITE_COUNT = 0;
+const HEADER_SIZE = 5;
+const TENSION_OFFSET = 1;
+const FEATURES_OFFSET = 2;
+
+export class TapReader {
+    /**
+     * @param {ArrayBuffer|SharedArrayBuffer} buffer - The module memory.
+     * @param {Object} layout - From SonicStream.getTapLayout().
+     */
+    constructor(buffer, layout) {
+        this.layout = layout;
+        this.attach(buffer);
+    }
+
+    /**
+     * Rebuild the views, e.g. after the (unshared) WASM memory has grown and
+     * detached the old buffer.
+     * @param {ArrayBuffer|SharedArrayBuffer} buffer - The module memory.
+     */
+    attach(buffer) {
+        const { capacity, recordSize } = this.layout;
+        this.header = new Uint32Array(buffer, this.layout.headerOffset,
+                                      HEADER_SIZE);
+        this.records = new Float32Array(buffer, this.layout.recordsOffset,
+                                        capacity * recordSize);
+    }
+
+    /** @returns {boolean} Whether memory growth has detached the views. */
+    get detached() {
+        return this.header.length === 0;
+    }
+
+    /** @returns {number} The number of records written so far. */
+    get cursor() {
+        return Atomics.load(this.header, WRITE_COUNT);
+    }
+
+    /**
+     * Visit the records written since cursor, oldest first.  If more than
+     * capacity records arrived, the older ones were overwritten and are
+     * skipped.
+     * @param {number} cursor - A value returned by cursor or forEachSince.
+     * @param {function(number, number, Float32Array, Float32Array)} onRecord -
+     *     Called with the frame index, tension, features and bins of each
+     *     record.  The arrays are views of WASM memory, only valid during the
+     *     call (and, with the stream on another thread, only while it is
+     *     less than capacity records ahead; copy them if that matters).
+     * @returns {number} The cursor to pass next time.
+     */
+    forEachSince(cursor, onRecord) {
+        const { capacity, recordSize, featureCount } = this.layout;
+        const write = Atomics.load(this.header, WRITE_COUNT);
+        const mask = capacity - 1;
+        let read = ((write - cursor) >>> 0) > capacity ?
+            (write - capacity) >>> 0 : cursor;
+        for (; read !== write; read = (read + 1) >>> 0) {
+            const offset = (read & mask) * recordSize;
+            const frame = this.records[offset];
+            const tension = this.records[offset + TENSION_OFFSET];
+            const features = this.records.subarray(
+                offset + FEATURES_OFFSET, offset + FEATURES_OFFSET + featureCount);
+            const bins = this.records.subarray(
+                offset + FEATURES_OFFSET + featureCount, offset + recordSize);
+            // With the stream on another thread, it may have started to
+            // overwrite this record while we were reading it.
+            if (((Atomics.load(this.header, WRITE_COUNT) - read) >>> 0) >=
+                capacity) {
+                continue;
+            }
+            onRecord(frame, tension, features, bins);
+        }
+        return write;
+    }
+}
@@ -0,0 +1,135 @@
+/**
+ * Speedy telemetry reader.
+ *
+ * Reads the per-frame (frame, tension, speed) records that a SonicStream
+ * collects after setupTelemetry(), straight from WASM memory, without calling
+ * into WASM.  When the module is built with shared memory, the reader can run
+ * on another thread (e.g. the UI thread, with the stream in a worker): post it
+ * the memory buffer and the stream's getTelemetryLayout().
+ *
+ *   stream.setupTelemetry(4096);
+ *   const reader = new TelemetryReader(Module.HEAPU8.buffer,
+ *                                      stream.getTelemetryLayout());
+ *   reader.read((frame, tension, speed) => plot(frame, tension, speed));
+ *
+ * Without shared memory, a TelemetryWriter can forward the records into a
+ * SharedArrayBuffer with the same layout (createTelemetryBuffer), which a
+ * TelemetryReader on another thread reads the same way.  The streaming
+ * AudioWorklet (speedy-worklet.js) does this, so the audio thread never
+ * posts messages.
+ */
+
+const WRITE_COUNT = 0;
+const READ_COUNT = 1;
+const CAPACITY = 2;
+const DROPPED = 3;
+const HEADER_SIZE = 4;
+const RECORD_SIZE = 3;
+
+export class TelemetryReader {
+    /**
+     * @param {ArrayBuffer|SharedArrayBuffer} buffer - The module memory.
+     * @param {Object} layout - From SonicStream.getTelemetryLayout().
+     */
+    constructor(buffer, layout) {
+        this.layout = layout;
+        this.attach(buffer);
+    }
+
+    /**
+     * Rebuild the views, e.g. after the (unshared) WASM memory has grown and
+     * detached the old buffer.
+     * @param {ArrayBuffer|SharedArrayBuffer} buffer - The module memory.
+     */
+    attach(buffer) {
+        this.header = new Uint32Array(buffer, this.layout.headerOffset,
+                                      HEADER_SIZE);
+        this.records = new Float32Array(buffer, this.layout.recordsOffset,
+                                        this.layout.capacity * RECORD_SIZE);
+    }
+
+    /** @returns {boolean} Whether memory growth has detached the views. */
+    get detached() {
+        return this.header.length === 0;
+    }
+
+    /** @returns {number} Records dropped because the ring was full. */
+    get dropped() {
+        return Atomics.load(this.header, DROPPED);
+    }
+
+    /**
+     * Consume all waiting records, oldest first.
+     * @param {function(number, number, number)} onRecord - Called with the
+     *     frame index, tension and speed of each record.
+     * @returns {number} The number of records read.
+     */
+    read(onRecord) {
+        const write = Atomics.load(this.header, WRITE_COUNT);
+        let read = Atomics.load(this.header, READ_COUNT);
+        const mask = Atomics.load(this.header, CAPACITY) - 1;
+        const count = (write - read) >>> 0;
+        for (let i = 0; i < count; i++, read = (read + 1) >>> 0) {
+            const offset = (read & mask) * RECORD_SIZE;
+            onRecord(this.records[offset], this.records[offset + 1],
+                     this.records[offset + 2]);
+        }
+        Atomics.store(this.header, READ_COUNT, read);
+        return count;
+    }
+}
+
+/**
+ * Allocate a telemetry ring in a SharedArrayBuffer.
+ * @param {number} capacity - Records, rounded up to a power of two.
+ * @returns {{buffer: SharedArrayBuffer, layout: Object}} For a
+ *     TelemetryReader or TelemetryWriter on any thread.
+ */
+export function createTelemetryBuffer(capacity) {
+    let rounded = 1;
+    while (rounded < capacity) {
+        rounded *= 2;
+    }
+    const recordsOffset = HEADER_SIZE * Uint32Array.BYTES_PER_ELEMENT;
+    const buffer = new SharedArrayBuffer(
+        recordsOffset + rounded * RECORD_SIZE * Float32Array.BYTES_PER_ELEMENT);
+    new Uint32Array(buffer, 0, HEADER_SIZE)[CAPACITY] = rounded;
+    return {
+        buffer,
+        layout: { headerOffset: 0, recordsOffset, capacity: rounded }
+    };
+}
+
+export class TelemetryWriter {
+    /**
+     * @param {SharedArrayBuffer} buffer - From createTelemetryBuffer().
+     * @param {Object} layout - From createTelemetryBuffer().
+     */
+    constructor(buffer, layout) {
+        this.header = new Uint32Array(buffer, layout.headerOffset, HEADER_SIZE);
+        this.records = new Float32Array(buffer, layout.recordsOffset,
+                                        layout.capacity * RECORD_SIZE);
+        this.push = this.push.bind(this);   // Usable as a read() callback
+    }
+
+    /**
+     * Append a record, or count it as dropped if the ring is full.
+     * @param {number} frame
+     * @param {number} tension
+     * @param {number} speed
+     */
+    push(frame, tension, speed) {
+        const write = Atomics.load(this.header, WRITE_COUNT);
+        const read = Atomics.load(this.header, READ_COUNT);
+        const capacity = this.header[CAPACITY];
+        if (((write - read) >>> 0) >= capacity) {
+            Atomics.add(this.header, DROPPED, 1);
+            return;
+        }
+        const offset = (write & (capacity - 1)) * RECORD_SIZE;
+        this.records[offset] = frame;
+        this.records[offset + 1] = tension;
+        this.records[offset + 2] = speed;
+        Atomics.store(this.header, WRITE_COUNT, (write + 1) >>> 0);
+    }
+}
@@ -0,0 +1,193 @@
+/**
+ * Speedy streaming AudioWorklet processor.
+ *
+ * Plays audio pushed into a SpeedyRingBuffer from another thread through a
+ * SonicStream, at a speed set from the main thread.  Nothing is allocated or
+ * posted on the audio thread once it is running:
+ *
+ * - Input is read from the ring straight into WASM memory: in place when the
+ *   module memory is shared (the ring then lives in it, see
+ *   SonicStream.setupInputRing), otherwise with one copy per span from a
+ *   SharedArrayBuffer ring into the stream's input staging buffer.
+ * - Output is deinterleaved in WASM (readPlanarOutput) and copied to each
+ *   output channel with one TypedArray.set().
+ * - Telemetry (frame, tension, speed) goes to a TelemetryReader on the main
+ *   thread through a SharedArrayBuffer ring, not postMessage.
+ *
+ * AudioWorklets can't fetch, so compile the module on the main thread and
+ * pass it in:
+ *
+ *   import { SpeedyRingBuffer } from './dist/speedy-ring.js';
+ *   import { createTelemetryBuffer, TelemetryReader } from
+ *       './dist/speedy-telemetry.js';
+ *
+ *   await context.audioWorklet.addModule('./dist/speedy-worklet.js');
+ *   const wasmModule = await WebAssembly.compileStreaming(
+ *       fetch('./dist/speedy.wasm'));
+ *   const ring = SpeedyRingBuffer.create(context.sampleRate, 2);
+ *   const telemetry = createTelemetryBuffer(1024);
+ *   const node = new AudioWorkletNode(context, 'speedy-processor', {
+ *       outputChannelCount: [2],
+ *       processorOptions: {
+ *           channels: 2, wasmModule,
+ *           ring: { buffer: ring.buffer, layout: ring.layout },
+ *           telemetry
+ *       }
+ *   });
+ *   node.port.postMessage({ type: 'setSpeed', payload: 2.0 });
+ *   node.port.postMessage({ type: 'setNonlinear', payload: 1.0 });
+ *   ring.write([left, right]);              // From any thread
+ *   new TelemetryReader(telemetry.buffer, telemetry.layout).read(plot);
+ *
+ * Leave out ring with a shared-memory module: the processor then sets up the
+ * ring in WASM memory and sends its {buffer, layout} in the 'ready' message.
+ */
+
+import initSpeedy from './speedy.js';
+import { SpeedyRingBuffer } from './speedy-ring.js';
+import { TelemetryReader, TelemetryWriter } from './speedy-telemetry.js';
+
+// Most input samples per channel written to the stream in one quantum.
+const DEFAULT_MAX_INPUT = 4096;
+// Samples per channel of each process() call.
+const RENDER_QUANTUM = 128;
+
+class SpeedyProcessor extends AudioWorkletProcessor {
+    constructor(options) {
+        super();
+        const opts = options.processorOptions || {};
+        this.channels = opts.channels || 1;
+        this.maxInput = opts.maxInput || DEFAULT_MAX_INPUT;
+        this.ring = opts.ring ?
+            new SpeedyRingBuffer(opts.ring.buffer, opts.ring.layout) : null;
+        this.telemetryWriter = opts.telemetry ?
+            new TelemetryWriter(opts.telemetry.buffer, opts.telemetry.layout) :
+            null;
+        this.module = null;
+        this.stream = null;
+        this.ready = false;
+        this.port.onmessage = (event) => this.handleMessage(event.data);
+        this.init(opts).catch((e) => {
+            this.port.postMessage({ type: 'error', message: e.toString() });
+        });
+    }
+
+    async init(opts) {
+        const moduleOptions = {};
+        if (opts.wasmModule) {
+            moduleOptions.instantiateWasm = (imports, receiveInstance) => {
+                WebAssembly.instantiate(opts.wasmModule, imports)
+                    .then((instance) => receiveInstance(instance, opts.wasmModule));
+                return {};
+            };
+        }
+        const module = await initSpeedy(moduleOptions);
+        const stream = new module.SonicStream(sampleRate, this.channels);
+        stream.setStagingBufferSize(this.maxInput);
+        this.module = module;
+        this.stream = stream;
+        const ready = { type: 'ready' };
+
+        const shared = typeof SharedArrayBuffer !== 'undefined' &&
+            module.HEAPU8.buffer instanceof SharedArrayBuffer;
+        if (!this.ring) {
+            if (!shared) {
+                throw new Error('Pass a SpeedyRingBuffer: the module memory ' +
+                                'is not shared');
+            }
+            stream.setupInputRing(opts.ringCapacity || sampleRate);
+            this.wasmRing = true;
+            ready.ring = { buffer: module.HEAPU8.buffer,
+                           layout: stream.getInputRingLayout() };
+        }
+        stream.setupTelemetry(opts.telemetryCapacity || 1024);
+        if (shared && !this.telemetryWriter) {
+            // The main thread reads the stream's own ring.
+            ready.telemetry = { buffer: module.HEAPU8.buffer,
+                                layout: stream.getTelemetryLayout() };
+        } else if (this.telemetryWriter) {
+            this.telemetryReader = new TelemetryReader(
+                module.HEAPU8.buffer, stream.getTelemetryLayout());
+        }
+        this.attachViews();
+        this.ready = true;
+        this.port.postMessage(ready);
+    }
+
+    // (Re)build the views of WASM memory, which growth detaches when the
+    // memory isn't shared.
+    attachViews() {
+        const stream = this.stream;
+        this.inputView = this.wasmRing ? null : stream.getInputBuffer();
+        // One render quantum of each channel, so a full quantum is copied
+        // without making a new view.
+        const planar = stream.getPlanarOutputBuffer();
+        const stride = stream.stagingBufferSize();
+        this.planes = [];
+        for (let c = 0; c < this.channels; c++) {
+            this.planes.push(planar.subarray(c * stride,
+                                             c * stride + RENDER_QUANTUM));
+        }
+        if (this.telemetryReader) {
+            this.telemetryReader.attach(this.module.HEAPU8.buffer);
+        }
+    }
+
+    handleMessage(message) {
+        if (!this.ready) {
+            return;
+        }
+        const { type, payload } = message;
+        switch (type) {
+            case 'setSpeed':
+                this.stream.setSpeed(payload);
+                break;
+            case 'setPitch':
+                this.stream.setRate(payload);
+                break;
+            case 'setNonlinear':
+                this.stream.enableNonlinearSpeedup(payload);
+                break;
+            case 'flush':
+                this.stream.flushStream();
+                break;
+        }
+    }
+
+    process(inputs, outputs) {
+        if (!this.ready) {
+            return true;
+        }
+        const stream = this.stream;
+        if (this.planes[0].length === 0) {
+            this.attachViews();
+        }
+
+        if (this.wasmRing) {
+            stream.pullInputRing(this.maxInput);
+        } else if (this.ring.available > 0) {
+            const count = this.ring.copyTo(this.inputView, this.maxInput);
+            stream.writeInputBuffer(count);
+        }
+
+        const output = outputs[0];
+        const samplesRead = stream.readPlanarOutput(output[0].length);
+        if (this.planes[0].length === 0) {   // The calls grew memory
+            this.attachViews();
+        }
+        for (let c = 0; c < output.length && c < this.channels; c++) {
+            if (samplesRead === RENDER_QUANTUM) {
+                output[c].set(this.planes[c]);
+            } else if (samplesRead > 0) {   // Underrun: the rest stays silent
+                output[c].set(this.planes[c].subarray(0, samplesRead));
+            }
+        }
+
+        if (this.telemetryReader) {
+            this.telemetryReader.read(this.telemetryWriter.push);
+        }
+        return true;
+    }
+}
+
+registerProcessor('speedy-processor', SpeedyProcessor);
@@ -33,6 +33,7 @@ extern "C" {
  */
 #define  SONIC_INTERNAL 1
 #include "sonic.h"
+#include "speedy.h"
 
 /* Note we are undef'ing only the following sumbols because we redefine them
  * in this file. */
@@ -71,6 +72,20 @@ void sonicSetRate(sonicStream mySonicStream, float rate);
 void sonicSetSpeed(sonicStream mySonicStream, float rate);
 int sonicFlushStream(sonicStream mySonicStream);
 
+/* Seek without recreating the stream: all buffered input and output is
+ * dropped and the speedy analysis restarts, reusing every allocation.
+ * frameIndex is the frame (of getSonicBufferSize() samples) where the next
+ * write starts, which is also the position in a tension track and the time
+ * given to the callbacks.  If checkpoint isn't NULL, the speedy filters and
+ * duration feedback restart from it (e.g. one saved with
+ * sonicGetSpeedyCheckpoint() when playback last passed this point) instead of
+ * from their defaults, which avoids the startup transient.
+ */
+void sonicSeekStream(sonicStream mySonicStream, int frameIndex,
+                     const speedyCheckpoint* checkpoint);
+void sonicGetSpeedyCheckpoint(sonicStream mySonicStream,
+                              speedyCheckpoint* checkpoint);
+
 /* Enable non-linear speedup. Default is 0, which means purely linear speedup.
  * Set to 1.0 to get the standard Speedy non-linear speedup.  Values between
  * 0 and 1 have not been tested, but can give a partial non-linear speedup.
@@ -90,6 +105,60 @@ void sonicEnableNonlinearSpeedup(sonicStream mySonicStream,
  * be a good compromise, providing a .1 speedup for every 1s of excess duration.
  */
 void sonicSetDurationFeedbackStrength(sonicStream mySonicStream, float factor);
+
+/* Play with a precomputed tension track (one value per speedy frame, for
+ * example from speedyComputeTensionBatch) instead of analyzing the audio.
+ * Each frame is then sent to SOLA as soon as it is written, with a speed from
+ * speedyComputeSpeedFromTension blended by the nonlinear factor, so changing
+ * the speed costs no re-analysis.  Frames past the end of the track get a
+ * tension of 0.  The track is copied.  Pass NULL to go back to analysis.  Call
+ * this before writing any data; returns 0 if the stream already has data or
+ * we are out of memory.
+ */
+int sonicSetTensionTrack(sonicStream mySonicStream, const float* tension,
+                         int frameCount);
+
+/* Like a tension track, but the tensions arrive while playing, e.g. from
+ * speedy analysis running ahead on another thread.  Each complete frame waits
+ * until the source returns 1 with its tension, for at most
+ * kTensionSourceBufferSize frames; after that the oldest frame is played with
+ * a tension of 0 rather than overflow.  The source is called with frame
+ * indices that never decrease (asking again for a frame it could not supply
+ * yet) and owns any locking, so keep it cheap and non-blocking.  Pass NULL to
+ * go back to analysis.  Call this before writing any data; returns 0 if the
+ * stream already has data.
+ */
+#define kTensionSourceBufferSize (4*(2+kTemporalHysteresisFuture))
+typedef int (*tensionSourceFunction)(sonicStream myStream, int frameIndex,
+                                     float* tension);
+int sonicSetTensionSource(sonicStream mySonicStream,
+                          tensionSourceFunction source);
+
+/* Analyze a mono signal decimated to about kSpeedyAnalysisRate (16 kHz), with
+ * a power of two FFT (see speedyCreatePowerOfTwoStream), instead of the full
+ * rate signal.  This cuts the analysis cost several times at 44.1 and 48 kHz;
+ * the tensions are close to, but not the same as, the full rate ones.  At or
+ * below 16 kHz only the FFT size changes.  The playback rate is unchanged.
+ * The tuning parameters, lookahead and silence gate are kept.  Call this
+ * before writing any data; returns 0 if the stream already has data or we are
+ * out of memory.
+ */
+int sonicEnableDecimatedAnalysis(sonicStream mySonicStream);
+/* Set how many frames ahead the speedy analysis looks, in [0,
+ * kTemporalHysteresisFuture] (the default); see speedySetLookahead.  Fewer
+ * frames lower the latency at some cost in how early the speed reacts.  The
+ * shim also waits for a full speedy window, so a lookahead shorter than the
+ * window only changes the tensions.  Call this before writing any data;
+ * returns 0 if the stream already has data or frames is out of range.  It is
+ * kept by sonicEnableDecimatedAnalysis.
+ */
+int sonicSetSpeedyLookahead(sonicStream mySonicStream, int frames);
+int sonicGetSpeedyLookahead(sonicStream mySonicStream);
+/* How many input samples the shim holds back before libsonic sees them: 0
+ * with linear speedup, a frame with a tension track, and the most a tension
+ * source may wait.  libsonic adds its own (pitch period) latency on top.
+ */
+int sonicGetSpeedyLatency(sonicStream mySonicStream);
 void sonicSetSpeedyPreemphasisFactor(sonicStream mySonicStream, float factor);
 void sonicSetSpeedyLowEnergyThresholdScale(sonicStream mySonicStream,
                                            float scale);
@@ -101,6 +170,24 @@ void sonicSetSpeedyTensionOffsets(sonicStream mySonicStream,
                                   float energy_offset, float speech_offset);
 void sonicSetSpeedySpeechChangeCapMultiplier(sonicStream mySonicStream,
                                              float multiplier);
+/* Skip the FFT of silent frames (see speedySetSilenceGate).  Off by default;
+ * worth turning on for long-form speech, which is often a third pauses.  Call
+ * this before writing any data.
+ */
+void sonicSetSpeedySilenceGate(sonicStream mySonicStream, int enabled);
+int sonicGetSpeedySilenceGate(sonicStream mySonicStream);
+/* Get the speedy tuning set above (see speedyGetTuningParameters). */
+void sonicGetSpeedyTuningParameters(
+    sonicStream mySonicStream, float parameters[kSpeedyTuningParameterCount]);
+
+/* Get the stream's per-stage cost counters (see speedyStats): the speedy
+ * stages from its analysis, plus the time spent in libsonic's SOLA, the frames
+ * played without a tension and the ring high-water mark.  Returns 0 (and
+ * zeros) unless built with SPEEDY_STATS.  The counters survive seeks; reset
+ * them with sonicResetSpeedyStats().
+ */
+int sonicGetSpeedyStats(sonicStream mySonicStream, speedyStats* stats);
+void sonicResetSpeedyStats(sonicStream mySonicStream);
 
 /* Return the size of the internal buffers.  This is needed for the callback
  * functions, which return time in buffer counts.
@@ -110,8 +197,13 @@ int getSonicBufferSize(sonicStream mySonicStream);
 
 /* Monitoring status. The time parameter in the callback is the index of
  * internal buffer counts, each buffer has getSonicBufferSize() monaural
- * samples.
+ * samples.  The callbacks can find their own state through the callback user
+ * data, rather than with a global lookup.  (The libsonic user data is used by
+ * this library.)
  */
+void sonicSetCallbackUserData(sonicStream mySonicStream, void* userData);
+void* sonicGetCallbackUserData(sonicStream mySonicStream);
+
 typedef void (*tensionFunction)(sonicStream myStream, int time, float tension);
 void sonicTensionCallback(sonicStream mySonicStream, tensionFunction);
 tensionFunction getSonicTensionCallback(sonicStream mySonicStream);
@@ -134,6 +226,11 @@ void sonicNormalizedSpectrogramCallback(sonicStream mySonicStream,
 spectrogramFunction getSonicNormalizedSpectrogramCallback(
     sonicStream mySonicStream);
 int sonicSpectrogramSize(sonicStream mySonicStream);  /* For debugging */
+/* The speedy analysis FFT size and the frequency of a spectrogram bin, which
+ * change with decimated analysis.
+ */
+int sonicSpeedyFFTSize(sonicStream mySonicStream);
+float sonicSpeedyBinToFreq(sonicStream mySonicStream, int bin);
 
 #ifdef __cplusplus
 }
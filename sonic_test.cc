@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <cmath>
+#include <limits>
 #include <numeric>
 
 #include "dynamic_time_warping.h"
@@ -279,8 +280,10 @@ std::vector<int16_t> ReadWaveFile(const std::string& fileName, int* sampleRate,
   EXPECT_TRUE(fp);
   int numRead;
   do {
-    numRead = readFromWaveFile(fp, buffer, kBufferSize);
-    outputVector.insert(outputVector.end(), buffer, buffer+numRead);
+    // readFromWaveFile counts multi-channel samples.
+    numRead = readFromWaveFile(fp, buffer, kBufferSize / *numChannels);
+    outputVector.insert(outputVector.end(), buffer,
+                        buffer + numRead * *numChannels);
   } while (numRead > 0);
   closeWaveFile(fp);
   return outputVector;
@@ -636,6 +639,39 @@ TEST_F(Sonic2Test, TestWithFloatSinusoids) {
   ASSERT_LT(sqrt(compressed_variance)/compressed_mean, 0.01);
 }
 
+/* Float input is stored as floats (picked by the first write), so the analysis
+ * of a float signal should track that of the same signal written as shorts.
+ */
+TEST_F(Sonic2Test, TestFloatStorageMatchesShort) {
+  constexpr int kNumChannels = 2;
+  constexpr int matchingChannels = 1;
+  constexpr float kSpeed = 2.0;
+  constexpr int kSampleRate = 22050;
+  auto sinusoid = CreateSinusoidTest(kSampleRate, kNumChannels,
+                                     matchingChannels, 1.0);
+  std::vector<float> float_sinusoid;
+  for (int16_t sample : sinusoid) {
+    float_sinusoid.push_back(sample/32768.0);
+  }
+
+  Initialize(kSampleRate, kNumChannels);
+  auto short_result = TimeCompressVector(stream_, sinusoid, kSpeed, 1.0);
+  std::vector<float> short_tension = savedTensionVector;
+  Reset();
+
+  Initialize(kSampleRate, kNumChannels);
+  savedTensionVector.clear();
+  auto float_result = TimeCompressFloatVector(stream_, float_sinusoid, kSpeed,
+                                              1.0);
+  ASSERT_GT(short_tension.size(), 0);
+  ASSERT_EQ(savedTensionVector.size(), short_tension.size());
+  for (int i = 0; i < short_tension.size(); i++) {
+    EXPECT_NEAR(savedTensionVector[i], short_tension[i], 1e-4) << "Frame " << i;
+  }
+  EXPECT_NEAR(float_result.size(), short_result.size(),
+              0.01*short_result.size());
+}
+
 /* Test basic speech speedup (comparing both linear and nonlinear).
  */
 TEST_F(Sonic2Test, TestSpeechSample) {
@@ -723,6 +759,383 @@ TEST_F(Sonic2Test, TestSpeechSample) {
   EXPECT_LT(VectorStandardDeviation(speedy_slopes), 0.2);
 }
 
+/* Play speech with a tension track computed by the batch analysis.  Every frame
+ * should get its tension from the track, and the overall speedup should be
+ * what we asked for, as it is with the live analysis.
+ */
+TEST_F(Sonic2Test, TestTensionTrack) {
+  std::string inputFileName =
+      ::testing::SrcDir() +
+      "test_data/tapestry.wav";
+  int channelCount, sampleRate;
+  auto original_samples = ReadWaveFile(inputFileName,
+                                       &sampleRate, &channelCount);
+  ASSERT_EQ(channelCount, 1);
+  constexpr float kSpeed = 2.0;
+
+  std::vector<float> float_samples;
+  for (int16_t sample : original_samples) {
+    float_samples.push_back(sample/32768.0);
+  }
+  speedyStream speedy = speedyCreateStream(sampleRate);
+  std::vector<float> track(speedyBatchFrameCount(speedy, float_samples.size()));
+  ASSERT_GT(track.size(), 0);
+  ASSERT_TRUE(speedyComputeTensionBatch(speedy, &float_samples[0],
+                                        float_samples.size(), &track[0],
+                                        nullptr, 1));
+  speedyDestroyStream(speedy);
+
+  Initialize(sampleRate, channelCount);
+  auto analyzed_samples = TimeCompressVector(stream_, original_samples,
+                                             kSpeed, 1.0);
+  // Too late to set a track once the stream has data.
+  EXPECT_FALSE(sonicSetTensionTrack(stream_, &track[0], track.size()));
+  Reset();
+
+  Initialize(sampleRate, channelCount);
+  ASSERT_TRUE(sonicSetTensionTrack(stream_, &track[0], track.size()));
+  auto track_samples = TimeCompressVector(stream_, original_samples,
+                                          kSpeed, 1.0);
+  ASSERT_GE(savedTensionVector.size(), track.size());
+  for (int i = 0; i < track.size(); i++) {
+    EXPECT_EQ(savedTensionVector[i], track[i]) << "Frame " << i;
+  }
+  EXPECT_NEAR(track_samples.size(), original_samples.size()/kSpeed,
+              0.1*original_samples.size()/kSpeed);
+  EXPECT_NEAR(track_samples.size(), analyzed_samples.size(),
+              0.05*analyzed_samples.size());
+}
+
+// A tension source that knows a track, but only hands out the tensions of
+// frames at least sourceDelay frames older than the input written so far,
+// like analysis running behind on another thread.
+std::vector<float> sourceTrack;
+int sourceFrameStep, sourceDelay, sourceWrittenFrames;
+
+int delayedTrackSource(sonicStream stream, int frameIndex, float* tension) {
+  if (frameIndex + sourceDelay > sourceWrittenFrames ||
+      frameIndex >= sourceTrack.size()) {
+    return 0;
+  }
+  *tension = sourceTrack[frameIndex];
+  return 1;
+}
+
+// Write the samples through a delayed tension source and return the number of
+// samples read back.
+int TimeCompressWithSource(sonicStream stream,
+                           const std::vector<int16_t>& input, float speed,
+                           int delay) {
+  constexpr int kBufferSize = 128;
+  int16_t output[kBufferSize];
+  sourceDelay = delay;
+  sourceWrittenFrames = 0;
+  EXPECT_TRUE(sonicSetTensionSource(stream, delayedTrackSource));
+  sonicSetSpeed(stream, speed);
+  sonicEnableNonlinearSpeedup(stream, 1.0);
+  sonicTensionCallback(stream, saveTension);
+  savedTensionVector.clear();
+  int sample_count = 0;
+  for (int t = 0; t < input.size(); t += kBufferSize) {
+    int count = std::min<int>(kBufferSize, input.size() - t);
+    sourceWrittenFrames = (t + count)/sourceFrameStep;
+    EXPECT_TRUE(sonicWriteShortToStream(stream, &input[t], count));
+    sample_count += sonicReadShortFromStream(stream, output, kBufferSize);
+  }
+  EXPECT_TRUE(sonicFlushStream(stream));
+  int samples_read;
+  while ((samples_read = sonicReadShortFromStream(stream, output,
+                                                  kBufferSize)) > 0) {
+    sample_count += samples_read;
+  }
+  return sample_count;
+}
+
+/* Frames should wait for a late tension source, up to a limit. */
+TEST_F(Sonic2Test, TestTensionSource) {
+  std::string inputFileName =
+      ::testing::SrcDir() +
+      "test_data/tapestry.wav";
+  int channelCount, sampleRate;
+  auto original_samples = ReadWaveFile(inputFileName,
+                                       &sampleRate, &channelCount);
+  ASSERT_EQ(channelCount, 1);
+  constexpr float kSpeed = 2.0;
+  constexpr int kDelay = 20;
+
+  std::vector<float> float_samples;
+  for (int16_t sample : original_samples) {
+    float_samples.push_back(sample/32768.0);
+  }
+  speedyStream speedy = speedyCreateStream(sampleRate);
+  sourceTrack.resize(speedyBatchFrameCount(speedy, float_samples.size()));
+  ASSERT_GT(sourceTrack.size(), kDelay);
+  ASSERT_TRUE(speedyComputeTensionBatch(speedy, &float_samples[0],
+                                        float_samples.size(), &sourceTrack[0],
+                                        nullptr, 1));
+  sourceFrameStep = speedyInputFrameStep(speedy);
+  speedyDestroyStream(speedy);
+
+  // A source within the buffering gives every frame its own tension.
+  Initialize(sampleRate, channelCount);
+  int source_count = TimeCompressWithSource(stream_, original_samples, kSpeed,
+                                            kDelay);
+  ASSERT_GE(savedTensionVector.size(), sourceTrack.size() - kDelay);
+  for (int i = 0; i < savedTensionVector.size(); i++) {
+    ASSERT_EQ(savedTensionVector[i], sourceTrack[i]) << "Frame " << i;
+  }
+  EXPECT_NEAR(source_count, original_samples.size()/kSpeed,
+              0.1*original_samples.size()/kSpeed);
+  // Too late to set a source once the stream has data.
+  EXPECT_FALSE(sonicSetTensionSource(stream_, nullptr));
+  Reset();
+
+  // One that never keeps up still plays everything, at the average tension.
+  Initialize(sampleRate, channelCount);
+  int late_count = TimeCompressWithSource(stream_, original_samples, kSpeed,
+                                          std::numeric_limits<int>::max()/2);
+  ASSERT_GT(savedTensionVector.size(), 0);
+  for (float tension : savedTensionVector) {
+    ASSERT_EQ(tension, 0.0);
+  }
+  EXPECT_NEAR(late_count, original_samples.size()/kSpeed,
+              0.1*original_samples.size()/kSpeed);
+}
+
+/* Seeking an existing stream should give the same analysis as a new stream,
+ * both back to the start and into the middle of the sound.
+ */
+TEST_F(Sonic2Test, TestSeek) {
+  std::string inputFileName =
+      ::testing::SrcDir() +
+      "test_data/tapestry.wav";
+  int channelCount, sampleRate;
+  auto original_samples = ReadWaveFile(inputFileName,
+                                       &sampleRate, &channelCount);
+  ASSERT_EQ(channelCount, 1);
+  constexpr float kSpeed = 2.0;
+  constexpr int kSeekFrame = 100;
+
+  Initialize(sampleRate, channelCount);
+  auto first_samples = TimeCompressVector(stream_, original_samples,
+                                          kSpeed, 1.0);
+  std::vector<float> first_tension = savedTensionVector;
+  const int frame_size = getSonicBufferSize(stream_);
+  ASSERT_GT(frame_size, 0);
+
+  sonicSeekStream(stream_, 0, NULL);
+  auto second_samples = TimeCompressVector(stream_, original_samples,
+                                           kSpeed, 1.0);
+  ASSERT_EQ(savedTensionVector.size(), first_tension.size());
+  for (int i = 0; i < first_tension.size(); i++) {
+    ASSERT_EQ(savedTensionVector[i], first_tension[i]) << "Frame " << i;
+  }
+  EXPECT_NEAR(second_samples.size(), first_samples.size(),
+              0.01*first_samples.size());
+
+  // Seek into the middle of the sound, and compare with a new stream that
+  // starts there.
+  std::vector<int16_t> rest(original_samples.begin() + kSeekFrame*frame_size,
+                            original_samples.end());
+  speedyCheckpoint checkpoint;
+  sonicGetSpeedyCheckpoint(stream_, &checkpoint);
+  sonicSeekStream(stream_, kSeekFrame, NULL);
+  TimeCompressVector(stream_, rest, kSpeed, 1.0);
+  std::vector<float> seek_tension = savedTensionVector;
+  Reset();
+  Initialize(sampleRate, channelCount);
+  TimeCompressVector(stream_, rest, kSpeed, 1.0);
+  ASSERT_EQ(savedTensionVector.size(), seek_tension.size());
+  for (int i = 0; i < seek_tension.size(); i++) {
+    ASSERT_EQ(savedTensionVector[i], seek_tension[i]) << "Frame " << i;
+  }
+
+  // A checkpoint carries the filter state across the seek.
+  sonicSeekStream(stream_, kSeekFrame, &checkpoint);
+  speedyCheckpoint restored;
+  sonicGetSpeedyCheckpoint(stream_, &restored);
+  EXPECT_EQ(restored.energy_lp, checkpoint.energy_lp);
+  EXPECT_EQ(restored.emphasis_weighted_lpf, checkpoint.emphasis_weighted_lpf);
+  EXPECT_EQ(restored.current_duration, checkpoint.current_duration);
+  EXPECT_EQ(restored.desired_duration, checkpoint.desired_duration);
+}
+
+// Count the speed callbacks through the callback user data.
+void countSpeedCallsInUserData(sonicStream stream, int time, float speed) {
+  (*static_cast<int*>(sonicGetCallbackUserData(stream)))++;
+}
+
+/* Each stream's callbacks should see that stream's own user data. */
+TEST_F(Sonic2Test, TestCallbackUserData) {
+  constexpr int kSampleRate = 22050;
+  auto sinusoid = CreateSinusoidTest(kSampleRate, 1, 1, 1.0);
+  Initialize(kSampleRate, 1);
+  EXPECT_EQ(sonicGetCallbackUserData(stream_), nullptr);
+  int first_count = 0, second_count = 0;
+  sonicSetCallbackUserData(stream_, &first_count);
+  sonicStream second_stream = sonicCreateStream(kSampleRate, 1);
+  sonicSetCallbackUserData(second_stream, &second_count);
+  for (sonicStream stream : {stream_, second_stream}) {
+    sonicSetSpeed(stream, 2.0);
+    sonicEnableNonlinearSpeedup(stream, 1.0);
+    sonicSpeedCallback(stream, countSpeedCallsInUserData);
+  }
+  ASSERT_TRUE(sonicWriteShortToStream(stream_, &sinusoid[0], sinusoid.size()));
+  ASSERT_TRUE(sonicWriteShortToStream(second_stream, &sinusoid[0],
+                                      sinusoid.size()/2));
+  EXPECT_GT(first_count, 0);
+  EXPECT_GT(second_count, 0);
+  EXPECT_GT(first_count, second_count);
+  sonicDestroyStream(second_stream);
+}
+
+/* Check the per-stage counters (sonic_test is built with SPEEDY_STATS). */
+TEST_F(Sonic2Test, TestSpeedyStats) {
+  constexpr int kSampleRate = 22050;
+  auto sinusoid = CreateSinusoidTest(kSampleRate, 1, 1, 1.0);
+  Initialize(kSampleRate, 1);
+  sonicSetSpeed(stream_, 2.0);
+  sonicEnableNonlinearSpeedup(stream_, 1.0);
+  ASSERT_TRUE(sonicWriteShortToStream(stream_, &sinusoid[0], sinusoid.size()));
+
+  speedyStats stats;
+#ifndef SPEEDY_STATS
+  EXPECT_FALSE(sonicGetSpeedyStats(stream_, &stats));
+  EXPECT_EQ(stats.stage_calls[kSpeedyStageSola], 0);
+#else
+  ASSERT_TRUE(sonicGetSpeedyStats(stream_, &stats));
+  /* Every analyzed frame runs the AddData stages ... */
+  const int64_t frames = stats.stage_calls[kSpeedyStageSpectrogram];
+  EXPECT_GT(frames, 0);
+  EXPECT_EQ(stats.stage_calls[kSpeedyStagePreemphasis], frames);
+  EXPECT_EQ(stats.stage_calls[kSpeedyStageLocalEnergy], frames);
+  /* ... and each frame with a tension runs the rest, a future window later. */
+  const int64_t tensions = stats.stage_calls[kSpeedyStageHysteresis];
+  EXPECT_LE(tensions, frames);
+  EXPECT_GE(tensions, frames - kTemporalHysteresisFuture);
+  EXPECT_EQ(stats.stage_calls[kSpeedyStageSpectralDifference], tensions);
+  EXPECT_EQ(stats.stage_calls[kSpeedyStageTensionToSpeed], tensions);
+  EXPECT_EQ(stats.stage_calls[kSpeedyStageSola], tensions);
+  for (int stage = 0; stage < kSpeedyStageCount; stage++) {
+    EXPECT_GE(stats.stage_nanoseconds[stage], 0) << "Stage " << stage;
+  }
+  EXPECT_GT(stats.stage_nanoseconds[kSpeedyStageSpectrogram], 0);
+  EXPECT_GE(stats.skipped_frames, 1);     /* The first frame is always skipped */
+  EXPECT_EQ(stats.missing_tension_frames, 0);
+  EXPECT_GE(stats.buffered_frames_high_water, kTemporalHysteresisFuture);
+  EXPECT_LT(stats.buffered_frames_high_water, 2 + kTemporalHysteresisFuture);
+
+  /* Seeks keep the counters, resetting zeroes them. */
+  sonicSeekStream(stream_, 0, nullptr);
+  ASSERT_TRUE(sonicGetSpeedyStats(stream_, &stats));
+  EXPECT_EQ(stats.stage_calls[kSpeedyStageSpectrogram], frames);
+  sonicResetSpeedyStats(stream_);
+  ASSERT_TRUE(sonicGetSpeedyStats(stream_, &stats));
+  for (int stage = 0; stage < kSpeedyStageCount; stage++) {
+    EXPECT_EQ(stats.stage_calls[stage], 0) << "Stage " << stage;
+  }
+  EXPECT_EQ(stats.buffered_frames_high_water, 0);
+#endif
+}
+
+// The tensions from a decimated, power of two FFT analysis should follow the
+// full rate ones.
+TEST_F(Sonic2Test, TestDecimatedAnalysis) {
+  std::string inputFileName =
+      ::testing::SrcDir() +
+      "test_data/capture_1_00x.wav";
+  int channelCount, sampleRate;
+  auto original_samples = ReadWaveFile(inputFileName,
+                                       &sampleRate, &channelCount);
+  ASSERT_EQ(sampleRate, 48000);
+  constexpr float kSpeed = 2.0;
+
+  Initialize(sampleRate, channelCount);
+  auto full_samples = TimeCompressVector(stream_, original_samples, kSpeed,
+                                         1.0);
+  auto full_tensions = savedTensionVector;
+  // Too late to switch once the stream has data.
+  EXPECT_FALSE(sonicEnableDecimatedAnalysis(stream_));
+  Reset();
+
+  Initialize(sampleRate, channelCount);
+  ASSERT_TRUE(sonicEnableDecimatedAnalysis(stream_));
+  speedyStream analysis = speedyCreatePowerOfTwoStream(kSpeedyAnalysisRate);
+  EXPECT_EQ(speedyFFTSize(analysis), 512);
+  EXPECT_EQ(sonicSpectrogramSize(stream_), speedySpectrogramSize(analysis));
+  EXPECT_EQ(sonicSpeedyFFTSize(stream_), 512);
+  EXPECT_FLOAT_EQ(sonicSpeedyBinToFreq(stream_, 256), kSpeedyAnalysisRate/2);
+  speedyDestroyStream(analysis);
+  auto decimated_samples = TimeCompressVector(stream_, original_samples,
+                                              kSpeed, 1.0);
+  auto decimated_tensions = savedTensionVector;
+  ASSERT_EQ(decimated_tensions.size(), full_tensions.size());
+
+  // Correlate the two tension tracks.
+  float full_mean = VectorMean(full_tensions);
+  float decimated_mean = VectorMean(decimated_tensions);
+  double product = 0, full_power = 0, decimated_power = 0;
+  for (int i = 0; i < full_tensions.size(); i++) {
+    float full = full_tensions[i] - full_mean;
+    float decimated = decimated_tensions[i] - decimated_mean;
+    product += full*decimated;
+    full_power += full*full;
+    decimated_power += decimated*decimated;
+  }
+  float correlation = product/sqrt(full_power*decimated_power);
+  LOG(INFO) << "Tension means " << full_mean << " and " << decimated_mean <<
+      ", correlation " << correlation << std::endl;
+  EXPECT_GT(correlation, 0.85);
+  EXPECT_NEAR(decimated_mean, full_mean, 0.1*fabs(full_mean) + 0.05);
+  EXPECT_NEAR(decimated_samples.size(), full_samples.size(),
+              0.05*full_samples.size());
+}
+
+TEST_F(Sonic2Test, TestSpeedyLookahead) {
+  std::string inputFileName =
+      ::testing::SrcDir() +
+      "test_data/tapestry.wav";
+  int channelCount, sampleRate;
+  auto original_samples = ReadWaveFile(inputFileName,
+                                       &sampleRate, &channelCount);
+  constexpr float kSpeed = 2.0;
+  speedyStream speedy = speedyCreateStream(sampleRate);
+  const int frameStep = speedyInputFrameStep(speedy);
+  const int windowFrames = speedyInputFrameSize(speedy)/frameStep;
+  // A frame waits for the first sample past the window lookahead frames on.
+  const int windowExtra = speedyInputFrameSize(speedy) -
+      windowFrames*frameStep + 1;
+  speedyDestroyStream(speedy);
+
+  Initialize(sampleRate, channelCount);
+  EXPECT_EQ(sonicGetSpeedyLookahead(stream_), kTemporalHysteresisFuture);
+  EXPECT_EQ(sonicGetSpeedyLatency(stream_), 0);    // Linear speedup
+  sonicEnableNonlinearSpeedup(stream_, 1.0);
+  EXPECT_EQ(sonicGetSpeedyLatency(stream_),
+            kTemporalHysteresisFuture*frameStep + windowExtra);
+  EXPECT_FALSE(sonicSetSpeedyLookahead(stream_, -1));
+  EXPECT_FALSE(sonicSetSpeedyLookahead(stream_, kTemporalHysteresisFuture+1));
+  auto full_samples = TimeCompressVector(stream_, original_samples, kSpeed,
+                                         1.0);
+  auto full_tensions = savedTensionVector;
+  // Too late to change once the ring is sized.
+  EXPECT_FALSE(sonicSetSpeedyLookahead(stream_, 0));
+  Reset();
+
+  // Shorter lookaheads cut the latency, down to a speedy window.
+  for (int lookahead : {4, 0}) {
+    Initialize(sampleRate, channelCount);
+    ASSERT_TRUE(sonicSetSpeedyLookahead(stream_, lookahead));
+    sonicEnableNonlinearSpeedup(stream_, 1.0);
+    EXPECT_EQ(sonicGetSpeedyLatency(stream_),
+              std::max(lookahead, windowFrames)*frameStep + windowExtra);
+    auto samples = TimeCompressVector(stream_, original_samples, kSpeed, 1.0);
+    EXPECT_GE(savedTensionVector.size(), full_tensions.size());
+    EXPECT_NEAR(samples.size(), full_samples.size(), 0.05*full_samples.size());
+    Reset();
+  }
+}
+
 /* Test the original sonic library to make sure it does the right thing with
  * stereo input.
  */
@@ -947,6 +1360,56 @@ TEST_F(Sonic2Test, TestStereoTapestry) {
 }
 
 
+/* The mono, stereo and generic downmix kernels should all give the analysis
+ * the same signal when the channels average to the mono input, for both
+ * storage types.
+ */
+TEST_F(Sonic2Test, TestDownmixKernels) {
+  constexpr float kSpeed = 2.0;
+  std::string inputFileName =
+      ::testing::SrcDir() + "test_data/tapestry.wav";
+  int channelCount, sampleRate;
+  auto original_samples = ReadWaveFile(inputFileName,
+                                       &sampleRate, &channelCount);
+  ASSERT_EQ(channelCount, 1);
+
+  std::vector<float> mono_tension;
+  for (int channels : {1, 2, 3}) {
+    std::vector<int16_t> samples;
+    std::vector<float> float_samples;
+    for (int16_t sample : original_samples) {
+      for (int k = 0; k < channels; k++) {
+        // Offsets of -50, 0 and +50 that average out.
+        int value = sample + (channels == 1 ? 0 : 100*k/(channels - 1) - 50);
+        samples.push_back(value);
+        float_samples.push_back(value/32768.0);
+      }
+    }
+    Initialize(sampleRate, channels);
+    TimeCompressVector(stream_, samples, kSpeed, 1.0);
+    std::vector<float> short_tension = savedTensionVector;
+    Reset();
+    Initialize(sampleRate, channels);
+    savedTensionVector.clear();
+    TimeCompressFloatVector(stream_, float_samples, kSpeed, 1.0);
+    std::vector<float> float_tension = savedTensionVector;
+    Reset();
+
+    if (channels == 1) {
+      mono_tension = short_tension;
+    }
+    ASSERT_GT(mono_tension.size(), 0);
+    ASSERT_EQ(short_tension.size(), mono_tension.size());
+    ASSERT_EQ(float_tension.size(), mono_tension.size());
+    for (int i = 0; i < mono_tension.size(); i++) {
+      ASSERT_EQ(short_tension[i], mono_tension[i]) << channels <<
+          " channels, frame " << i;
+      ASSERT_NEAR(float_tension[i], mono_tension[i], 1e-4) << channels <<
+          " channels, frame " << i;
+    }
+  }
+}
+
 // Now test Sonic2 with changing speeds.  Make sure the expected output length
 // matches the expected within a small number of pitch periods.  The expected
 // length is the sum of the current input_buffer size divided by the current
@@ -13,11 +13,16 @@
 // limitations under the License.
 
 #include <assert.h>
+#include <math.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "sonic2.h"
 #include "speedy.h"
+#ifdef  __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
 
 /*
  * Replace original libSonic with this shim to allow non-linear speedups of
@@ -48,16 +53,26 @@
  * Fill from the top, pulling data from the bottom. These indices all point to a
  * set of circular buffers, so mod by bufferCount to get the actual buffer
  * index.  (i.e. the indices above grow continuously, and are never reset to
- * zero.)
+ * zero.)  The buffers are one contiguous ring, sized for the frames that are
+ * in flight (see sonicAnalysisDelayFrames), not for the size of the writes.  Each frame
+ * is drained to libsonic as soon as its tension is known, so a write of any
+ * length passes through the ring incrementally.
  *
  * To manage all of this, this library keeps buffers of size 1/frameRate. The
  * speedy analysis code wants 50% overlap, so when ready the buffer we pass to
  * speedy has size 1.5/frameRate.
  *
+ * The buffers hold either shorts or floats, picked by the type of the first
+ * write call, so float input reaches speedy (and libsonic) without being
+ * quantized to 16 bits.  Later writes of the other type are converted.
+ *
  * TODO(malcolmslaney)
  *   1) Put some functionality in for sonicFreeSpace
  *   2) Remove debug prints
  */
+struct sonicDecimatorStruct;  /* Defined below */
+typedef struct sonicDecimatorStruct* sonicDecimator;
+
 struct speedyConnectionStruct {
   speedyStream mySpeedyStream;
   float globalSpeed;            /* Set by user request */
@@ -65,11 +80,28 @@ struct speedyConnectionStruct {
   float speedyDurationFeedbackStrength; /* How quick to feedback excess duration */
   float sampleRate;
   int channelCount;             /* Number of channels >= 1 */
+  /* Stored samples to mono analysis floats, for channelCount channels */
+  void (*downmixShort)(const short*, int, int, float*);
+  void (*downmixFloat)(const float*, int, int, float*);
   int bufferCount;
   int bufferSize;               /* Number of multi-channel samples per buffer */
-  short** bufferList;
+  int floatStorage;             /* Buffers hold floats, not shorts */
+  short* bufferList;            /* bufferCount buffers, if !floatStorage */
+  float* floatBufferList;       /* bufferCount buffers, if floatStorage */
   float* tensionList;
-  short* speedyInputBuffer;     /* To accumulate buffers to send to Speedy */
+  float* tensionTrack;          /* Precomputed tension per frame, or NULL */
+  int tensionTrackFrameCount;
+  /* Supplies tensions while playing, or NULL */
+  int (*tensionSource)(sonicStream, int, float*);
+  /* Mono downmix of the ring, for speedy analysis, with the first speedy
+   * frame mirrored past the end so every analysis window is contiguous.
+   * NULL with a tension track or source.
+   */
+  float* analysisRing;
+  int frameSize;                /* Speedy window and step at our sample rate, */
+  int frameStep;                /* even when the analysis is decimated */
+  sonicDecimator decimator;     /* Feeds the analysis ring, or NULL */
+  int analysisLocation;         /* Decimated samples in the current frame */
   int readBufferFrameIndex;     /* Frame time, always increasing. */
   int speedyBufferFrameIndex;   /* Frame time, always increasing. */
   int writeBufferFrameIndex;    /* Frame time, always increasing. */
@@ -79,16 +111,150 @@ struct speedyConnectionStruct {
   void (*returnFeatures)(sonicStream, int, float*);
   void (*returnSpectrogram)(sonicStream, int, float*);
   void (*returnNormalizedSpectrogram)(sonicStream, int, float*);
+  void* callbackUserData;       /* For the callbacks, see sonic2.h */
+#ifdef  SPEEDY_STATS
+  speedyStats stats;            /* SOLA and ring counters, see sonic2.h */
+#endif
 };
 typedef struct speedyConnectionStruct* speedyConnection;
 
-/* Note: Speedy's tension calculation at frame k depends on kTemporalHysteresis
- * frames in the *future*. For this reason, this shim needs to buffer a number
- * of frames so that speedy can see these frames in the future, and then
- * calculate the tension now.  This bufferList has to have enough room for all
- * of these future frames.
+static void sonicSelectDownmixKernels(speedyConnection mySpeedyConnector);
+
+/* Resample the mono analysis signal by upFactor/downFactor (the ratio of the
+ * analysis frame step to the stream's), as a polyphase FIR: a Hann windowed
+ * sinc lowpass at 0.9 of the output Nyquist, split into upFactor phases of
+ * tapCount taps.  Each output sample costs one tapCount dot product.
+ */
+struct sonicDecimatorStruct {
+  int upFactor;
+  int downFactor;
+  int tapCount;
+  float* taps;      /* upFactor phases, each reversed to run oldest first */
+  float* history;   /* Last tapCount inputs, mirrored so they're contiguous */
+  int historyPosition;
+  int phase;        /* Of the next output, in [0, upFactor) once consumed */
+};
+
+/* Note: Speedy's tension calculation at frame k depends on the speedy
+ * lookahead (kTemporalHysteresisFuture frames by default) in the *future*. For
+ * this reason, this shim needs to buffer a number of frames so that speedy can
+ * see these frames in the future, and then calculate the tension now.  This
+ * bufferList has to have enough room for all of these future frames: the frame
+ * waiting for its tension, the future frames speedy needs, and the partial
+ * frame being filled.  Speedy also sees a frame only once the next one has
+ * started, so even a causal analysis holds back a full speedy window.
+ */
+static int sonicAnalysisDelayFrames(speedyConnection mySpeedyConnector) {
+  int lookahead = speedyGetLookahead(mySpeedyConnector->mySpeedyStream);
+  int windowFrames = mySpeedyConnector->frameSize/mySpeedyConnector->frameStep;
+  return lookahead > windowFrames ? lookahead : windowFrames;
+}
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Zero crossings on each side of the decimator's sinc. */
+#define kDecimatorZeroCrossings 4
+
+static int sonicGreatestCommonDivisor(int a, int b) {
+  while (b) {
+    int remainder = a % b;
+    a = b;
+    b = remainder;
+  }
+  return a;
+}
+
+static void sonicDestroyDecimator(sonicDecimator decimator) {
+  free(decimator->taps);
+  free(decimator->history);
+  free(decimator);
+}
+
+static void sonicResetDecimator(sonicDecimator decimator) {
+  memset(decimator->history, 0, 2*decimator->tapCount*sizeof(float));
+  decimator->historyPosition = 0;
+  decimator->phase = 0;
+}
+
+/* Design a decimator that turns inputStep samples into outputStep, with
+ * outputStep < inputStep.  Return NULL only if we are out of memory.
+ */
+static sonicDecimator sonicCreateDecimator(int inputStep, int outputStep) {
+  int divisor = sonicGreatestCommonDivisor(inputStep, outputStep);
+  int upFactor = outputStep/divisor;
+  int downFactor = inputStep/divisor;
+  /* The cutoff, in cycles per sample at upFactor times the input rate. */
+  double cutoff = 0.45/downFactor;
+  int tapCount = (int)ceil(kDecimatorZeroCrossings/(cutoff*upFactor));
+  int length = tapCount*upFactor;
+  double center = (length - 1)/2.0;
+  int phase, i;
+
+  sonicDecimator decimator = (sonicDecimator)calloc(
+      1, sizeof(struct sonicDecimatorStruct));
+  if (!decimator) {
+    return NULL;
+  }
+  decimator->taps = (float*)calloc(length, sizeof(float));
+  decimator->history = (float*)calloc(2*tapCount, sizeof(float));
+  if (!decimator->taps || !decimator->history) {
+    sonicDestroyDecimator(decimator);
+    return NULL;
+  }
+  decimator->upFactor = upFactor;
+  decimator->downFactor = downFactor;
+  decimator->tapCount = tapCount;
+  for (phase = 0; phase < upFactor; phase++) {
+    float* taps = decimator->taps + phase*tapCount;
+    double sum = 0.0;
+    for (i = 0; i < tapCount; i++) {
+      /* Tap i multiplies the input tapCount-1-i samples back. */
+      int j = phase + (tapCount - 1 - i)*upFactor;
+      double x = 2*M_PI*cutoff*(j - center);
+      double sinc = x == 0.0 ? 1.0 : sin(x)/x;
+      double hann = 0.5 - 0.5*cos(2*M_PI*(j + 0.5)/length);
+      taps[i] = sinc*hann;
+      sum += taps[i];
+    }
+    /* Unity gain at DC for every phase. */
+    for (i = 0; i < tapCount; i++) {
+      taps[i] /= sum;
+    }
+  }
+  return decimator;
+}
+
+/* Decimate sampleCount input samples, returning the number of output samples
+ * put in output.  Output n is computed as soon as input n*inputStep/outputStep
+ * arrives, so a frame step of input gives exactly a frame step of output.
  */
-#define kMinBufferSize (2+kTemporalHysteresisFuture)
+static int sonicDecimate(sonicDecimator decimator, const float* input,
+                         int sampleCount, float* output) {
+  int tapCount = decimator->tapCount;
+  int outputCount = 0;
+  int i, j;
+
+  for (i = 0; i < sampleCount; i++) {
+    int position = decimator->historyPosition;
+    decimator->history[position] = input[i];
+    decimator->history[position + tapCount] = input[i];
+    decimator->historyPosition = position + 1 == tapCount ? 0 : position + 1;
+    const float* history = decimator->history + position + 1;
+    while (decimator->phase < decimator->upFactor) {
+      const float* taps = decimator->taps + decimator->phase*tapCount;
+      float sum = 0.0;
+      for (j = 0; j < tapCount; j++) {
+        sum += taps[j]*history[j];
+      }
+      output[outputCount++] = sum;
+      decimator->phase += decimator->downFactor;
+    }
+    decimator->phase -= decimator->upFactor;
+  }
+  return outputCount;
+}
 
 sonicStream sonicCreateStream(int sampleRate, int numChannels){
   sonicStream mySonicStream = sonicIntCreateStream(sampleRate, numChannels);
@@ -111,9 +277,12 @@ sonicStream sonicCreateStream(int sampleRate, int numChannels){
     return NULL;
   }
   mySpeedyConnector->mySpeedyStream = mySpeedyStream;
+  mySpeedyConnector->frameSize = speedyInputFrameSize(mySpeedyStream);
+  mySpeedyConnector->frameStep = speedyInputFrameStep(mySpeedyStream);
   mySpeedyConnector->globalSpeed = 1.0;
   mySpeedyConnector->sampleRate = sampleRate;
   mySpeedyConnector->channelCount = numChannels;
+  sonicSelectDownmixKernels(mySpeedyConnector);
   mySpeedyConnector->speedyNonlinearFactor = 0.0;    /* Off by default */
   /* How fast to normalize the speed (after non-linear speedup) to keep the
    * average speed at the desired.  The default 0.1 means the speed is upped
@@ -147,21 +316,24 @@ void sonicDestroyStream(sonicStream mySonicStream) {
     if (mySpeedyConnector->mySpeedyStream) {
       speedyDestroyStream(mySpeedyConnector->mySpeedyStream);
     }
-    if (mySpeedyConnector->bufferCount > 0 && mySpeedyConnector->bufferList) {
-      int i;
-      for (i=0; i<mySpeedyConnector->bufferCount; i++) {
-        if (mySpeedyConnector->bufferList[i]) {
-          free(mySpeedyConnector->bufferList[i]);
-        }
-      }
+    if (mySpeedyConnector->bufferList) {
       free(mySpeedyConnector->bufferList);
     }
-    if (mySpeedyConnector->speedyInputBuffer) {
-      free(mySpeedyConnector->speedyInputBuffer);
+    if (mySpeedyConnector->floatBufferList) {
+      free(mySpeedyConnector->floatBufferList);
+    }
+    if (mySpeedyConnector->analysisRing) {
+      free(mySpeedyConnector->analysisRing);
+    }
+    if (mySpeedyConnector->decimator) {
+      sonicDestroyDecimator(mySpeedyConnector->decimator);
     }
     if (mySpeedyConnector->tensionList) {
       free(mySpeedyConnector->tensionList);
     }
+    if (mySpeedyConnector->tensionTrack) {
+      free(mySpeedyConnector->tensionTrack);
+    }
     free(mySpeedyConnector);
   }
 }
@@ -232,46 +404,84 @@ void sonicSetSpeedySpeechChangeCapMultiplier(sonicStream mySonicStream,
                                      multiplier);
 }
 
+void sonicSetSpeedySilenceGate(sonicStream mySonicStream, int enabled) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  speedySetSilenceGate(mySpeedyConnector->mySpeedyStream, enabled);
+}
+
+int sonicGetSpeedySilenceGate(sonicStream mySonicStream) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  return speedyGetSilenceGate(mySpeedyConnector->mySpeedyStream);
+}
 
-int sonicAllocateBuffers(sonicStream mySonicStream, int sampleCount){
-  /* TODO(malcolmslaney): Need to check if we have already allocated this space,
-   * and if we need to increase the buffer size.
-   */
+void sonicGetSpeedyTuningParameters(
+    sonicStream mySonicStream, float parameters[kSpeedyTuningParameterCount]) {
   assert(mySonicStream);
   speedyConnection mySpeedyConnector =
       (speedyConnection)sonicIntGetUserData(mySonicStream);
-  speedyStream mySpeedyStream = mySpeedyConnector->mySpeedyStream;
+  speedyGetTuningParameters(mySpeedyConnector->mySpeedyStream, parameters);
+}
 
-  mySpeedyConnector->bufferSize = speedyInputFrameStep(mySpeedyStream);
-  int bufferCount = sampleCount / mySpeedyConnector->bufferSize + 1;
-  if (bufferCount < kMinBufferSize) {
-      bufferCount = kMinBufferSize;
-  }
-  mySpeedyConnector->bufferCount = bufferCount;
-  printf("Allocating %d buffers for sonic data.\n", bufferCount);
-  short **bufferList =  (short**) calloc(mySpeedyConnector->bufferCount,
-                                         sizeof(short*));
-  mySpeedyConnector->bufferList = bufferList;
-  if (!bufferList) {
+/* The analysis counters come from the speedy stream, the rest from here. */
+int sonicGetSpeedyStats(sonicStream mySonicStream, speedyStats* stats) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  if (!speedyGetStats(mySpeedyConnector->mySpeedyStream, stats)) {
     return 0;
   }
-  int i;
-  for (i=0; i<bufferCount; i++) {
-    bufferList[i] = (short *)calloc(mySpeedyConnector->bufferSize,
-                                    sizeof(short)*
-                                    mySpeedyConnector->channelCount);
-    if (!bufferList[i]) {
+#ifdef  SPEEDY_STATS
+  const speedyStats* shim = &mySpeedyConnector->stats;
+  stats->stage_nanoseconds[kSpeedyStageSola] =
+      shim->stage_nanoseconds[kSpeedyStageSola];
+  stats->stage_calls[kSpeedyStageSola] = shim->stage_calls[kSpeedyStageSola];
+  stats->missing_tension_frames = shim->missing_tension_frames;
+  stats->buffered_frames_high_water = shim->buffered_frames_high_water;
+#endif
+  return 1;
+}
+
+void sonicResetSpeedyStats(sonicStream mySonicStream) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  speedyResetStats(mySpeedyConnector->mySpeedyStream);
+#ifdef  SPEEDY_STATS
+  memset(&mySpeedyConnector->stats, 0, sizeof(mySpeedyConnector->stats));
+#endif
+}
+
+
+/* Allocate the buffer ring on the first write.  floatStorage selects whether
+ * it holds floats or shorts, following the type of that first write.
+ */
+int sonicAllocateBuffers(sonicStream mySonicStream, int floatStorage){
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+
+  mySpeedyConnector->bufferSize = mySpeedyConnector->frameStep;
+  /* With a tension source, frames also wait for the other thread. */
+  mySpeedyConnector->bufferCount = mySpeedyConnector->tensionSource ?
+      kTensionSourceBufferSize : 2 + sonicAnalysisDelayFrames(mySpeedyConnector);
+  mySpeedyConnector->floatStorage = floatStorage;
+  int ringSize = mySpeedyConnector->bufferCount *
+                 mySpeedyConnector->bufferSize * mySpeedyConnector->channelCount;
+  if (floatStorage) {
+    mySpeedyConnector->floatBufferList =
+        (float *)calloc(ringSize, sizeof(float));
+    if (!mySpeedyConnector->floatBufferList) {
+      return 0;
+    }
+  } else {
+    mySpeedyConnector->bufferList = (short *)calloc(ringSize, sizeof(short));
+    if (!mySpeedyConnector->bufferList) {
       return 0;
     }
-  }
-
-  int speedyBufferSize = speedyInputFrameSize(mySpeedyStream);
-  printf("speedyBufferSize is %d, sonicBufferSize is %d.\n", speedyBufferSize,
-         mySpeedyConnector->bufferSize); fflush(stdout);
-  mySpeedyConnector->speedyInputBuffer = (short *)calloc(speedyBufferSize,
-                                                         sizeof(short));
-  if (!mySpeedyConnector->speedyInputBuffer) {
-    return 0;
   }
 
   mySpeedyConnector->tensionList =
@@ -282,11 +492,240 @@ int sonicAllocateBuffers(sonicStream mySonicStream, int sampleCount){
   return 1;
 }
 
+/* Allocate the analysis ring, once the buffers exist and we know the stream
+ * analyzes its input (a tension track can be dropped by a seek to 0).  It
+ * holds a frame step of analysis samples per buffer, which is fewer than the
+ * buffer's samples when the analysis is decimated.
+ */
+static int sonicAllocateAnalysisRing(speedyConnection mySpeedyConnector) {
+  speedyStream mySpeedyStream = mySpeedyConnector->mySpeedyStream;
+  int analysisSize = mySpeedyConnector->bufferCount *
+      speedyInputFrameStep(mySpeedyStream) +
+      speedyInputFrameSize(mySpeedyStream);
+  mySpeedyConnector->analysisRing = (float *)calloc(analysisSize, sizeof(float));
+  return mySpeedyConnector->analysisRing != NULL;
+}
+
 /* Check to see if we have enough space to write the new data. */
 int sonicFreeSpace(speedyConnection mySpeedyConnection, int sampleCount) {
   return 1;
 }
 
+/* Return the start of the ring buffer holding the given frame. */
+static short* sonicShortBuffer(speedyConnection mySpeedyConnector,
+                               int frameIndex) {
+  int bufferIndex = frameIndex % mySpeedyConnector->bufferCount;
+  return mySpeedyConnector->bufferList +
+      bufferIndex * mySpeedyConnector->bufferSize *
+      mySpeedyConnector->channelCount;
+}
+
+static float* sonicFloatBuffer(speedyConnection mySpeedyConnector,
+                               int frameIndex) {
+  int bufferIndex = frameIndex % mySpeedyConnector->bufferCount;
+  return mySpeedyConnector->floatBufferList +
+      bufferIndex * mySpeedyConnector->bufferSize *
+      mySpeedyConnector->channelCount;
+}
+
+/* Pass one stored buffer, in whatever format it is stored, to the original
+ * libsonic for SOLA processing.
+ */
+static void sonicWriteStoredBuffer(sonicStream mySonicStream,
+                                   speedyConnection mySpeedyConnector,
+                                   int frameIndex) {
+  SPEEDY_STATS_START(start);
+  if (mySpeedyConnector->floatStorage) {
+    sonicIntWriteFloatToStream(mySonicStream,
+                               sonicFloatBuffer(mySpeedyConnector, frameIndex),
+                               mySpeedyConnector->bufferSize);
+  } else {
+    sonicIntWriteShortToStream(mySonicStream,
+                               sonicShortBuffer(mySpeedyConnector, frameIndex),
+                               mySpeedyConnector->bufferSize);
+  }
+  SPEEDY_STATS_END(&mySpeedyConnector->stats, kSpeedyStageSola, start);
+}
+
+/* The downmix kernels average the channels of sampleCount stored samples into
+ * a mono float signal for speedy analysis.  There is one for each storage type
+ * and channel count, so the mono and stereo ones have no channel loop or
+ * division to run per sample, and the compiler can unroll and vectorize them;
+ * the generic ones take the count at run time.  sonicCreateStream picks the
+ * pair for the stream's channel count (see sonicSelectDownmixKernels).
+ *
+ * Short samples are averaged as a short, so the result matches
+ * speedyAddDataShort on the average.
+ */
+#define SONIC_DOWNMIX_KERNELS(suffix, CHANNELS)                               \
+  static void sonicDownmixShort##suffix(const short* wp, int sampleCount,     \
+                                        int channelCount, float* bp) {        \
+    const int channels = (CHANNELS);                                          \
+    int j, k;                                                                 \
+    for (j = 0; j < sampleCount; j++) {                                       \
+      int sum = wp[j*channels];                                               \
+      for (k = 1; k < channels; k++) {                                        \
+        sum += wp[j*channels + k];                                            \
+      }                                                                       \
+      short mono = sum/channels;                                              \
+      bp[j] = mono/32768.0;                                                   \
+    }                                                                         \
+  }                                                                           \
+  static void sonicDownmixFloat##suffix(const float* wp, int sampleCount,     \
+                                        int channelCount, float* bp) {        \
+    const int channels = (CHANNELS);                                          \
+    int j, k;                                                                 \
+    for (j = 0; j < sampleCount; j++) {                                       \
+      float sum = wp[j*channels];                                             \
+      for (k = 1; k < channels; k++) {                                        \
+        sum += wp[j*channels + k];                                            \
+      }                                                                       \
+      bp[j] = sum/channels;                                                   \
+    }                                                                         \
+  }
+
+SONIC_DOWNMIX_KERNELS(Mono, 1)
+SONIC_DOWNMIX_KERNELS(Generic, channelCount)
+#ifdef  __wasm_simd128__
+SONIC_DOWNMIX_KERNELS(StereoScalar, 2)
+
+/* Four stereo samples per step; the rest go through the scalar kernel. */
+static void sonicDownmixFloatStereo(const float* wp, int sampleCount,
+                                    int channelCount, float* bp) {
+  const v128_t half = wasm_f32x4_splat(0.5f);
+  int j = 0;
+  for (; j + 4 <= sampleCount; j += 4) {
+    v128_t low = wasm_v128_load(&wp[2*j]);      /* l0 r0 l1 r1 */
+    v128_t high = wasm_v128_load(&wp[2*j+4]);   /* l2 r2 l3 r3 */
+    v128_t left = wasm_i32x4_shuffle(low, high, 0, 2, 4, 6);
+    v128_t right = wasm_i32x4_shuffle(low, high, 1, 3, 5, 7);
+    wasm_v128_store(&bp[j], wasm_f32x4_mul(wasm_f32x4_add(left, right), half));
+  }
+  sonicDownmixFloatStereoScalar(wp + 2*j, sampleCount - j, 2, bp + j);
+}
+#define sonicDownmixShortStereo sonicDownmixShortStereoScalar
+#else
+SONIC_DOWNMIX_KERNELS(Stereo, 2)
+#endif  /* __wasm_simd128__ */
+
+/* Point the stream at the downmix kernels for its channel count.  The count
+ * never changes, so this is done once, at creation.
+ */
+static void sonicSelectDownmixKernels(speedyConnection mySpeedyConnector) {
+  switch (mySpeedyConnector->channelCount) {
+  case 1:
+    mySpeedyConnector->downmixShort = sonicDownmixShortMono;
+    mySpeedyConnector->downmixFloat = sonicDownmixFloatMono;
+    break;
+  case 2:
+    mySpeedyConnector->downmixShort = sonicDownmixShortStereo;
+    mySpeedyConnector->downmixFloat = sonicDownmixFloatStereo;
+    break;
+  default:
+    mySpeedyConnector->downmixShort = sonicDownmixShortGeneric;
+    mySpeedyConnector->downmixFloat = sonicDownmixFloatGeneric;
+    break;
+  }
+}
+
+/* Now that we know the tension of the oldest stored frame, calculate its
+ * speed, tell the original libsonic the new speed, and send it the frame for
+ * SOLA processing.
+ */
+static void sonicPlayFrame(sonicStream mySonicStream,
+                           speedyConnection mySpeedyConnector, float tension) {
+#ifdef  DEBUG
+  int i;
+#endif
+  float newRate = speedyComputeSpeedFromTension(
+      tension, mySpeedyConnector->globalSpeed,
+      mySpeedyConnector->speedyDurationFeedbackStrength,
+      mySpeedyConnector->mySpeedyStream);
+  // Interpolate between speedy-derived speed, and the global/linear request.
+  float globalSpeed = mySpeedyConnector->globalSpeed;
+  newRate = newRate    *   mySpeedyConnector->speedyNonlinearFactor +
+            globalSpeed*(1-mySpeedyConnector->speedyNonlinearFactor);
+#ifdef  DEBUG
+  printf("  Requesting a speed of %g from libsonicInt.\n", newRate);
+#endif
+  if (mySpeedyConnector->returnSpeed) {
+    (mySpeedyConnector->returnSpeed)(mySonicStream,
+                                     mySpeedyConnector->readBufferFrameIndex,
+                                     newRate);
+  }
+  sonicIntSetSpeed(mySonicStream, newRate);
+#ifdef  DEBUG
+  printf("  Sending %d samples at time %d to libsonicInt for processing...\n",
+         mySpeedyConnector->bufferSize,
+         mySpeedyConnector->readBufferFrameIndex);
+  fflush(stdout);
+  if (!mySpeedyConnector->floatStorage) {
+    short *readBuffer = sonicShortBuffer(
+        mySpeedyConnector, mySpeedyConnector->readBufferFrameIndex);
+    printf("Frame %d sb:", mySpeedyConnector->readBufferFrameIndex);
+    for (i=0; i<mySpeedyConnector->bufferSize; i++) {
+      printf(" %d", readBuffer[i]);
+    }
+    printf("\n");
+  }
+#endif
+  sonicWriteStoredBuffer(mySonicStream, mySpeedyConnector,
+                         mySpeedyConnector->readBufferFrameIndex);
+  mySpeedyConnector->readBufferFrameIndex++;
+}
+
+/* Report the tension of the oldest stored frame, which came from outside the
+ * analysis, and play it.
+ */
+static void sonicPlayFrameWithTension(sonicStream mySonicStream,
+                                      speedyConnection mySpeedyConnector,
+                                      float tension) {
+  if (mySpeedyConnector->returnTension) {
+    (mySpeedyConnector->returnTension)(mySonicStream,
+                                       mySpeedyConnector->readBufferFrameIndex,
+                                       tension);
+  }
+  sonicPlayFrame(mySonicStream, mySpeedyConnector, tension);
+}
+
+/* In tension track mode, each frame is played as soon as it is complete, with
+ * the precomputed tension (0, the average, for frames past the end of the
+ * track).
+ */
+static void sonicPlayTrackFrame(sonicStream mySonicStream,
+                                speedyConnection mySpeedyConnector) {
+  int frameIndex = mySpeedyConnector->readBufferFrameIndex;
+  float tension = 0.0;
+  if (frameIndex < mySpeedyConnector->tensionTrackFrameCount) {
+    tension = mySpeedyConnector->tensionTrack[frameIndex];
+  }
+  sonicPlayFrameWithTension(mySonicStream, mySpeedyConnector, tension);
+}
+
+/* In tension source mode, play every complete frame whose tension has
+ * arrived.  If the ring is about to overflow, play the oldest frame anyway,
+ * with the average tension.
+ */
+static void sonicPlaySourceFrames(sonicStream mySonicStream,
+                                  speedyConnection mySpeedyConnector) {
+  float tension;
+  while (mySpeedyConnector->readBufferFrameIndex <=
+         mySpeedyConnector->writeBufferFrameIndex &&
+         (mySpeedyConnector->tensionSource)(
+             mySonicStream, mySpeedyConnector->readBufferFrameIndex,
+             &tension)) {
+    sonicPlayFrameWithTension(mySonicStream, mySpeedyConnector, tension);
+  }
+  if (mySpeedyConnector->writeBufferFrameIndex + 1 -
+      mySpeedyConnector->readBufferFrameIndex >=
+      mySpeedyConnector->bufferCount) {
+#ifdef  SPEEDY_STATS
+    mySpeedyConnector->stats.missing_tension_frames++;
+#endif
+    sonicPlayFrameWithTension(mySonicStream, mySpeedyConnector, 0.0);
+  }
+}
+
 /* sonicSendDataToSpeedy - We now have enough new data to send to Speedy. Send
  * one buffer. Then check to see if we have sent enough data to speedy to get
  * back a new tension estimate.  If so, use the tension to calculate a new
@@ -298,7 +737,7 @@ void sonicSendDataToSpeedy(sonicStream mySonicStream) {
   speedyConnection mySpeedyConnector =
       (speedyConnection)sonicIntGetUserData(mySonicStream);
   speedyStream mySpeedyStream = (speedyStream)mySpeedyConnector->mySpeedyStream;
-  int speedyBufferSize = speedyInputFrameSize(mySpeedyStream);
+  int speedyBufferSize = mySpeedyConnector->frameSize;
   int sonicBufferSize = mySpeedyConnector->bufferSize;
   int speedyFullBufferCount = speedyBufferSize/mySpeedyConnector->bufferSize;
   int partialCount = speedyBufferSize - sonicBufferSize*speedyFullBufferCount;
@@ -306,44 +745,21 @@ void sonicSendDataToSpeedy(sonicStream mySonicStream) {
          mySpeedyConnector->writeBufferFrameIndex);
   assert(mySpeedyConnector->writeBufferFrameLocation > partialCount);
 
-  /* Copy the full buffers, averaging the channels to get a mono signal for
-   * speedy analysis.
+  /* The window starts at the oldest frame speedy hasn't seen, and is already
+   * downmixed and contiguous in the analysis ring.
    */
-  int i, j, k, bufferIndex, sum;
-  short* bp = mySpeedyConnector->speedyInputBuffer;
-  short* wp;
-  for (i=0; i<speedyFullBufferCount; i++) {
-    bufferIndex = (mySpeedyConnector->speedyBufferFrameIndex + i) %
-                      mySpeedyConnector->bufferCount;
-    short* wp = mySpeedyConnector->bufferList[bufferIndex];
-    for (j = 0; j<sonicBufferSize; j++) {
-      int channelCount = mySpeedyConnector->channelCount;
-      for (k = 0, sum=0; k<channelCount; k++) {
-        sum += wp[j*channelCount + k];
-      }
-      *bp++ = sum /channelCount;
-    }
-  }
-  /* Then copy the last partial buffer before sending for speedy analysis. */
-  bufferIndex = (mySpeedyConnector->speedyBufferFrameIndex +
-                 speedyFullBufferCount) % mySpeedyConnector->bufferCount;
-  wp = mySpeedyConnector->bufferList[bufferIndex];
-  for (i = 0; i<partialCount; i++) {
-    int channelCount = mySpeedyConnector->channelCount;
-    for (j = 0, sum=0; j<channelCount; j++) {
-      sum += wp[i*channelCount + j];
-    }
-    *bp++ = sum /channelCount;
-  }
+  const float* window = mySpeedyConnector->analysisRing +
+      (mySpeedyConnector->speedyBufferFrameIndex %
+       mySpeedyConnector->bufferCount) * speedyInputFrameStep(mySpeedyStream);
   mySpeedyConnector->speedyBufferFrameIndex++;  /* Move to next frame. */
 
-  /* Send the full speedyInputBuffer to Speedy for analysis */
+  /* Send the window to Speedy for analysis */
 #ifdef  DEBUG
   printf("Sending data from buffer at time %d to speedy\n",
          mySpeedyConnector->speedyBufferFrameIndex); fflush(stdout);
 #endif
-  speedyAddDataShort(mySpeedyStream, mySpeedyConnector->speedyInputBuffer,
-                     mySpeedyConnector->writeBufferFrameIndex);
+  speedyAddData(mySpeedyStream, window,
+                mySpeedyConnector->writeBufferFrameIndex);
   if (mySpeedyConnector->returnSpectrogram) {
     /* Note: this spectrogram is calculated when the data is sent to speedy */
     (mySpeedyConnector->returnSpectrogram)(
@@ -386,74 +802,149 @@ void sonicSendDataToSpeedy(sonicStream mySonicStream) {
            mySpeedyConnector->readBufferFrameIndex); fflush(stdout);
 #endif
 
-    float newRate = speedyComputeSpeedFromTension(
-        newTension, mySpeedyConnector->globalSpeed,
-        mySpeedyConnector->speedyDurationFeedbackStrength, mySpeedyStream);
-    // Interpolate between speedy-derived speed, and the global/linear request.
-    float globalSpeed = mySpeedyConnector->globalSpeed;
-    newRate = newRate    *   mySpeedyConnector->speedyNonlinearFactor +
-              globalSpeed*(1-mySpeedyConnector->speedyNonlinearFactor);
-#ifdef  DEBUG
-    printf("  Requesting a speed of %g from libsonicInt.\n", newRate);
-#endif
-    if (mySpeedyConnector->returnSpeed) {
-      (mySpeedyConnector->returnSpeed)(mySonicStream,
-                                       mySpeedyConnector->readBufferFrameIndex,
-                                       newRate);
+    sonicPlayFrame(mySonicStream, mySpeedyConnector, newTension);
+  }
+}
+
+/* Downmix sampleCount stored samples of a frame, starting at location, into
+ * mono floats at bp.  It uses the stored values (after any conversion) so the
+ * result doesn't depend on the input type.
+ */
+static void sonicDownmixStored(speedyConnection mySpeedyConnector,
+                               int frameIndex, int location, int sampleCount,
+                               float* bp) {
+  int channelCount = mySpeedyConnector->channelCount;
+
+  if (mySpeedyConnector->floatStorage) {
+    (mySpeedyConnector->downmixFloat)(
+        sonicFloatBuffer(mySpeedyConnector, frameIndex) + location*channelCount,
+        sampleCount, channelCount, bp);
+  } else {
+    (mySpeedyConnector->downmixShort)(
+        sonicShortBuffer(mySpeedyConnector, frameIndex) + location*channelCount,
+        sampleCount, channelCount, bp);
+  }
+}
+
+/* Put sampleCount just-stored samples, at the current write location, into
+ * the analysis ring: downmixed, and decimated if that is enabled.  This is
+ * the only place each input sample is averaged for analysis.
+ */
+#define kDecimatorChunkSize 256
+static void sonicStoreAnalysisSamples(speedyConnection mySpeedyConnector,
+                                      int sampleCount) {
+  int frameIndex = mySpeedyConnector->writeBufferFrameIndex;
+  int location = mySpeedyConnector->writeBufferFrameLocation;
+  speedyStream mySpeedyStream = mySpeedyConnector->mySpeedyStream;
+  int analysisStep = speedyInputFrameStep(mySpeedyStream);
+  int analysisCount = sampleCount;
+
+  if (location == 0) {
+    mySpeedyConnector->analysisLocation = 0;
+  }
+  if (!mySpeedyConnector->decimator) {
+    mySpeedyConnector->analysisLocation = location;
+  }
+  int position = (frameIndex % mySpeedyConnector->bufferCount) * analysisStep +
+      mySpeedyConnector->analysisLocation;
+  float* bp = mySpeedyConnector->analysisRing + position;
+
+  if (!mySpeedyConnector->decimator) {
+    sonicDownmixStored(mySpeedyConnector, frameIndex, location, sampleCount,
+                       bp);
+  } else {
+    float mono[kDecimatorChunkSize];
+    int done, chunkCount;
+    analysisCount = 0;
+    for (done = 0; done < sampleCount; done += chunkCount) {
+      chunkCount = sampleCount - done;
+      if (chunkCount > kDecimatorChunkSize) {
+        chunkCount = kDecimatorChunkSize;
+      }
+      sonicDownmixStored(mySpeedyConnector, frameIndex, location + done,
+                         chunkCount, mono);
+      analysisCount += sonicDecimate(mySpeedyConnector->decimator, mono,
+                                     chunkCount, bp + analysisCount);
     }
-    sonicIntSetSpeed(mySonicStream, newRate);
-    int readIndex = mySpeedyConnector->readBufferFrameIndex %
-                    mySpeedyConnector->bufferCount;
-    short *readBuffer = mySpeedyConnector->bufferList[readIndex];
-#ifdef  DEBUG
-    printf("  Sending %d samples at time %d to libsonicInt for processing...\n",
-           mySpeedyConnector->bufferSize,
-           mySpeedyConnector->readBufferFrameIndex);
-    fflush(stdout);
-    printf("Frame %d sb:", mySpeedyConnector->readBufferFrameIndex);
-    for (i=0; i<mySpeedyConnector->bufferSize; i++) {
-      printf(" %d", readBuffer[i]);
+  }
+  mySpeedyConnector->analysisLocation += analysisCount;
+  assert(mySpeedyConnector->analysisLocation <= analysisStep);
+
+  /* Mirror the start of the ring past its end. */
+  int ringSize = mySpeedyConnector->bufferCount * analysisStep;
+  int windowSize = speedyInputFrameSize(mySpeedyStream);
+  if (position < windowSize) {
+    int mirrorCount = windowSize - position;
+    if (mirrorCount > analysisCount) {
+      mirrorCount = analysisCount;
     }
-    printf("\n");
-#endif
-    sonicIntWriteShortToStream(mySonicStream, readBuffer,
-                               mySpeedyConnector->bufferSize);
-    mySpeedyConnector->readBufferFrameIndex++;
+    memcpy(bp + ringSize, bp, mirrorCount*sizeof(float));
   }
 }
 
-/*
- * This the main input for sound to Speedy. This kicks off the processing needed
- * so Speedy can calculate the necessary speedup (when you use sonicRead...
- *
- * Accept sound data for speedup processing.  Fill in the next buffer, and when
- * the buffer is full send it to Speedy. There are several frames of latency
- * induced by speedy, so check to see if the results from a previous frame are
- * ready. If ready, calculate the speed from the tension, and send the original
- * sound data to SOLA (libsonic) for processing.
- *
- * Note the speedy buffers are 150% of the size of the sonic buffers.  Sonic
- * gets sonicBufferSize bytes at a time, and that is what is stored in this
- * buffer list, and eventually passed to the original sonic.  But speedy needs
- * more data to do its analysis (50% overlap) so we have to make sure we have
- * enough data to pass a full buffer to Speedy.
-*/
-int sonicWriteShortToStream(sonicStream mySonicStream, const short* inBuffer,
-                            int sampleCount){
-  assert(mySonicStream);
+/* Copy sampleCount multi-channel samples into the current write buffer,
+ * starting at writeBufferFrameLocation, and into the analysis ring.  Exactly
+ * one of shortInput and floatInput is non-NULL; it is converted if it differs
+ * from the storage type.
+ */
+static void sonicStoreSamples(speedyConnection mySpeedyConnector,
+                              const short* shortInput, const float* floatInput,
+                              int sampleCount) {
+  int channelCount = mySpeedyConnector->channelCount;
+  int frameIndex = mySpeedyConnector->writeBufferFrameIndex;
+  int loc = mySpeedyConnector->writeBufferFrameLocation * channelCount;
+  int valueCount = sampleCount * channelCount;
+  int i;
 
+  if (mySpeedyConnector->floatStorage) {
+    float* writeBuffer = sonicFloatBuffer(mySpeedyConnector, frameIndex) + loc;
+    if (floatInput) {
+      memcpy(writeBuffer, floatInput, valueCount*sizeof(float));
+    } else {
+      for (i=0; i<valueCount; i++) {
+        writeBuffer[i] = shortInput[i] / 32768.0f;
+      }
+    }
+  } else {
+    short* writeBuffer = sonicShortBuffer(mySpeedyConnector, frameIndex) + loc;
+    if (shortInput) {
+      memcpy(writeBuffer, shortInput, valueCount*sizeof(short));
+    } else {
+      for (i=0; i<valueCount; i++) {
+        writeBuffer[i] = (short)(floatInput[i] * 32768.0);
+      }
+    }
+  }
+  if (mySpeedyConnector->analysisRing) {
+    sonicStoreAnalysisSamples(mySpeedyConnector, sampleCount);
+  }
+}
+
+/* Accept shorts or floats (exactly one of the two input pointers is used) and
+ * fill the buffers a block at a time.  Each block runs up to the next event:
+ * the sample that completes the next speedy frame, the end of the current
+ * buffer, or the end of the input.
+ */
+static int sonicWriteSamplesToBuffers(sonicStream mySonicStream,
+                                      const short* shortInput,
+                                      const float* floatInput,
+                                      int sampleCount) {
   speedyConnection mySpeedyConnector =
       (speedyConnection)sonicIntGetUserData(mySonicStream);
-  if (!mySpeedyConnector->speedyNonlinearFactor) {    /* Short circuit speedy */
-    return sonicIntWriteShortToStream(mySonicStream, inBuffer, sampleCount);
+  if (!mySpeedyConnector->bufferList && !mySpeedyConnector->floatBufferList) {
+    if (!sonicAllocateBuffers(mySonicStream, floatInput != NULL)) {
+      return 0;
+    }
   }
-  if (!mySpeedyConnector->bufferList) {
-    sonicAllocateBuffers(mySonicStream, sampleCount);
+  if (!mySpeedyConnector->analysisRing && !mySpeedyConnector->tensionTrack &&
+      !mySpeedyConnector->tensionSource &&
+      !sonicAllocateAnalysisRing(mySpeedyConnector)) {
+    return 0;
   }
-  speedyStream mySpeedyStream = (speedyStream)mySpeedyConnector->mySpeedyStream;
-  int speedyBufferSize = speedyInputFrameSize(mySpeedyStream);
+  int speedyBufferSize = mySpeedyConnector->frameSize;
   int sonicBufferSize = mySpeedyConnector->bufferSize;
   int speedyFullBufferCount = speedyBufferSize/sonicBufferSize;
+  int channelCount = mySpeedyConnector->channelCount;
   /* This is how much of the next partial buffer we have to fill before sending
    * the frame (and this overlap) to speedy.
    */
@@ -474,96 +965,117 @@ int sonicWriteShortToStream(sonicStream mySonicStream, const short* inBuffer,
          speedyFullBufferCount, mySpeedyConnector->writeBufferFrameLocation);
   #endif
 
-  while (inBuffer && sampleCount > 0) {
-    int writeIndex = mySpeedyConnector->writeBufferFrameIndex %
-                     mySpeedyConnector->bufferCount;
-    short* writeBuffer = mySpeedyConnector->bufferList[writeIndex];
-    int j, channelCount = mySpeedyConnector->channelCount;
-    /* Copy all the channels into sonic buffer for the sample at this time. */
-    for (j=0; j<channelCount; j++) {
-      int loc = mySpeedyConnector->writeBufferFrameLocation * channelCount;
-      writeBuffer[loc+j] = *inBuffer++;
+  while (sampleCount > 0) {
+    int location = mySpeedyConnector->writeBufferFrameLocation;
+    /* With a tension track or source there is no analysis to feed. */
+    int frameReady = !mySpeedyConnector->tensionTrack &&
+        !mySpeedyConnector->tensionSource &&
+        mySpeedyConnector->writeBufferFrameIndex >=
+        mySpeedyConnector->speedyBufferFrameIndex+speedyFullBufferCount;
+    /* Stop at the end of this buffer, or at the sample that completes the
+     * next speedy frame, whichever comes first.
+     */
+    int blockCount = sonicBufferSize - location;
+    if (frameReady && location <= partialCountNeeded) {
+      blockCount = partialCountNeeded + 1 - location;
+    }
+    if (blockCount > sampleCount) {
+      blockCount = sampleCount;
     }
-    mySpeedyConnector->writeBufferFrameLocation++;
-    sampleCount--;
+    sonicStoreSamples(mySpeedyConnector, shortInput, floatInput, blockCount);
+    if (shortInput) {
+      shortInput += blockCount * channelCount;
+    } else {
+      floatInput += blockCount * channelCount;
+    }
+    mySpeedyConnector->writeBufferFrameLocation += blockCount;
+    sampleCount -= blockCount;
     /* Check to see if we have enough of a partial buffer to send to Speedy. */
-    if (mySpeedyConnector->writeBufferFrameIndex >=
-        mySpeedyConnector->speedyBufferFrameIndex+speedyFullBufferCount &&
+    if (frameReady &&
         mySpeedyConnector->writeBufferFrameLocation == partialCountNeeded+1) {
       sonicSendDataToSpeedy(mySonicStream);
     }
     /* Check for full buffer and then wrap. */
     if (mySpeedyConnector->writeBufferFrameLocation >= sonicBufferSize) {
+      if (mySpeedyConnector->tensionTrack) {
+        sonicPlayTrackFrame(mySonicStream, mySpeedyConnector);
+      } else if (mySpeedyConnector->tensionSource) {
+        sonicPlaySourceFrames(mySonicStream, mySpeedyConnector);
+      }
       mySpeedyConnector->writeBufferFrameLocation = 0;
       mySpeedyConnector->writeBufferFrameIndex++;
+      /* The ring must never overwrite a frame still waiting for libsonic. */
+      assert(mySpeedyConnector->writeBufferFrameIndex -
+             mySpeedyConnector->readBufferFrameIndex <
+             mySpeedyConnector->bufferCount);
+#ifdef  SPEEDY_STATS
+      int bufferedFrames = mySpeedyConnector->writeBufferFrameIndex -
+          mySpeedyConnector->readBufferFrameIndex;
+      if (bufferedFrames > mySpeedyConnector->stats.buffered_frames_high_water) {
+        mySpeedyConnector->stats.buffered_frames_high_water = bufferedFrames;
+      }
+#endif
     }
   }
   return 1;
 }
 
-/* Like above, but convert floats to shorts before saving them into the buffer
- * and processing them.
- */
-int sonicWriteFloatToStream(sonicStream mySonicStream, const float* inBuffer,
+/*
+ * This the main input for sound to Speedy. This kicks off the processing needed
+ * so Speedy can calculate the necessary speedup (when you use sonicRead...
+ *
+ * Accept sound data for speedup processing.  Fill in the next buffer, and when
+ * the buffer is full send it to Speedy. There are several frames of latency
+ * induced by speedy, so check to see if the results from a previous frame are
+ * ready. If ready, calculate the speed from the tension, and send the original
+ * sound data to SOLA (libsonic) for processing.
+ *
+ * Note the speedy buffers are 150% of the size of the sonic buffers.  Sonic
+ * gets sonicBufferSize bytes at a time, and that is what is stored in this
+ * buffer list, and eventually passed to the original sonic.  But speedy needs
+ * more data to do its analysis (50% overlap) so we have to make sure we have
+ * enough data to pass a full buffer to Speedy.
+*/
+int sonicWriteShortToStream(sonicStream mySonicStream, const short* inBuffer,
                             int sampleCount){
   assert(mySonicStream);
 
   speedyConnection mySpeedyConnector =
       (speedyConnection)sonicIntGetUserData(mySonicStream);
   if (!mySpeedyConnector->speedyNonlinearFactor) {    /* Short circuit speedy */
-    return sonicIntWriteFloatToStream(mySonicStream, inBuffer, sampleCount);
+    SPEEDY_STATS_START(start);
+    int result = sonicIntWriteShortToStream(mySonicStream, inBuffer,
+                                            sampleCount);
+    SPEEDY_STATS_END(&mySpeedyConnector->stats, kSpeedyStageSola, start);
+    return result;
   }
-  if (!mySpeedyConnector->bufferList) {
-    sonicAllocateBuffers(mySonicStream, sampleCount);
+  if (!inBuffer) {
+    return 1;
   }
-  speedyStream mySpeedyStream = (speedyStream)mySpeedyConnector->mySpeedyStream;
-  int speedyBufferSize = speedyInputFrameSize(mySpeedyStream);
-  int sonicBufferSize = mySpeedyConnector->bufferSize;
-  int speedyFullBufferCount = speedyBufferSize/sonicBufferSize;
-  int partialCountNeeded = speedyBufferSize -
-      speedyFullBufferCount*sonicBufferSize;
+  return sonicWriteSamplesToBuffers(mySonicStream, inBuffer, NULL, sampleCount);
+}
 
-  #ifdef  DEBUG
-  printf("Writing %d floats to sonic at %d\n", sampleCount,
-         mySpeedyConnector->writeBufferFrameIndex); fflush(stdout);
-  printf("  speedyBufferSize: %d, sonicBufferSize: %d, partialCount: %d, "
-         "writeBufferFrameIndex: %d\n",
-         speedyBufferSize, sonicBufferSize, partialCountNeeded,
-         mySpeedyConnector->writeBufferFrameIndex);
-  printf("  speedyBufferFrameIndex: %d, speedyFullBufferCount: %d, "
-         "writeBufferFrameLocation: %d\n",
-         mySpeedyConnector->speedyBufferFrameIndex,
-         speedyFullBufferCount, mySpeedyConnector->writeBufferFrameLocation);
-  #endif
+/* Like above, but for floats.  These are stored as floats unless the buffers
+ * were created by an earlier short write, in which case they are converted to
+ * shorts before saving them into the buffer and processing them.
+ */
+int sonicWriteFloatToStream(sonicStream mySonicStream, const float* inBuffer,
+                            int sampleCount){
+  assert(mySonicStream);
 
-  while (inBuffer && sampleCount > 0) {
-    int writeIndex = mySpeedyConnector->writeBufferFrameIndex %
-                     mySpeedyConnector->bufferCount;
-    short* writeBuffer = mySpeedyConnector->bufferList[writeIndex];
-    int j, channelCount = mySpeedyConnector->channelCount;
-    for (j=0; j<channelCount; j++) {
-      int loc = mySpeedyConnector->writeBufferFrameLocation * channelCount;
-      writeBuffer[loc + j] = (short)(*inBuffer++ * 32768.0);
-    }
-    mySpeedyConnector->writeBufferFrameLocation++;
-    sampleCount--;
-    /* Check to see if we have enough of a partial buffer to send to Speedy. */
-    assert(partialCountNeeded < sonicBufferSize);
-    if (mySpeedyConnector->writeBufferFrameIndex >=
-        mySpeedyConnector->speedyBufferFrameIndex+speedyFullBufferCount &&
-        mySpeedyConnector->writeBufferFrameLocation == partialCountNeeded+1) {
-      sonicSendDataToSpeedy(mySonicStream);
-    }
-    /* Check for full buffer and then wrap. */
-    if (mySpeedyConnector->writeBufferFrameLocation >= sonicBufferSize) {
-      mySpeedyConnector->writeBufferFrameLocation = 0;
-      mySpeedyConnector->writeBufferFrameIndex++;
-    }
-#ifdef DEBUG
-    printf("Finished %d samples\n", sampleCount);
-#endif
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  if (!mySpeedyConnector->speedyNonlinearFactor) {    /* Short circuit speedy */
+    SPEEDY_STATS_START(start);
+    int result = sonicIntWriteFloatToStream(mySonicStream, inBuffer,
+                                            sampleCount);
+    SPEEDY_STATS_END(&mySpeedyConnector->stats, kSpeedyStageSola, start);
+    return result;
   }
-  return 1;
+  if (!inBuffer) {
+    return 1;
+  }
+  return sonicWriteSamplesToBuffers(mySonicStream, NULL, inBuffer, sampleCount);
 }
 
 int sonicReadShortFromStream(sonicStream mySonicStream, short* outBuffer,
@@ -587,20 +1099,50 @@ int sonicFlushStream(sonicStream mySonicStream){
 #endif
   while (mySpeedyConnector->readBufferFrameIndex <
          mySpeedyConnector->writeBufferFrameIndex) {
-    int readIndex = mySpeedyConnector->readBufferFrameIndex %
-                    mySpeedyConnector->bufferCount;
-    short *curBuffer = mySpeedyConnector->bufferList[readIndex];
 #ifdef  DEBUG
     printf("Flushing buffer at time %d to libsonicInt\n",
            mySpeedyConnector->readBufferFrameIndex); fflush(stdout);
 #endif
-    sonicIntWriteShortToStream(mySonicStream, curBuffer,
-                               mySpeedyConnector->bufferSize);
+    sonicWriteStoredBuffer(mySonicStream, mySpeedyConnector,
+                           mySpeedyConnector->readBufferFrameIndex);
     mySpeedyConnector->readBufferFrameIndex++;
   }
   return sonicIntFlushStream(mySonicStream);
 }
 
+/* Seek, reusing all the allocations (see sonic2.h). */
+void sonicSeekStream(sonicStream mySonicStream, int frameIndex,
+                     const speedyCheckpoint* checkpoint) {
+  assert(mySonicStream);
+  assert(frameIndex >= 0);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  /* The original libsonic has no reset, so flush what it holds and throw the
+   * output away.
+   */
+  short discard[1024];
+  int maxSamples = 1024/mySpeedyConnector->channelCount;
+  sonicIntFlushStream(mySonicStream);
+  while (sonicIntReadShortFromStream(mySonicStream, discard, maxSamples) > 0) {
+  }
+  speedyResetStream(mySpeedyConnector->mySpeedyStream, checkpoint);
+  if (mySpeedyConnector->decimator) {
+    sonicResetDecimator(mySpeedyConnector->decimator);
+  }
+  mySpeedyConnector->readBufferFrameIndex = frameIndex;
+  mySpeedyConnector->speedyBufferFrameIndex = frameIndex;
+  mySpeedyConnector->writeBufferFrameIndex = frameIndex;
+  mySpeedyConnector->writeBufferFrameLocation = 0;
+}
+
+void sonicGetSpeedyCheckpoint(sonicStream mySonicStream,
+                              speedyCheckpoint* checkpoint) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  speedyGetCheckpoint(mySpeedyConnector->mySpeedyStream, checkpoint);
+}
+
 /* Enable non-linear speedup. */
 void sonicEnableNonlinearSpeedup(sonicStream mySonicStream, float factor) {
   assert(mySonicStream);
@@ -620,6 +1162,161 @@ void sonicSetDurationFeedbackStrength(sonicStream mySonicStream, float factor) {
   mySpeedyConnector->speedyDurationFeedbackStrength = factor;
 }
 
+/* Play with a precomputed tension track instead of analyzing the audio. */
+int sonicSetTensionTrack(sonicStream mySonicStream, const float* tension,
+                         int frameCount) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  if (mySpeedyConnector->writeBufferFrameIndex > 0 ||
+      mySpeedyConnector->writeBufferFrameLocation > 0) {
+    return 0;    /* Too late, the stream already has data. */
+  }
+  float* track = NULL;
+  if (tension && frameCount > 0) {
+    track = (float*)malloc(sizeof(float) * frameCount);
+    if (!track) {
+      return 0;
+    }
+    memcpy(track, tension, sizeof(float) * frameCount);
+  } else {
+    frameCount = 0;
+  }
+  if (mySpeedyConnector->tensionTrack) {
+    free(mySpeedyConnector->tensionTrack);
+  }
+  mySpeedyConnector->tensionTrack = track;
+  mySpeedyConnector->tensionTrackFrameCount = frameCount;
+  return 1;
+}
+
+/* Play with tensions supplied while playing (see sonic2.h). */
+int sonicSetTensionSource(sonicStream mySonicStream,
+                          tensionSourceFunction source) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  if (mySpeedyConnector->writeBufferFrameIndex > 0 ||
+      mySpeedyConnector->writeBufferFrameLocation > 0 ||
+      mySpeedyConnector->bufferList || mySpeedyConnector->floatBufferList) {
+    return 0;    /* Too late, the ring is already sized and has data. */
+  }
+  mySpeedyConnector->tensionSource = source;
+  return 1;
+}
+
+int sonicEnableDecimatedAnalysis(sonicStream mySonicStream) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  if (mySpeedyConnector->writeBufferFrameIndex > 0 ||
+      mySpeedyConnector->writeBufferFrameLocation > 0 ||
+      mySpeedyConnector->bufferList || mySpeedyConnector->floatBufferList) {
+    return 0;    /* Too late, the analysis ring may already be sized. */
+  }
+  if (mySpeedyConnector->decimator) {
+    return 1;
+  }
+  /* At lower rates, just switch to the power of two FFT. */
+  int analysisRate = speedyGetSampleRate(mySpeedyConnector->mySpeedyStream);
+  if (analysisRate > kSpeedyAnalysisRate) {
+    analysisRate = kSpeedyAnalysisRate;
+  }
+  speedyStream analysisStream = speedyCreatePowerOfTwoStream(analysisRate);
+  if (!analysisStream) {
+    return 0;
+  }
+  int analysisStep = speedyInputFrameStep(analysisStream);
+  int analysisSize = speedyInputFrameSize(analysisStream);
+  sonicDecimator decimator = NULL;
+  if (analysisStep < mySpeedyConnector->frameStep) {
+    /* The last sample of a window must be decimated by the time the shim
+     * sends the window, which is after frameSize+1 samples.
+     */
+    if ((int64_t)(analysisSize - 1)*mySpeedyConnector->frameStep/analysisStep >
+        mySpeedyConnector->frameSize) {
+      speedyDestroyStream(analysisStream);
+      return 0;
+    }
+    decimator = sonicCreateDecimator(mySpeedyConnector->frameStep,
+                                     analysisStep);
+    if (!decimator) {
+      speedyDestroyStream(analysisStream);
+      return 0;
+    }
+  }
+  float parameters[kSpeedyTuningParameterCount];
+  speedyGetTuningParameters(mySpeedyConnector->mySpeedyStream, parameters);
+  speedySetTuningParameters(analysisStream, parameters);
+  speedySetLookahead(analysisStream,
+                     speedyGetLookahead(mySpeedyConnector->mySpeedyStream));
+  speedySetSilenceGate(analysisStream,
+                       speedyGetSilenceGate(mySpeedyConnector->mySpeedyStream));
+  speedyDestroyStream(mySpeedyConnector->mySpeedyStream);
+  mySpeedyConnector->mySpeedyStream = analysisStream;
+  mySpeedyConnector->decimator = decimator;
+  return 1;
+}
+
+int sonicSetSpeedyLookahead(sonicStream mySonicStream, int frames) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  if (mySpeedyConnector->writeBufferFrameIndex > 0 ||
+      mySpeedyConnector->writeBufferFrameLocation > 0 ||
+      mySpeedyConnector->bufferList || mySpeedyConnector->floatBufferList) {
+    return 0;    /* Too late, the ring is already sized for the lookahead. */
+  }
+  if (frames < 0 || frames > kTemporalHysteresisFuture) {
+    return 0;
+  }
+  speedySetLookahead(mySpeedyConnector->mySpeedyStream, frames);
+  return 1;
+}
+
+int sonicGetSpeedyLookahead(sonicStream mySonicStream) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  return speedyGetLookahead(mySpeedyConnector->mySpeedyStream);
+}
+
+int sonicGetSpeedyLatency(sonicStream mySonicStream) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  int frameStep = mySpeedyConnector->frameStep;
+  if (!mySpeedyConnector->speedyNonlinearFactor) {
+    return 0;    /* Straight to libsonic. */
+  }
+  if (mySpeedyConnector->tensionTrack) {
+    return frameStep;
+  }
+  if (mySpeedyConnector->tensionSource) {
+    return (kTensionSourceBufferSize - 1) * frameStep;
+  }
+  /* A frame goes to libsonic once the sample after the speedy window that is
+   * sonicAnalysisDelayFrames ahead has arrived.
+   */
+  int windowFrames = mySpeedyConnector->frameSize/frameStep;
+  return sonicAnalysisDelayFrames(mySpeedyConnector) * frameStep +
+      mySpeedyConnector->frameSize - windowFrames * frameStep + 1;
+}
+
+void sonicSetCallbackUserData(sonicStream mySonicStream, void* userData) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  mySpeedyConnector->callbackUserData = userData;
+}
+
+void* sonicGetCallbackUserData(sonicStream mySonicStream) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  return mySpeedyConnector->callbackUserData;
+}
+
 void sonicTensionCallback(sonicStream mySonicStream,
                           tensionFunction newCallbackFunction) {
   assert(mySonicStream);
@@ -712,12 +1409,26 @@ int sonicSpectrogramSize(sonicStream mySonicStream) {
   if (mySonicStream) {
     speedyConnection mySpeedyConnector =
         (speedyConnection)sonicIntGetUserData(mySonicStream);
-    return speedyFFTSize(mySpeedyConnector->mySpeedyStream);
+    return speedySpectrogramSize(mySpeedyConnector->mySpeedyStream);
   } else {
     return 0;
   }
 }
 
+int sonicSpeedyFFTSize(sonicStream mySonicStream) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  return speedyFFTSize(mySpeedyConnector->mySpeedyStream);
+}
+
+float sonicSpeedyBinToFreq(sonicStream mySonicStream, int bin) {
+  assert(mySonicStream);
+  speedyConnection mySpeedyConnector =
+      (speedyConnection)sonicIntGetUserData(mySonicStream);
+  return speedyBinToFreq(mySpeedyConnector->mySpeedyStream, bin);
+}
+
 
 int getSonicBufferSize(sonicStream mySonicStream) {
   if (mySonicStream) {
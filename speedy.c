@@ -36,11 +36,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef  SPEEDY_STATS
+#include <time.h>
+#endif
 #ifdef  KISS_FFT
 #include "kiss_fft.h"
+#ifdef  SPEEDY_REAL_FFT
+#include "kiss_fftr.h"
+#endif  /* SPEEDY_REAL_FFT */
 #else
 #include "fftw3.h"
 #endif  /* KISS_FFT */
+#ifdef  SPEEDY_PTHREADS
+#include <pthread.h>
+#endif
+#ifdef  __wasm_simd128__
+#include <wasm_simd128.h>
+#endif  /* __wasm_simd128__ */
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -124,33 +136,87 @@ void DeleteFirstOrderFilter(FirstOrderFilter fof) {
 #define kFeatureValueCount                   15
 
 
+/* The FFT plan and the types of its (fft_size long) input and
+ * (spectrogram_size long) output.
+ */
+#ifdef  KISS_FFT
+#ifdef  SPEEDY_REAL_FFT
+typedef kiss_fftr_cfg speedyFFTPlan;
+typedef kiss_fft_scalar speedyFFTInput;
+#else
+typedef kiss_fft_cfg speedyFFTPlan;
+typedef kiss_fft_cpx speedyFFTInput;
+#endif  /* SPEEDY_REAL_FFT */
+typedef kiss_fft_cpx speedyFFTOutput;
+#else
+typedef fftw_plan speedyFFTPlan;
+#ifdef  SPEEDY_REAL_FFT
+typedef double speedyFFTInput;
+#else
+typedef fftw_complex speedyFFTInput;
+#endif  /* SPEEDY_REAL_FFT */
+typedef fftw_complex speedyFFTOutput;
+#endif  /* KISS_FFT */
+
 /*****************************************************************************
- * speedyStreamStruct - Contains all the state for the stream.
+ * speedySharedTables - The analysis window and FFT plans for one window and
+ * FFT size, shared by all the streams that use them (see speedyAcquireTables).
+ *****************************************************************************/
+#define kSpeedyIdlePlanCount 4
+struct speedySharedTablesStruct {
+  int window_size;
+  int fft_size;
+  int reference_count;               /* Streams using these tables */
+  float* window;                     /* Read only once designed */
+  /* Plans of destroyed streams, ready for the next one.  Each stream has its
+   * own plan while it lives, since kiss_fftr keeps scratch in its plan.
+   */
+  speedyFFTPlan idle_plans[kSpeedyIdlePlanCount];
+  int idle_plan_count;
+  struct speedySharedTablesStruct* next;
+};
+typedef struct speedySharedTablesStruct* speedySharedTables;
+
+/*****************************************************************************
+ * speedyStreamStruct - Contains all the state for the stream.  The structure
+ * and all its buffers are one allocation (see speedyCreateStreamWithFFT), so
+ * none of the pointers below are freed on their own.
  *****************************************************************************/
 struct speedyStreamStruct {
   int sample_rate;                        /* samples per second, Hz */
   int window_size;                        /* Number of samples in analysis */
   int fft_size;                           /* Should be > window_size */
-  float* window;                          /* Cache the window for later use */
+  int spectrogram_size;                   /* Bins kept from each FFT */
+  int power_of_two_fft;                   /* See speedyCreatePowerOfTwoStream */
+  speedySharedTables tables;              /* Window and plans, shared */
+  const float* window;                    /* tables->window */
   float* input;
   /* Last frame number received for processing via speedyAddData() */
   int64_t current_time;
-  float* spectrogram;                     /* Output of FFT routine, temporary */
-  float* last_spectrogram;
-  float* spectrogram_history[kSpectrogramBufferSize];
+  float* spectrogram;                     /* The last FFT magnitudes computed */
+  float* spectrogram_scratch;             /* For speedySpectrogram() calls */
+  /* kSpectrogramBufferSize rows of spectrogram_size, a ring indexed by frame
+   * time.  Each frame's magnitudes are computed straight into its row.
+   */
+  float* spectrogram_history;
+  /* For each row, the band energy of a frame the silence gate skipped (the
+   * row is zeros unless the next frame needed it), or -1.
+   */
+  float gated_energy[kSpectrogramBufferSize];
+  int silence_gate;                       /* See speedySetSilenceGate */
+  float* gated_input;                     /* Preemphasized last gated frame */
+  int64_t gated_input_time;               /* Its frame time, or -1 */
   float* normalized_spectrogram;
   float* normalized_last_spectrogram;
-#ifdef  KISS_FFT
-  kiss_fft_cpx* input_buffer;
-  kiss_fft_cpx* fft_buffer;
-  kiss_fft_cfg spectrogram_plan;
-#else
-  fftw_complex* input_buffer;
-  fftw_complex* fft_buffer;
-  fftw_plan spectrogram_plan;
-#endif  /* KISS_FFT */
+  speedyFFTInput* input_buffer;
+  speedyFFTOutput* fft_buffer;
+  speedyFFTPlan spectrogram_plan;          /* Taken from the shared tables */
   float *hysteresis_buffer;
   int64_t hysteresis_index;    /* So it never wraps, even with long input */
+  /* Triangular tapers applied to the future and past hysteresis frames. */
+  float future_taper[kTemporalHysteresisFuture+1];
+  float past_taper[kTemporalHysteresisPast+1];
+  int lookahead;               /* Future frames each tension waits for */
   float preemph_state;
   float preemphasis_factor;
   float low_energy_threshold_scale;
@@ -181,6 +247,9 @@ struct speedyStreamStruct {
   /* Internal state for debugging and testing purposes. */
   int skipped_frames;
   float features[kFeatureValueCount];
+#ifdef  SPEEDY_STATS
+  speedyStats stats;    /* Kept across resets, see speedyResetStats() */
+#endif
 };
 
 /* Just used for debugging */
@@ -208,19 +277,234 @@ int modulo(int x, int N){
 }
 
 
+/* The tables of every window and FFT size used so far.  They outlive their
+ * streams, so creating the next stream (for the next track, say) costs no
+ * window design or FFT planning; speedyFreeCachedTables() frees the unused
+ * ones.  Built with SPEEDY_PTHREADS streams can be created on any thread, so
+ * the list is locked (FFTW planning isn't thread safe either).
+ */
+static speedySharedTables speedy_shared_tables = NULL;
+#ifdef  SPEEDY_PTHREADS
+static pthread_mutex_t speedy_shared_tables_lock = PTHREAD_MUTEX_INITIALIZER;
+#define SPEEDY_LOCK_TABLES() pthread_mutex_lock(&speedy_shared_tables_lock)
+#define SPEEDY_UNLOCK_TABLES() pthread_mutex_unlock(&speedy_shared_tables_lock)
+#else
+#define SPEEDY_LOCK_TABLES()
+#define SPEEDY_UNLOCK_TABLES()
+#endif  /* SPEEDY_PTHREADS */
+
+static void speedyDestroyPlan(speedyFFTPlan plan) {
+#ifdef  KISS_FFT
+  free(plan);
+#else
+  fftw_destroy_plan(plan);
+#endif  /* KISS_FFT */
+}
+
+/* Plan an FFT of the stream's size.  FFTW plans are made for the stream's
+ * buffers but run with fftw_execute_dft*, so any stream of the size can use
+ * them.  The buffers come from the stream's arena, not fftw_malloc, so their
+ * alignment can differ from stream to stream: plan with FFTW_UNALIGNED.
+ */
+static speedyFFTPlan speedyCreatePlan(speedyStream stream) {
+#ifdef  KISS_FFT
+#ifdef  SPEEDY_REAL_FFT
+  /* kiss_fftr needs an even size, which the FFT size always is. */
+  return kiss_fftr_alloc(stream->fft_size, 0, NULL, NULL);
+#else
+  return kiss_fft_alloc(stream->fft_size, 0, NULL, NULL);
+#endif  /* SPEEDY_REAL_FFT */
+#else
+#ifdef  SPEEDY_REAL_FFT
+  return fftw_plan_dft_r2c_1d(stream->fft_size, stream->input_buffer,
+                              stream->fft_buffer,
+                              FFTW_ESTIMATE | FFTW_UNALIGNED);
+#else
+  /* Use complex->complex because that is what is done internally by FFTW. */
+  return fftw_plan_dft_1d(stream->fft_size, stream->input_buffer,
+                          stream->fft_buffer, FFTW_FORWARD,
+                          FFTW_ESTIMATE | FFTW_UNALIGNED);
+#endif  /* SPEEDY_REAL_FFT */
+#endif  /* KISS_FFT */
+}
+
+/* Find (or make) the tables for the stream's sizes and take a plan from them.
+ * Return 0 only if we are out of memory.
+ */
+static int speedyAcquireTables(speedyStream stream) {
+  speedySharedTables tables;
+  int i, ok = 1;
+
+  SPEEDY_LOCK_TABLES();
+  for (tables = speedy_shared_tables; tables; tables = tables->next) {
+    if (tables->window_size == stream->window_size &&
+        tables->fft_size == stream->fft_size) {
+      break;
+    }
+  }
+  if (!tables) {
+    tables = (speedySharedTables)calloc(
+        1, sizeof(struct speedySharedTablesStruct));
+    float* window = (float *) malloc(sizeof(float)*stream->window_size);
+    if (!tables || !window) {
+      free(tables);
+      free(window);
+      SPEEDY_UNLOCK_TABLES();
+      return 0;
+    }
+    /* Design the Hamming window used when computing the spectrogram. */
+    for (i=0; i < stream->window_size; i++) {
+      window[i] = 0.54 - 0.46*cos(2*M_PI*i / (stream->window_size-1.0));
+    }
+    tables->window_size = stream->window_size;
+    tables->fft_size = stream->fft_size;
+    tables->window = window;
+    tables->next = speedy_shared_tables;
+    speedy_shared_tables = tables;
+  }
+  if (tables->idle_plan_count > 0) {
+    stream->spectrogram_plan = tables->idle_plans[--tables->idle_plan_count];
+  } else {
+    stream->spectrogram_plan = speedyCreatePlan(stream);
+    ok = stream->spectrogram_plan != 0;
+  }
+  if (ok) {
+    tables->reference_count++;
+    stream->tables = tables;
+    stream->window = tables->window;
+  }
+  SPEEDY_UNLOCK_TABLES();
+  return ok;
+}
+
+/* Give the stream's plan back to its tables, keeping a few for reuse. */
+static void speedyReleaseTables(speedyStream stream) {
+  speedySharedTables tables = stream->tables;
+
+  SPEEDY_LOCK_TABLES();
+  if (tables->idle_plan_count < kSpeedyIdlePlanCount) {
+    tables->idle_plans[tables->idle_plan_count++] = stream->spectrogram_plan;
+  } else {
+    speedyDestroyPlan(stream->spectrogram_plan);
+  }
+  tables->reference_count--;
+  SPEEDY_UNLOCK_TABLES();
+  stream->tables = NULL;
+  stream->spectrogram_plan = 0;
+}
+
+void speedyFreeCachedTables(void) {
+  speedySharedTables* link = &speedy_shared_tables;
+  int i;
+
+  SPEEDY_LOCK_TABLES();
+  while (*link) {
+    speedySharedTables tables = *link;
+    for (i=0; i < tables->idle_plan_count; i++) {
+      speedyDestroyPlan(tables->idle_plans[i]);
+    }
+    tables->idle_plan_count = 0;
+    if (tables->reference_count > 0) {
+      link = &tables->next;
+      continue;
+    }
+    *link = tables->next;
+    free(tables->window);
+    free(tables);
+  }
+#ifdef  KISS_FFT
+  kiss_fft_cleanup();
+#endif  /* KISS_FFT */
+  SPEEDY_UNLOCK_TABLES();
+}
+
+/* Reserve bytes at the end of an arena of size bytes, returning their offset.
+ * Every piece is kSpeedyArenaAlignment aligned, as calloc's result is, for
+ * SIMD loads.  That can be less than FFTW's own alignment, hence
+ * FFTW_UNALIGNED in speedyCreatePlan().
+ */
+#define kSpeedyArenaAlignment 16
+static size_t speedyArenaReserve(size_t* size, size_t bytes) {
+  size_t offset = *size;
+  *size += (bytes + kSpeedyArenaAlignment - 1) &
+      ~(size_t)(kSpeedyArenaAlignment - 1);
+  return offset;
+}
+
+/* The analysis the long-term means below were measured with, in Matlab. */
+#define kReferenceWindowSize  330   /* At 22050 Hz */
+#define kReferenceFFTSize     660
+
 /* Create a speedy stream.  Return NULL only if we are out of memory and cannot
    allocate the stream. Design the windows and filters, initialize the FFT
-   package, and allocate all the storage. */
-speedyStream speedyCreateStream(int sample_rate) {
-  speedyStream stream = (speedyStream)calloc(1,
-                                             sizeof(struct speedyStreamStruct));
+   package, and allocate all the storage.  Use a power of two FFT size if
+   power_of_two is set, else twice the window size. */
+static speedyStream speedyCreateStreamWithFFT(int sample_rate,
+                                              int power_of_two) {
+  int window_size = (int)(1.5*sample_rate/(float)kFrameRateHz);
+  int fft_size = 2*window_size;
+  if (power_of_two) {
+    fft_size = 2;
+    while (fft_size < 2*window_size) {
+      fft_size *= 2;
+    }
+  }
+#ifdef  SPEEDY_REAL_FFT
+  /* Only the non-negative frequencies of the real input are computed (and
+   * kept in the history). Everything downstream only looks at bins 1 through
+   * fft_size/2-1 anyway.
+   */
+  int spectrogram_size = fft_size/2 + 1;
+#else
+  int spectrogram_size = fft_size;
+#endif  /* SPEEDY_REAL_FFT */
 
-  if (stream == NULL) {
+  /* Lay out the structure and its buffers in one cleared allocation.  This
+   * also clears the zero padding past window_size, which is never written.
+   */
+  size_t arena_size = 0;
+  speedyArenaReserve(&arena_size, sizeof(struct speedyStreamStruct));
+  size_t input_offset = speedyArenaReserve(&arena_size,
+                                           sizeof(float)*window_size);
+  size_t hysteresis_offset = speedyArenaReserve(
+      &arena_size, sizeof(float)*kTemporalHysteresisBufferSize);
+  size_t input_buffer_offset = speedyArenaReserve(
+      &arena_size, sizeof(speedyFFTInput)*fft_size);
+  size_t fft_buffer_offset = speedyArenaReserve(
+      &arena_size, sizeof(speedyFFTOutput)*spectrogram_size);
+  size_t normalized_offset = speedyArenaReserve(
+      &arena_size, sizeof(float)*spectrogram_size);
+  size_t normalized_last_offset = speedyArenaReserve(
+      &arena_size, sizeof(float)*spectrogram_size);
+  size_t scratch_offset = speedyArenaReserve(
+      &arena_size, sizeof(float)*spectrogram_size);
+  size_t history_offset = speedyArenaReserve(
+      &arena_size, sizeof(float)*spectrogram_size*kSpectrogramBufferSize);
+  size_t gated_input_offset = speedyArenaReserve(&arena_size,
+                                                 sizeof(float)*window_size);
+  char* arena = (char*)calloc(1, arena_size);
+
+  if (arena == NULL) {
     return NULL;
   }
-  stream->window_size = (int)(1.5*sample_rate/(float)kFrameRateHz);
-  stream->fft_size = 2*stream->window_size;
+  speedyStream stream = (speedyStream)arena;
+  stream->window_size = window_size;
+  stream->fft_size = fft_size;
+  stream->spectrogram_size = spectrogram_size;
+  stream->input = (float*)(arena + input_offset);
+  stream->hysteresis_buffer = (float*)(arena + hysteresis_offset);
+  stream->input_buffer = (speedyFFTInput*)(arena + input_buffer_offset);
+  stream->fft_buffer = (speedyFFTOutput*)(arena + fft_buffer_offset);
+  stream->normalized_spectrogram = (float*)(arena + normalized_offset);
+  stream->normalized_last_spectrogram =
+      (float*)(arena + normalized_last_offset);
+  stream->spectrogram_scratch = (float*)(arena + scratch_offset);
+  stream->spectrogram = stream->spectrogram_scratch;
+  stream->spectrogram_history = (float*)(arena + history_offset);
+  stream->gated_input = (float*)(arena + gated_input_offset);
+
   stream->sample_rate = sample_rate;
+  stream->power_of_two_fft = power_of_two;
   stream->current_time = 0;
   stream->preemph_state = 0.0;
   stream->preemphasis_factor = 0.97f;
@@ -232,46 +516,15 @@ speedyStream speedyCreateStream(int sample_rate) {
   stream->tension_offset_speech = 1.0f;
   stream->speech_change_cap_multiplier = 4.0f;
   stream->hysteresis_index = 0;
-  stream->input = (float *) malloc(sizeof(float) * stream->window_size);
-  stream->hysteresis_buffer = (float *) malloc(sizeof(float) *
-                                               kTemporalHysteresisBufferSize);
-#ifdef  KISS_FFT
-  stream->fft_buffer = (kiss_fft_cpx *) malloc(sizeof(kiss_fft_cpx) *
-                                               stream->fft_size);
-  stream->input_buffer = (kiss_fft_cpx *) malloc(sizeof(kiss_fft_cpx) *
-                                                 stream->fft_size);
-#else
-  stream->fft_buffer = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) *
-                                                    stream->fft_size);
-  stream->input_buffer = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) *
-                                                      stream->fft_size);
-#endif  /* KISS_FFT */
-  stream->normalized_spectrogram = (float *) malloc(sizeof(float) *
-                                                    stream->fft_size);
-  stream->normalized_last_spectrogram = (float *) malloc(sizeof(float) *
-                                                         stream->fft_size);
-  stream->spectrogram = (float *) malloc(sizeof(float) * stream->fft_size);
+  stream->lookahead = kTemporalHysteresisFuture;
+  stream->silence_gate = 0;
   stream->spectrogram_plan = 0;    /* Will allocate later. */
-  stream->window = (float *) malloc(sizeof(float)*stream->window_size);
 
-  int i, j;
-  for (i=0; i < kSpectrogramBufferSize; i++) {
-    stream->spectrogram_history[i] = (float *) malloc(sizeof(float)*
-                                                       stream->fft_size);
-    for (j=0; j < stream->fft_size; j++) {
-     stream->spectrogram_history[i][j] = 0.0;
-    }
-  }
-  if (!stream->input || !stream->input_buffer || !stream->spectrogram ||
-      !stream->hysteresis_buffer || !stream->fft_buffer ||
-      !stream->normalized_spectrogram || !stream->normalized_last_spectrogram) {
+  int i;
+  if (!speedyAcquireTables(stream)) {
     speedyDestroyStream(stream);
     return NULL;
   }
-  /* Design the Hamming window used when computing the spectrogram. */
-  for (i=0; i < stream->window_size; i++) {
-    stream->window[i] = 0.54 - 0.46*cos(2*M_PI*i / (stream->window_size-1.0));
-  }
   /* The following constants were calculated from the Matlab implementation
    * by running the feature calculation over the BillForShortExerpt and
    * calculating the mean for each feature.
@@ -281,65 +534,95 @@ speedyStream speedyCreateStream(int sample_rate) {
   stream->mean_emphasis_weighted_lpf = 123.979;
   stream->mean_relative_spectral_difference = 0.971975;
   stream->max_energy_hysteresis = 1.41421;
-#ifdef  KISS_FFT
-  stream->spectrogram_plan = kiss_fft_alloc(stream->fft_size, 0, NULL, NULL);
-#else
-  /* Initialize the FFT software.  Use complex->complex because that is what is
-   * done internally by FFTW.
-   */
-  stream->spectrogram_plan = fftw_plan_dft_1d(stream->fft_size,
-                                              stream->input_buffer,
-                                              stream->fft_buffer,
-                                              FFTW_FORWARD, FFTW_ESTIMATE);
-#endif  /* KISS_FFT */
-  if (!stream->spectrogram_plan) {
-    speedyDestroyStream(stream);
-    return NULL;
+  if (power_of_two) {
+    /* Rescale the means to this analysis, so the energy filter starts at the
+     * same relative level and the spectral difference normalization stays
+     * comparable.  Frame energy grows with the window and FFT sizes
+     * (Parseval) and the spectral difference with the number of bins.
+     */
+    float energy_scale = stream->window_size*(float)stream->fft_size /
+        (kReferenceWindowSize*(float)kReferenceFFTSize);
+    float bin_scale = stream->fft_size/(float)kReferenceFFTSize;
+    stream->mean_spectrogram_energy *= energy_scale;
+    stream->mean_emphasis_weighted_local_difference *= bin_scale;
+    stream->mean_emphasis_weighted_lpf *= bin_scale;
   }
-
-  for (i=0; i < kTemporalHysteresisBufferSize; i++){
-    stream->hysteresis_buffer[i] = 0.0;
+  for (i=0; i <= kTemporalHysteresisFuture; i++) {
+    stream->future_taper[i] =
+        (kTemporalHysteresisFuture-i)/(float)kTemporalHysteresisFuture;
+  }
+  for (i=0; i <= kTemporalHysteresisPast; i++) {
+    stream->past_taper[i] =
+        (kTemporalHysteresisPast-i)/(float)kTemporalHysteresisPast;
   }
   DesignFirstOrderLowpassFilter(&stream->energy_filter, kFrameRateHz);
-  SetFirstOrderFilterState(&stream->energy_filter,
-                           stream->mean_spectrogram_energy);
   DesignFirstOrderLowpassFilter(&stream->difference_filter, kFrameRateHz);
-  SetFirstOrderFilterState(&stream->difference_filter,
-                           stream->mean_emphasis_weighted_local_difference);
-  stream->skip_frame_count = 1;          /* Skip the first frame */
-
-  stream->current_duration = 0.0;
-  stream->desired_duration = 0.0;
+  speedyResetStream(stream, NULL);
 
   return stream;
 }
 
-/* Destroy the speedy stream by first freeing all the allocated storage. */
-void speedyDestroyStream(speedyStream stream) {
-  if (stream->input) free(stream->input);
-  if (stream->hysteresis_buffer) free(stream->hysteresis_buffer);
-#ifdef  KISS_FFT
-  if (stream->fft_buffer) free(stream->fft_buffer);
-  if (stream->input_buffer) free(stream->input_buffer);
-  if (stream->spectrogram_plan) free(stream->spectrogram_plan);
-  kiss_fft_cleanup();
-#else
-  if (stream->fft_buffer) fftw_free(stream->fft_buffer);
-  if (stream->input_buffer) fftw_free(stream->input_buffer);
-  if (stream->spectrogram_plan) fftw_destroy_plan(stream->spectrogram_plan);
-#endif  /* KISS_FFT */
-  if (stream->normalized_spectrogram) free(stream->normalized_spectrogram);
-  if (stream->normalized_last_spectrogram) {
-      free(stream->normalized_last_spectrogram);
-  }
-  if (stream->spectrogram) free(stream->spectrogram);
-  if (stream->window) free(stream->window);
+speedyStream speedyCreateStream(int sample_rate) {
+  return speedyCreateStreamWithFFT(sample_rate, 0);
+}
+
+speedyStream speedyCreatePowerOfTwoStream(int sample_rate) {
+  return speedyCreateStreamWithFFT(sample_rate, 1);
+}
+
+/* Forget all the audio seen so far, as if the stream had just been created,
+ * but keep the allocations, the FFT plan and the tuning parameters.  The
+ * filters either restart from the long-term means, or from a checkpoint.
+ */
+void speedyResetStream(speedyStream stream,
+                       const speedyCheckpoint* checkpoint) {
+  assert(stream);
   int i;
+  stream->current_time = 0;
+  stream->preemph_state = 0.0;
+  stream->hysteresis_index = 0;
+  for (i=0; i < kTemporalHysteresisBufferSize; i++){
+    stream->hysteresis_buffer[i] = 0.0;
+  }
+  memset(stream->spectrogram_history, 0,
+         sizeof(float)*stream->spectrogram_size*kSpectrogramBufferSize);
   for (i=0; i < kSpectrogramBufferSize; i++) {
-    if (stream->spectrogram_history[i]) {
-      free(stream->spectrogram_history[i]);
-    }
+    stream->gated_energy[i] = -1.0;
+  }
+  stream->gated_input_time = -1;
+  memset(stream->features, 0, sizeof(stream->features));
+  if (checkpoint) {
+    SetFirstOrderFilterState(&stream->energy_filter, checkpoint->energy_lp);
+    SetFirstOrderFilterState(&stream->difference_filter,
+                             checkpoint->emphasis_weighted_lpf);
+    stream->current_duration = checkpoint->current_duration;
+    stream->desired_duration = checkpoint->desired_duration;
+  } else {
+    SetFirstOrderFilterState(&stream->energy_filter,
+                             stream->mean_spectrogram_energy);
+    SetFirstOrderFilterState(&stream->difference_filter,
+                             stream->mean_emphasis_weighted_local_difference);
+    stream->current_duration = 0.0;
+    stream->desired_duration = 0.0;
   }
+  stream->skip_frame_count = 1;          /* Skip the first frame */
+  stream->skipped_frames = 0;
+}
+
+void speedyGetCheckpoint(speedyStream stream, speedyCheckpoint* checkpoint) {
+  assert(stream);
+  assert(checkpoint);
+  checkpoint->energy_lp = stream->energy_filter.state;
+  checkpoint->emphasis_weighted_lpf = stream->difference_filter.state;
+  checkpoint->current_duration = stream->current_duration;
+  checkpoint->desired_duration = stream->desired_duration;
+}
+
+/* Destroy the speedy stream, giving back its plan.  Everything else is in
+ * the stream's one allocation.
+ */
+void speedyDestroyStream(speedyStream stream) {
+  if (stream->tables) speedyReleaseTables(stream);
   free(stream);
 }
 
@@ -358,6 +641,11 @@ int speedyFFTSize(speedyStream stream) {
   return stream->fft_size;
 }
 
+int speedySpectrogramSize(speedyStream stream) {
+  assert(stream);
+  return stream->spectrogram_size;
+}
+
 float speedyBinToFreq(speedyStream stream, int bin_number) {
   assert(stream);
   return bin_number * (stream->sample_rate/(float)stream->fft_size);
@@ -416,6 +704,171 @@ float* speedyGetInternalNormalizedSpectrogram(speedyStream stream) {
   return stream->normalized_spectrogram;
 }
 
+/*****************************************************************************
+ * Per-frame kernels.  These few loops are where the per-frame analysis time
+ * goes, so each one walks its arrays only once.  The scalar versions keep the
+ * order of operations of the original code, so results don't change.  When
+ * built for WebAssembly SIMD (-msimd128) four bins are processed at a time,
+ * the sums are reassociated across lanes, and the log in the spectral
+ * difference is replaced by a fast approximation (relative error < 1e-7).
+ *****************************************************************************/
+
+#if defined(KISS_FFT) && defined(SPEEDY_REAL_FFT)
+/* Multiply a frame by the analysis window, for the real KISS FFT, whose input
+ * is plain floats.
+ */
+static void speedyWindowFrame(const float* input, const float* window,
+                              float* output, int length) {
+  int i = 0;
+#ifdef  __wasm_simd128__
+  for (; i + 4 <= length; i += 4) {
+    wasm_v128_store(&output[i], wasm_f32x4_mul(wasm_v128_load(&input[i]),
+                                               wasm_v128_load(&window[i])));
+  }
+#endif  /* __wasm_simd128__ */
+  for (; i < length; i++) {
+    output[i] = input[i] * window[i];
+  }
+}
+#endif  /* KISS_FFT && SPEEDY_REAL_FFT */
+
+/* Return the energy (sum of squares) of a spectrogram slice, skipping the DC
+ * term, and its maximum over the same bins in *max_value.
+ */
+static float speedyBandEnergy(const float* spectrogram, int length,
+                              float* max_value) {
+  int i = 1;                           /* Skip the DC term */
+  float signal_energy = 0.0;
+  float maximum = 0.0;
+#ifdef  __wasm_simd128__
+  v128_t energy4 = wasm_f32x4_splat(0.0f);
+  v128_t maximum4 = wasm_f32x4_splat(0.0f);
+  for (; i + 4 <= length; i += 4) {
+    v128_t bins = wasm_v128_load(&spectrogram[i]);
+    energy4 = wasm_f32x4_add(energy4, wasm_f32x4_mul(bins, bins));
+    maximum4 = wasm_f32x4_max(maximum4, bins);
+  }
+  signal_energy = (wasm_f32x4_extract_lane(energy4, 0) +
+                   wasm_f32x4_extract_lane(energy4, 1)) +
+                  (wasm_f32x4_extract_lane(energy4, 2) +
+                   wasm_f32x4_extract_lane(energy4, 3));
+  maximum = fmaxf(fmaxf(wasm_f32x4_extract_lane(maximum4, 0),
+                        wasm_f32x4_extract_lane(maximum4, 1)),
+                  fmaxf(wasm_f32x4_extract_lane(maximum4, 2),
+                        wasm_f32x4_extract_lane(maximum4, 3)));
+#endif  /* __wasm_simd128__ */
+  for (; i < length; i++) {
+    signal_energy += spectrogram[i] * spectrogram[i];
+    if (spectrogram[i] > maximum) {
+      maximum = spectrogram[i];
+    }
+  }
+  if (max_value) {
+    *max_value = maximum;
+  }
+  return signal_energy;
+}
+
+/* The scale factor that normalizes a slice with this energy to unit energy. */
+static float speedyInverseNorm(float signal_energy) {
+  const float eps = 2.2204e-16;        /* Smallest increment around 1.0 */
+  return 1.0/(sqrt(signal_energy)+eps);
+}
+
+static void speedyScaleSpectrogram(const float* spectrogram, float scale,
+                                   float* output, int length) {
+  int i = 0;
+#ifdef  __wasm_simd128__
+  v128_t scale4 = wasm_f32x4_splat(scale);
+  for (; i + 4 <= length; i += 4) {
+    wasm_v128_store(&output[i],
+                    wasm_f32x4_mul(wasm_v128_load(&spectrogram[i]), scale4));
+  }
+#endif  /* __wasm_simd128__ */
+  for (; i < length; i++) {
+    output[i] = spectrogram[i]*scale;
+  }
+}
+
+#ifdef  __wasm_simd128__
+/* Natural log of four positive, normal floats.  Split x into 2^e * m with m in
+ * [sqrt(1/2), sqrt(2)), then log(m) = 2*atanh(s) with s = (m-1)/(m+1), which
+ * converges quickly since |s| < 0.172.
+ */
+static v128_t speedyFastLog(v128_t x) {
+  v128_t exponent = wasm_i32x4_shr(
+      wasm_i32x4_sub(x, wasm_i32x4_splat(0x3f3504f3)), 23);  /* sqrt(1/2) */
+  v128_t mantissa = wasm_i32x4_sub(x, wasm_i32x4_shl(exponent, 23));
+  v128_t one = wasm_f32x4_splat(1.0f);
+  v128_t s = wasm_f32x4_div(wasm_f32x4_sub(mantissa, one),
+                            wasm_f32x4_add(mantissa, one));
+  v128_t s2 = wasm_f32x4_mul(s, s);
+  v128_t series = wasm_f32x4_add(
+      wasm_f32x4_splat(1/3.0f),
+      wasm_f32x4_mul(s2, wasm_f32x4_add(
+          wasm_f32x4_splat(1/5.0f),
+          wasm_f32x4_mul(s2, wasm_f32x4_splat(1/7.0f)))));
+  series = wasm_f32x4_mul(wasm_f32x4_add(one, wasm_f32x4_mul(s2, series)),
+                          wasm_f32x4_add(s, s));
+  return wasm_f32x4_add(series,
+                        wasm_f32x4_mul(wasm_f32x4_convert_i32x4(exponent),
+                                       wasm_f32x4_splat(0.69314718f)));
+}
+#endif  /* __wasm_simd128__ */
+
+/* Normalize both slices (bins 0..length-1) by the given inverse norms, and in
+ * the same pass sum the absolute log ratio of the normalized slices over bins
+ * 1..length-1 where both unnormalized bins are above bin_threshold.
+ */
+static float speedyNormalizedLogDifference(const float* spectrogram,
+                                           const float* last_spectrogram,
+                                           float inverse_norm,
+                                           float last_inverse_norm,
+                                           float bin_threshold,
+                                           float* normalized,
+                                           float* normalized_last,
+                                           int length) {
+  const float eps = 2.2204e-16;        /* Smallest increment around 1.0 */
+  float difference = 0.0;
+  int i = 1;
+  normalized[0] = spectrogram[0]*inverse_norm;
+  normalized_last[0] = last_spectrogram[0]*last_inverse_norm;
+#ifdef  __wasm_simd128__
+  v128_t scale4 = wasm_f32x4_splat(inverse_norm);
+  v128_t last_scale4 = wasm_f32x4_splat(last_inverse_norm);
+  v128_t threshold4 = wasm_f32x4_splat(bin_threshold);
+  v128_t eps4 = wasm_f32x4_splat(eps);
+  v128_t difference4 = wasm_f32x4_splat(0.0f);
+  for (; i + 4 <= length; i += 4) {
+    v128_t bins = wasm_v128_load(&spectrogram[i]);
+    v128_t last_bins = wasm_v128_load(&last_spectrogram[i]);
+    v128_t scaled = wasm_f32x4_mul(bins, scale4);
+    v128_t last_scaled = wasm_f32x4_mul(last_bins, last_scale4);
+    wasm_v128_store(&normalized[i], scaled);
+    wasm_v128_store(&normalized_last[i], last_scaled);
+    v128_t ratio = wasm_f32x4_abs(wasm_f32x4_sub(
+        speedyFastLog(wasm_f32x4_add(scaled, eps4)),
+        speedyFastLog(wasm_f32x4_add(last_scaled, eps4))));
+    v128_t valid = wasm_v128_and(wasm_f32x4_gt(bins, threshold4),
+                                 wasm_f32x4_gt(last_bins, threshold4));
+    difference4 = wasm_f32x4_add(difference4, wasm_v128_and(ratio, valid));
+  }
+  difference = (wasm_f32x4_extract_lane(difference4, 0) +
+                wasm_f32x4_extract_lane(difference4, 1)) +
+               (wasm_f32x4_extract_lane(difference4, 2) +
+                wasm_f32x4_extract_lane(difference4, 3));
+#endif  /* __wasm_simd128__ */
+  for (; i < length; i++) {
+    normalized[i] = spectrogram[i]*inverse_norm;
+    normalized_last[i] = last_spectrogram[i]*last_inverse_norm;
+    if (spectrogram[i] > bin_threshold && last_spectrogram[i] > bin_threshold) {
+      difference += fabs(log((normalized[i] + eps) /
+                             (normalized_last[i] + eps)));
+    }
+  }
+  return difference;
+}
+
 /*****************************************************************************
  * Functions run at AddData time.  When the user sends data to Speedy, only
  * the computations that don't depend on future time are done at this time.
@@ -425,21 +878,27 @@ float* speedyGetInternalNormalizedSpectrogram(speedyStream stream) {
  * (The rest of the computations are done when the tension is computed.)
  *****************************************************************************/
 
-/* Implement the standard preemphasis filter used in speech analysis systems.
- * Do the filtering in place, returning the count samples in the input array.
+/* Implement the standard preemphasis filter used in speech analysis systems,
+ * filtering input into output, which may be the same array.
  * In Matlab this is written: filter([1 -.97], 1, input).
  */
-void speedyPreemphasisFilter(speedyStream stream, float* input, int length) {
+static void speedyPreemphasize(speedyStream stream, const float* input,
+                               float* output, int length) {
   int i;
-  assert(stream);
-  assert(input);
   for (i=0; i < length; i++) {
     float last_sample = input[i];
-    input[i] = 1.0*input[i] - stream->preemphasis_factor*stream->preemph_state;
+    output[i] = 1.0*input[i] - stream->preemphasis_factor*stream->preemph_state;
     stream->preemph_state = last_sample;
   }
 }
 
+/* Do the filtering in place, returning the count samples in the input array. */
+void speedyPreemphasisFilter(speedyStream stream, float* input, int length) {
+  assert(stream);
+  assert(input);
+  speedyPreemphasize(stream, input, input, length);
+}
+
 
 /* Compute the spectrogram of an input signal (usually after preemphasis.)
  * This is done at AddData time.  It is used in the energy calculation at this
@@ -451,8 +910,33 @@ float kiss_abs(kiss_fft_cpx c) {
   return sqrt(c.r*c.r + c.i*c.i);
 }
 
-float* speedySpectrogram(speedyStream stream, float input[]) {
-  assert(stream);
+static void speedyMagnitudes(const kiss_fft_cpx* fft, float* magnitudes,
+                             int count) {
+  int i = 0;
+#ifdef  __wasm_simd128__
+  for (; i + 4 <= count; i += 4) {
+    v128_t low = wasm_v128_load(&fft[i]);       /* r0 i0 r1 i1 */
+    v128_t high = wasm_v128_load(&fft[i+2]);    /* r2 i2 r3 i3 */
+    v128_t real = wasm_i32x4_shuffle(low, high, 0, 2, 4, 6);
+    v128_t imag = wasm_i32x4_shuffle(low, high, 1, 3, 5, 7);
+    wasm_v128_store(&magnitudes[i], wasm_f32x4_sqrt(
+        wasm_f32x4_add(wasm_f32x4_mul(real, real),
+                       wasm_f32x4_mul(imag, imag))));
+  }
+#endif  /* __wasm_simd128__ */
+  for (; i < count; i++) {
+    magnitudes[i] = kiss_abs(fft[i]);
+  }
+}
+
+/* Window the input and put its FFT magnitudes in spectrogram. */
+static void speedyComputeSpectrogram(speedyStream stream, const float* input,
+                                     float* spectrogram) {
+#ifdef  SPEEDY_REAL_FFT
+  speedyWindowFrame(input, stream->window, stream->input_buffer,
+                    stream->window_size);
+  kiss_fftr(stream->spectrogram_plan, stream->input_buffer, stream->fft_buffer);
+#else
   int i;
   for (i=0; i < stream->window_size; i++) {
     stream->input_buffer[i].r = input[i] * stream->window[i];
@@ -463,43 +947,60 @@ float* speedySpectrogram(speedyStream stream, float input[]) {
     stream->input_buffer[i].i = 0.0;
   }
   kiss_fft(stream->spectrogram_plan, stream->input_buffer, stream->fft_buffer);
-  for (i=0; i < stream->fft_size; i++) {
-    stream->spectrogram[i] = kiss_abs(stream->fft_buffer[i]);
-  }
-  return stream->spectrogram;
+#endif  /* SPEEDY_REAL_FFT */
+  speedyMagnitudes(stream->fft_buffer, spectrogram, stream->spectrogram_size);
 }
 
 #else
 
-float* speedySpectrogram(speedyStream stream, float input[]) {
-  assert(stream);
+static void speedyComputeSpectrogram(speedyStream stream, const float* input,
+                                     float* spectrogram) {
   int i;
+#ifdef  SPEEDY_REAL_FFT
+  for (i=0; i < stream->window_size; i++) {
+    stream->input_buffer[i] = input[i] * stream->window[i];
+  }
+#else
   for (i=0; i < stream->window_size; i++) {
     stream->input_buffer[i] = CMPLX(input[i] * stream->window[i], 0);
   }
   for (i=stream->window_size; i < stream->fft_size; i++) {
     stream->input_buffer[i] = CMPLX(0, 0);
   }
-  fftw_execute(stream->spectrogram_plan); /* repeat as needed */
-  for (i=0; i < stream->fft_size; i++) {
+#endif  /* SPEEDY_REAL_FFT */
+#ifdef  SPEEDY_REAL_FFT
+  fftw_execute_dft_r2c(stream->spectrogram_plan, stream->input_buffer,
+                       stream->fft_buffer);
+#else
+  fftw_execute_dft(stream->spectrogram_plan, stream->input_buffer,
+                   stream->fft_buffer);
+#endif  /* SPEEDY_REAL_FFT */
+  for (i=0; i < stream->spectrogram_size; i++) {
     complex double b = stream->fft_buffer[i];
-    stream->spectrogram[i] = cabs(b);
+    spectrogram[i] = cabs(b);
   }
-  return stream->spectrogram;
 }
 #endif  /* KISS_FFT */
 
+/* Compute a spectrogram slice outside of the history. */
+float* speedySpectrogram(speedyStream stream, float input[]) {
+  assert(stream);
+  stream->spectrogram = stream->spectrogram_scratch;
+  speedyComputeSpectrogram(stream, input, stream->spectrogram);
+  return stream->spectrogram;
+}
+
 void speedySaveSpectrogramData(speedyStream stream, float spectrogram[],
                               int64_t at_time) {
-  int i;
-  for (i=0; i < stream->fft_size; i++) {
-    stream->spectrogram_history[modulo(at_time, kSpectrogramBufferSize)][i] =
-        spectrogram[i];
+  float* row = speedyGetSpectrogramAtTime(stream, at_time);
+  if (row != spectrogram) {
+    memcpy(row, spectrogram, sizeof(float)*stream->spectrogram_size);
   }
 }
 
 float *speedyGetSpectrogramAtTime(speedyStream stream, int64_t at_time) {
-    return stream->spectrogram_history[modulo(at_time, kSpectrogramBufferSize)];
+    return stream->spectrogram_history +
+        modulo(at_time, kSpectrogramBufferSize)*stream->spectrogram_size;
 }
 
 /* To estimate local emphasis, we first calculate the local energy. We
@@ -523,13 +1024,10 @@ float *speedyGetSpectrogramAtTime(speedyStream stream, int64_t at_time) {
  * And then add the s_energy_compressed energy to the hystersis buffer.
  */
 
-void speedyComputeLocalEnergy(speedyStream stream, float *spectrogram,
-                              int64_t at_time) {
-  int i;
-  float my_spectrogram_energy = 0.0;
-  for (i=1; i < stream->fft_size/2; i++) {
-    my_spectrogram_energy += stream->spectrogram[i]*stream->spectrogram[i];
-  }
+/* The recursive part of the above, given the frame's spectrogram energy. */
+static void speedyUpdateLocalEnergy(speedyStream stream,
+                                    float my_spectrogram_energy,
+                                    int64_t at_time) {
   s_energy_lp = IterateFirstOrderFilter(&stream->energy_filter,
                                       my_spectrogram_energy);
   s_energy_local = my_spectrogram_energy / s_energy_lp;
@@ -538,14 +1036,104 @@ void speedyComputeLocalEnergy(speedyStream stream, float *spectrogram,
   s_time_energy = at_time;
 }
 
+void speedyComputeLocalEnergy(speedyStream stream, float *spectrogram,
+                              int64_t at_time) {
+  float my_spectrogram_energy = speedyBandEnergy(stream->spectrogram,
+                                                 stream->fft_size/2, NULL);
+  speedyUpdateLocalEnergy(stream, my_spectrogram_energy, at_time);
+}
+
 float speedyGetEnergyCompressed(speedyStream stream) {
   return s_energy_compressed;
 }
 
+/* The silence gate.  By Parseval's theorem the energy of FFT bins 1 through
+ * fft_size/2-1 (what speedyBandEnergy sums) is
+ *   (fft_size*sum(x^2) - X(0)^2 - X(fft_size/2)^2)/2
+ * for the windowed frame x, and both excluded bins are plain sums of x.  So
+ * the frame energy costs one pass over the window, in double to avoid any
+ * cancellation.  A frame whose energy is clearly (kSilenceGateMargin) below
+ * the low energy threshold is skipped at ComputeTension time whatever its
+ * spectrum, so its FFT isn't needed: only its energy, for the energy filter
+ * and the hysteresis.
+ */
+#define kSilenceGateMargin 0.5
+static int speedyGateFrame(speedyStream stream, const float* input,
+                           float* energy) {
+  double total = 0.0, dc = 0.0, nyquist = 0.0;
+  int i;
+  for (i=0; i + 1 < stream->window_size; i += 2) {
+    double even = input[i] * stream->window[i];
+    double odd = input[i+1] * stream->window[i+1];
+    total += even*even + odd*odd;
+    dc += even + odd;
+    nyquist += even - odd;
+  }
+  if (i < stream->window_size) {
+    double even = input[i] * stream->window[i];
+    total += even*even;
+    dc += even;
+    nyquist += even;
+  }
+  double band_energy = (stream->fft_size*total - dc*dc - nyquist*nyquist)/2;
+  *energy = band_energy > 0.0 ? band_energy : 0.0;
+  return *energy <= kSilenceGateMargin * stream->low_energy_threshold_scale *
+                    stream->max_energy_hysteresis;
+}
+
+/* Analyze one frame of input, which may be stream->input itself.  The
+ * preemphasis filter writes stream->input, so a caller's frame (e.g. a window
+ * straight out of the sonic2 analysis ring) is read once and never copied.
+ */
+static void speedyAnalyzeFrame(speedyStream stream, const float* input,
+                               int64_t at_time) {
+  SPEEDY_STATS_START(preemphasis_start);
+  speedyPreemphasize(stream, input, stream->input, stream->window_size);
+  SPEEDY_STATS_END(&stream->stats, kSpeedyStagePreemphasis, preemphasis_start);
+  SPEEDY_STATS_START(spectrogram_start);
+  /* Straight into the history, no copy. */
+  const int row = modulo(at_time, kSpectrogramBufferSize);
+  float* spectrogram = speedyGetSpectrogramAtTime(stream, at_time);
+  float energy;
+  stream->spectrogram = spectrogram;
+  if (stream->silence_gate && speedyGateFrame(stream, stream->input, &energy)) {
+    /* Keep the input, in case the next frame's spectral difference needs
+     * this spectrogram after all.
+     */
+    memcpy(stream->gated_input, stream->input,
+           sizeof(float)*stream->window_size);
+    stream->gated_input_time = at_time;
+    memset(spectrogram, 0, sizeof(float)*stream->spectrogram_size);
+    stream->gated_energy[row] = energy;
+#ifdef  SPEEDY_STATS
+    stream->stats.gated_frames++;
+#endif
+    SPEEDY_STATS_END(&stream->stats, kSpeedyStageSpectrogram,
+                     spectrogram_start);
+    SPEEDY_STATS_START(energy_start);
+    speedyUpdateLocalEnergy(stream, energy, at_time);
+    SPEEDY_STATS_END(&stream->stats, kSpeedyStageLocalEnergy, energy_start);
+    stream->current_time = at_time;
+    return;
+  }
+  if (stream->gated_input_time == at_time-1) {
+    speedyComputeSpectrogram(stream, stream->gated_input,
+                             speedyGetSpectrogramAtTime(stream, at_time-1));
+  }
+  stream->gated_input_time = -1;
+  stream->gated_energy[row] = -1.0;
+  speedyComputeSpectrogram(stream, stream->input, spectrogram);
+  SPEEDY_STATS_END(&stream->stats, kSpeedyStageSpectrogram, spectrogram_start);
+  SPEEDY_STATS_START(energy_start);
+  speedyComputeLocalEnergy(stream, spectrogram, at_time);
+  SPEEDY_STATS_END(&stream->stats, kSpeedyStageLocalEnergy, energy_start);
+  stream->current_time = at_time;
+}
+
 /* speedyAddData() - Add data to our stream, and compute the current energy.
  * This is called to add some data to the speedy calculation and does the
  * following steps:
- *   Copy the data into our own buffer and apply the preemphasis filter
+ *   Apply the preemphasis filter, writing our own buffer
  *   Compute the spectrogram
  *   Compute the local energy
  *   and update the system's time stamp.
@@ -554,16 +1142,7 @@ float speedyGetEnergyCompressed(speedyStream stream) {
  * divided by 2^15 to put short data in the same range.
  */
 void speedyAddData(speedyStream stream, const float input[], int64_t at_time) {
-  int i;
-  /* Need to make a copy since preemphasis filter is done in place. */
-  for (i=0; i < stream->window_size; i++) {
-    stream->input[i] = input[i];
-  }
-  speedyPreemphasisFilter(stream, stream->input, stream->window_size);
-  float* spectrogram = speedySpectrogram(stream, stream->input);
-  speedySaveSpectrogramData(stream, spectrogram, at_time);
-  speedyComputeLocalEnergy(stream, spectrogram, at_time);
-  stream->current_time = at_time;
+  speedyAnalyzeFrame(stream, input, at_time);
 }
 
 void speedyAddDataShort(speedyStream stream, const int16_t input[],
@@ -573,11 +1152,7 @@ void speedyAddDataShort(speedyStream stream, const int16_t input[],
   for (i=0; i < stream->window_size; i++) {
     stream->input[i] = input[i]/32768.0;
   }
-  speedyPreemphasisFilter(stream, stream->input, stream->window_size);
-  float* spectrogram = speedySpectrogram(stream, stream->input);
-  speedySaveSpectrogramData(stream, spectrogram, at_time);
-  speedyComputeLocalEnergy(stream, spectrogram, at_time);
-  stream->current_time = at_time;
+  speedyAnalyzeFrame(stream, stream->input, at_time);
 }
 
 /*****************************************************************************
@@ -603,24 +1178,40 @@ void speedyAddDataShort(speedyStream stream, const int16_t input[],
 #define HysteresisBuffer(time) \
   (stream->hysteresis_buffer[modulo((time), kTemporalHysteresisBufferSize)])
 
+/* The tapers are precomputed, and the ring position is found once and then
+ * stepped, rather than taking a modulo per tap.  The last tap of each taper has
+ * zero weight so it can never raise a maximum that starts at zero; it is
+ * skipped.  (The taper depends on the distance from at_time, so the maxima
+ * can't be kept with a sliding-window deque without changing the result.)
+ * With a shorter lookahead the future maximum only covers the frames that
+ * have arrived, still with the full taper.
+ */
 float speedyEvaluateHysteresis(speedyStream stream, int64_t at_time) {
   assert(stream);
   assert(at_time >= 0);
-  int i;
+  const float* buffer = stream->hysteresis_buffer;
+  const int center = modulo(at_time, kTemporalHysteresisBufferSize);
+  int i, loc;
   float past_max = 0.0, future_max = 0.0;
-  for (i=0; i <= kTemporalHysteresisFuture; i++) {
-    float value = HysteresisBuffer(at_time+i);
-    value *= (kTemporalHysteresisFuture-i)/(float)kTemporalHysteresisFuture;
+  const int future_taps = stream->lookahead < kTemporalHysteresisFuture ?
+      stream->lookahead + 1 : kTemporalHysteresisFuture;
+  for (i=0, loc=center; i < future_taps; i++) {
+    float value = buffer[loc] * stream->future_taper[i];
     if (value > future_max) {
       future_max = value;
     }
+    if (++loc == kTemporalHysteresisBufferSize) {
+      loc = 0;
+    }
   }
-  for (i=0; i <= kTemporalHysteresisPast; i++) {
-    float value = HysteresisBuffer(at_time-i);
-    value *= (kTemporalHysteresisPast-i)/(float)kTemporalHysteresisPast;
+  for (i=0, loc=center; i < kTemporalHysteresisPast; i++) {
+    float value = buffer[loc] * stream->past_taper[i];
     if (value > past_max) {
       past_max = value;
     }
+    if (--loc < 0) {
+      loc = kTemporalHysteresisBufferSize-1;
+    }
   }
   return (past_max + future_max)/2.0;
 }
@@ -645,20 +1236,9 @@ float speedyNormalizeByEnergy(const float *spectrogram, float *normalized,
                                int length) {
   assert(spectrogram);
   assert(normalized);
-  int i;
-  float signal_energy = 0.0;           /* Overall frame energy */
-  float max_value = 0;                 /* Maximum of this frame. */
-  for (i=1; i < length; i++) {           /* Skip the DC term */
-    signal_energy += spectrogram[i] * spectrogram[i];
-    if (spectrogram[i] > max_value) {
-      max_value = spectrogram[i];
-    }
-  }
-  const float eps = 2.2204e-16;        /* Smallest increment around 1.0 */
-  float inverse_norm = 1.0/(sqrt(signal_energy)+eps);
-  for (i=0; i < length; i++) {
-    normalized[i] = spectrogram[i]*inverse_norm;
-  }
+  float signal_energy = speedyBandEnergy(spectrogram, length, NULL);
+  speedyScaleSpectrogram(spectrogram, speedyInverseNorm(signal_energy),
+                         normalized, length);
   return signal_energy;
 }
 
@@ -677,21 +1257,15 @@ float speedyNormalizeByEnergy(const float *spectrogram, float *normalized,
  *                           emphasis_weighted_local_difference.
  *  s_relative_spectral_difference: local_difference divided by lpf version.
  */
-void speedyComputeSpectralDifference(speedyStream stream,
-                                     const float *spectrogram,
-                                     const float *last_spectrogram,
-                                     int64_t at_time) {
-  assert(stream);
-  assert(spectrogram);
-  assert(last_spectrogram);
-  int i;
-  s_energy_hysteresis = speedyEvaluateHysteresis(stream, at_time);
-  s_spectrogram_energy = speedyNormalizeByEnergy(spectrogram,
-                                                 stream->normalized_spectrogram,
-                                                 stream->fft_size/2);
-  speedyNormalizeByEnergy(last_spectrogram,
-                          stream->normalized_last_spectrogram,
-                          stream->fft_size/2);
+/* The sequential parts of the spectral difference calculation.  The first
+ * decides whether this frame is skipped because of low energy (and, if so,
+ * updates the state for a skipped frame).  The second takes the frame's local
+ * spectral difference and runs the emphasis weighting and its low pass filter.
+ */
+static int speedySkipLowEnergyFrame(speedyStream stream,
+                                    float spectrogram_energy,
+                                    int64_t at_time) {
+  s_spectrogram_energy = spectrogram_energy;
   /* Bug: This probably should be based on energy_local, not hysteresis.  Bug
    * in the Matlab code too.
    */
@@ -714,26 +1288,15 @@ void speedyComputeSpectralDifference(speedyStream stream,
     /* Be sure to update the state of the emphasis_weighted filter. */
     s_emphasis_weighted_lpf =
         IterateFirstOrderFilter(&stream->difference_filter, 0.0);
-    return;
-  } else {
-    stream->skip_frame_count = 0;
-  }
-
-  float bin_threshold = 0;
-  for (i=1; i < stream->fft_size/2; i++) {
-    bin_threshold = fmax(bin_threshold, spectrogram[i]);
+    return 1;
   }
-  bin_threshold /= stream->bin_threshold_divisor;
+  stream->skip_frame_count = 0;
+  return 0;
+}
 
-  s_local_spectral_difference = 0.0;
-  const float eps = 2.2204e-16;        /* Smallest increment around 1.0 */
-  for (i=1; i < stream->fft_size/2; i++) {
-    if (spectrogram[i] > bin_threshold && last_spectrogram[i] > bin_threshold) {
-      s_local_spectral_difference +=
-          fabs(log((stream->normalized_spectrogram[i] + eps) /
-                   (stream->normalized_last_spectrogram[i] + eps)));
-    }
-  }
+static void speedyUpdateSpeechChanges(speedyStream stream,
+                                      float local_spectral_difference) {
+  s_local_spectral_difference = local_spectral_difference;
   s_emphasis_weighted_local_difference = s_local_spectral_difference *
                                          s_energy_hysteresis;
   s_emphasis_weighted_lpf =
@@ -746,6 +1309,51 @@ void speedyComputeSpectralDifference(speedyStream stream,
                           stream->mean_relative_spectral_difference);
 }
 
+void speedyComputeSpectralDifference(speedyStream stream,
+                                     const float *spectrogram,
+                                     const float *last_spectrogram,
+                                     int64_t at_time) {
+  assert(stream);
+  assert(spectrogram);
+  assert(last_spectrogram);
+  const int length = stream->fft_size/2;
+  SPEEDY_STATS_START(hysteresis_start);
+  s_energy_hysteresis = speedyEvaluateHysteresis(stream, at_time);
+  SPEEDY_STATS_END(&stream->stats, kSpeedyStageHysteresis, hysteresis_start);
+  SPEEDY_STATS_START(difference_start);
+  /* The energies come first, and the normalization is folded into the
+   * difference pass below.
+   */
+  float max_value;
+  float spectrogram_energy = speedyBandEnergy(spectrogram, length, &max_value);
+  float inverse_norm = speedyInverseNorm(spectrogram_energy);
+  float last_inverse_norm = speedyInverseNorm(
+      speedyBandEnergy(last_spectrogram, length, NULL));
+  if (speedySkipLowEnergyFrame(stream, spectrogram_energy, at_time)) {
+    /* The normalized slices are still reported for skipped frames. */
+    speedyScaleSpectrogram(spectrogram, inverse_norm,
+                           stream->normalized_spectrogram, length);
+    speedyScaleSpectrogram(last_spectrogram, last_inverse_norm,
+                           stream->normalized_last_spectrogram, length);
+#ifdef  SPEEDY_STATS
+    stream->stats.skipped_frames++;
+#endif
+    SPEEDY_STATS_END(&stream->stats, kSpeedyStageSpectralDifference,
+                     difference_start);
+    return;
+  }
+
+  float bin_threshold = max_value;
+  bin_threshold /= stream->bin_threshold_divisor;
+
+  speedyUpdateSpeechChanges(stream, speedyNormalizedLogDifference(
+      spectrogram, last_spectrogram, inverse_norm, last_inverse_norm,
+      bin_threshold, stream->normalized_spectrogram,
+      stream->normalized_last_spectrogram, length));
+  SPEEDY_STATS_END(&stream->stats, kSpeedyStageSpectralDifference,
+                   difference_start);
+}
+
 /*****************************************************************************
  * Actually compute the tension in the speech now.  Use the
  *  speedyComputeSpectralDifference
@@ -761,53 +1369,674 @@ int64_t speedyGetCurrentTime(speedyStream stream) {
   return stream->current_time;
 }
 
+int speedyGetSampleRate(speedyStream stream) {
+  assert(stream);
+  return stream->sample_rate;
+}
+
 
 /* We don't want the normal value of E here, as we want to reuse this variable
  * name. (So we can match the Mach1 paper's signal names.)
  */
 #undef  M_E
 
-int speedyComputeTension(speedyStream stream, int64_t at_time, float* tension) {
-  assert(tension);
+/* Combine the energy hysteresis and speech changes into the final tension. */
+static float speedyTensionFromFeatures(speedyStream stream) {
   float a = stream->tension_weight_energy;
   float b = stream->tension_weight_speech;
   float M_E = stream->tension_offset_energy;
   float M_S = stream->tension_offset_speech;
-  if (at_time + kTemporalHysteresisFuture <= stream->current_time) {
-    float *current_spectrogram = speedyGetSpectrogramAtTime(stream, at_time);
-    float *previous_spectrogram = speedyGetSpectrogramAtTime(stream, at_time-1);
-    s_energy_hysteresis = speedyEvaluateHysteresis(stream, at_time);
-    speedyComputeSpectralDifference(stream, current_spectrogram,
-                                    previous_spectrogram, at_time);
-    s_audio_tension = a*(s_energy_hysteresis-M_E) + b*(s_speech_changes-M_S);
-    *tension = s_audio_tension;
+  s_audio_tension = a*(s_energy_hysteresis-M_E) + b*(s_speech_changes-M_S);
+  return s_audio_tension;
+}
+
+/* The spectral difference of a frame the silence gate skipped, which has only
+ * its energy.  It is always a low energy frame, unless the threshold has been
+ * lowered since it was added; then it counts as no spectral change.
+ */
+static void speedyGatedSpectralDifference(speedyStream stream, float energy,
+                                          int64_t at_time) {
+  const int length = stream->fft_size/2;
+  SPEEDY_STATS_START(hysteresis_start);
+  s_energy_hysteresis = speedyEvaluateHysteresis(stream, at_time);
+  SPEEDY_STATS_END(&stream->stats, kSpeedyStageHysteresis, hysteresis_start);
+  SPEEDY_STATS_START(difference_start);
+  if (speedySkipLowEnergyFrame(stream, energy, at_time)) {
+#ifdef  SPEEDY_STATS
+    stream->stats.skipped_frames++;
+#endif
+  } else {
+    speedyUpdateSpeechChanges(stream, 0.0);
+  }
+  memset(stream->normalized_spectrogram, 0, sizeof(float)*length);
+  memset(stream->normalized_last_spectrogram, 0, sizeof(float)*length);
+  SPEEDY_STATS_END(&stream->stats, kSpeedyStageSpectralDifference,
+                   difference_start);
+}
+
+int speedyComputeTension(speedyStream stream, int64_t at_time, float* tension) {
+  assert(tension);
+  if (at_time + stream->lookahead <= stream->current_time) {
+    float gated_energy =
+        stream->gated_energy[modulo(at_time, kSpectrogramBufferSize)];
+    /* These also set s_energy_hysteresis, used below. */
+    if (gated_energy >= 0.0) {
+      speedyGatedSpectralDifference(stream, gated_energy, at_time);
+    } else {
+      float *current_spectrogram = speedyGetSpectrogramAtTime(stream, at_time);
+      float *previous_spectrogram =
+          speedyGetSpectrogramAtTime(stream, at_time-1);
+      speedyComputeSpectralDifference(stream, current_spectrogram,
+                                      previous_spectrogram, at_time);
+    }
+    *tension = speedyTensionFromFeatures(stream);
     return 1;
   }
   return 0;
 }
 
-float speedyComputeSpeedFromTension(float tension, float R_g,
+/* The speed for a tension, with the duration feedback kept in
+ * *current_duration and *desired_duration (seconds).
+ */
+static float speedySpeedFromTension(float tension, float R_g,
                                     float duration_feedback_strength,
-                                    speedyStream stream) {
+                                    float* current_duration,
+                                    float* desired_duration) {
   float requested_speed;
-
   if (R_g > 1.0) {
     requested_speed = fmax(1, R_g + (1-R_g)*tension);
   } else {
     requested_speed = fmax(kMinimumSpeed, fmin(1, R_g - (1-R_g)*tension));
   }
   if (duration_feedback_strength > 0){
-    float excess_duration = stream->current_duration - stream->desired_duration;
+    float excess_duration = *current_duration - *desired_duration;
     requested_speed +=
         fmax(kMinimumSpeed, duration_feedback_strength * excess_duration);
   }
   float frame_duration = 1.0/kFrameRateHz;
-  stream->current_duration += frame_duration/requested_speed;
-  stream->desired_duration += frame_duration/R_g;
+  *current_duration += frame_duration/requested_speed;
+  *desired_duration += frame_duration/R_g;
+  return requested_speed;
+}
 
+float speedyComputeSpeedFromTension(float tension, float R_g,
+                                    float duration_feedback_strength,
+                                    speedyStream stream) {
+  SPEEDY_STATS_START(start);
+  float requested_speed = speedySpeedFromTension(
+      tension, R_g, duration_feedback_strength, &stream->current_duration,
+      &stream->desired_duration);
+  SPEEDY_STATS_END(&stream->stats, kSpeedyStageTensionToSpeed, start);
   return requested_speed;
 }
 
+/*****************************************************************************
+ * Batch analysis of a whole signal.  The spectrogram of each frame, its energy
+ * and its spectral difference from the previous frame depend only on the
+ * input, so they are computed first, split into contiguous ranges of frames
+ * (one per thread when built with SPEEDY_PTHREADS).  Then the recursive
+ * filters, the hysteresis and the low-energy gating run over these per-frame
+ * values in order, just as speedyAddData and speedyComputeTension would.
+ *****************************************************************************/
+
+typedef struct {
+  speedyStream stream;          /* Private FFT state and buffers */
+  const float* input;
+  int frame_step;
+  int64_t first_frame;          /* Range of frames [first_frame, last_frame) */
+  int64_t last_frame;
+  float initial_preemph_state;  /* Filter state before frame 0 */
+  const float* initial_last_spectrogram;  /* Spectrogram before frame 0 */
+  float* last_spectrogram;      /* Scratch, spectrogram_size long */
+  float* energy;                /* Per-frame results, indexed by frame */
+  float* difference;
+} speedyBatchSlice;
+
+/* Preemphasis is a first order FIR filter, so its state going into a frame is
+ * just the last input sample of the previous frame.
+ */
+static void speedyBatchPreemphasize(speedyBatchSlice* slice, int64_t frame) {
+  speedyStream stream = slice->stream;
+  const float* frame_input = slice->input + frame*slice->frame_step;
+  stream->preemph_state = frame == 0 ? slice->initial_preemph_state :
+      frame_input[stream->window_size - slice->frame_step - 1];
+  speedyPreemphasize(stream, frame_input, stream->input, stream->window_size);
+}
+
+static float* speedyBatchFrameSpectrogram(speedyBatchSlice* slice,
+                                          int64_t frame) {
+  speedyBatchPreemphasize(slice, frame);
+  return speedySpectrogram(slice->stream, slice->stream->input);
+}
+
+static void* speedyBatchAnalyzeSlice(void* arg) {
+  speedyBatchSlice* slice = (speedyBatchSlice*)arg;
+  speedyStream stream = slice->stream;
+  const int length = stream->fft_size/2;
+  const size_t spectrogram_bytes = stream->spectrogram_size*sizeof(float);
+  int64_t frame;
+
+  if (slice->first_frame == 0) {
+    memcpy(slice->last_spectrogram, slice->initial_last_spectrogram,
+           spectrogram_bytes);
+  } else {
+    memcpy(slice->last_spectrogram,
+           speedyBatchFrameSpectrogram(slice, slice->first_frame-1),
+           spectrogram_bytes);
+  }
+  float last_energy = speedyBandEnergy(slice->last_spectrogram, length, NULL);
+  int last_gated = 0;
+  for (frame = slice->first_frame; frame < slice->last_frame; frame++) {
+    /* The silence gate, as in speedyAnalyzeFrame: a gated frame has only its
+     * energy, and its spectrogram is computed only if the next frame isn't
+     * gated.
+     */
+    float energy;
+    speedyBatchPreemphasize(slice, frame);
+    if (stream->silence_gate && speedyGateFrame(stream, stream->input,
+                                                &energy)) {
+      slice->energy[frame] = energy;
+      slice->difference[frame] = 0.0;
+      last_gated = 1;
+      continue;
+    }
+    if (last_gated) {
+      memcpy(slice->last_spectrogram,
+             speedyBatchFrameSpectrogram(slice, frame-1), spectrogram_bytes);
+      last_energy = speedyBandEnergy(slice->last_spectrogram, length, NULL);
+      speedyBatchPreemphasize(slice, frame);
+      last_gated = 0;
+    }
+    float* spectrogram = speedySpectrogram(stream, stream->input);
+    float max_value;
+    energy = speedyBandEnergy(spectrogram, length, &max_value);
+    float bin_threshold = max_value;
+    bin_threshold /= stream->bin_threshold_divisor;
+    slice->energy[frame] = energy;
+    slice->difference[frame] = speedyNormalizedLogDifference(
+        spectrogram, slice->last_spectrogram, speedyInverseNorm(energy),
+        speedyInverseNorm(last_energy), bin_threshold,
+        stream->normalized_spectrogram, stream->normalized_last_spectrogram,
+        length);
+    memcpy(slice->last_spectrogram, spectrogram, spectrogram_bytes);
+    last_energy = energy;
+  }
+  return NULL;
+}
+
+/* Call fn on each of count argument blocks of size bytes at args, each on its
+ * own thread (the first on this one) when built with SPEEDY_PTHREADS.
+ */
+static void speedyRunThreads(void* (*fn)(void*), void* args, size_t size,
+                             int count) {
+  char* arg = (char*)args;
+  int i;
+#ifdef  SPEEDY_PTHREADS
+  pthread_t* threads = (pthread_t*)calloc(count, sizeof(pthread_t));
+  int* started = (int*)calloc(count, sizeof(int));
+  if (threads && started) {
+    for (i=1; i < count; i++) {
+      started[i] = pthread_create(&threads[i], NULL, fn, arg + i*size) == 0;
+    }
+  }
+  fn(arg);
+  for (i=1; i < count; i++) {
+    if (started && started[i]) {
+      pthread_join(threads[i], NULL);
+    } else {
+      fn(arg + i*size);   /* Couldn't start a thread */
+    }
+  }
+  free(threads);
+  free(started);
+#else
+  for (i=0; i < count; i++) {
+    fn(arg + i*size);
+  }
+#endif  /* SPEEDY_PTHREADS */
+}
+
+int64_t speedyBatchFrameCount(speedyStream stream, int64_t sample_count) {
+  assert(stream);
+  if (sample_count < stream->window_size) {
+    return 0;
+  }
+  return (sample_count - stream->window_size)/speedyInputFrameStep(stream) + 1;
+}
+
+int speedyComputeTensionBatch(speedyStream stream, const float input[],
+                              int64_t sample_count, float tension[],
+                              float features[], int thread_count) {
+  assert(stream);
+  assert(tension);
+  const int64_t frame_count = speedyBatchFrameCount(stream, sample_count);
+  if (frame_count == 0) {
+    return 1;
+  }
+  assert(input);
+#ifndef SPEEDY_PTHREADS
+  thread_count = 1;
+#endif
+  if (thread_count < 1) {
+    thread_count = 1;
+  }
+  if (thread_count > frame_count) {
+    thread_count = (int)frame_count;
+  }
+
+  int ok = 1;
+  int i;
+  float* energy = (float*)malloc(sizeof(float) * frame_count);
+  float* difference = (float*)malloc(sizeof(float) * frame_count);
+  speedyBatchSlice* slices = (speedyBatchSlice*)calloc(
+      thread_count, sizeof(speedyBatchSlice));
+  if (!energy || !difference || !slices) {
+    ok = 0;
+  }
+  /* The slices get their own streams (created here, so their plans are ready
+   * before the threads start) carrying the settings used by the per-frame analysis.
+   */
+  for (i=0; ok && i < thread_count; i++) {
+    speedyBatchSlice* slice = &slices[i];
+    slice->stream = speedyCreateStreamWithFFT(stream->sample_rate,
+                                              stream->power_of_two_fft);
+    if (!slice->stream) {
+      ok = 0;
+      break;
+    }
+    slice->stream->preemphasis_factor = stream->preemphasis_factor;
+    slice->stream->bin_threshold_divisor = stream->bin_threshold_divisor;
+    slice->stream->low_energy_threshold_scale =
+        stream->low_energy_threshold_scale;
+    slice->stream->silence_gate = stream->silence_gate;
+    slice->last_spectrogram = (float*)malloc(sizeof(float) *
+                                             stream->spectrogram_size);
+    if (!slice->last_spectrogram) {
+      ok = 0;
+      break;
+    }
+    slice->input = input;
+    slice->frame_step = speedyInputFrameStep(stream);
+    slice->first_frame = frame_count*i/thread_count;
+    slice->last_frame = frame_count*(i+1)/thread_count;
+    slice->initial_preemph_state = stream->preemph_state;
+    slice->initial_last_spectrogram = speedyGetSpectrogramAtTime(stream, -1);
+    slice->energy = energy;
+    slice->difference = difference;
+  }
+
+  if (ok) {
+    speedyRunThreads(speedyBatchAnalyzeSlice, slices, sizeof(speedyBatchSlice),
+                     thread_count);
+
+    /* The sequential pass.  Frame t-lookahead is finished once frame t's
+     * energy is in the hysteresis buffer.  There are no frames past the end of
+     * the input, so the last ones see zero energy in the future.
+     */
+    int64_t t;
+    for (t = 0; t < frame_count + stream->lookahead; t++) {
+      if (t < frame_count) {
+        speedyUpdateLocalEnergy(stream, energy[t], t);
+        stream->current_time = t;
+      } else {
+        speedyAddToHysteresisBuffer(stream, 0.0, t);
+      }
+      int64_t at_time = t - stream->lookahead;
+      if (at_time < 0) {
+        continue;
+      }
+      s_energy_hysteresis = speedyEvaluateHysteresis(stream, at_time);
+      if (!speedySkipLowEnergyFrame(stream, energy[at_time], at_time)) {
+        speedyUpdateSpeechChanges(stream, difference[at_time]);
+      }
+      tension[at_time] = speedyTensionFromFeatures(stream);
+      if (features) {
+        memcpy(&features[at_time*kFeatureValueCount], stream->features,
+               sizeof(float) * kFeatureValueCount);
+      }
+    }
+    const int64_t last_start = (frame_count-1) * speedyInputFrameStep(stream);
+    stream->preemph_state = input[last_start + stream->window_size - 1];
+  }
+
+  if (slices) {
+    for (i=0; i < thread_count; i++) {
+      if (slices[i].stream) {
+        speedyDestroyStream(slices[i].stream);
+      }
+      free(slices[i].last_spectrogram);
+    }
+    free(slices);
+  }
+  free(energy);
+  free(difference);
+  return ok;
+}
+
+/*****************************************************************************
+ * Parameter sweeps.  Of the tuning parameters only the preemphasis factor
+ * changes the spectrogram, and none of them change the frame energies or the
+ * energy hysteresis.  So a sweep computes those once, with the spectrogram of
+ * every frame (bins 0..fft_size/2-1), and each parameter set only reruns the
+ * sequential stages of the batch pass above.  The spectral difference depends
+ * on the bin threshold divisor too, so it is computed once per distinct
+ * divisor, split over frames, and then the parameter sets sharing that
+ * divisor are split over threads.
+ *****************************************************************************/
+
+struct speedySweepStruct {
+  int sample_rate;
+  int power_of_two_fft;
+  int64_t frame_count;
+  int length;                   /* Bins kept of each frame, fft_size/2 */
+  float* spectra;               /* frame_count rows of length */
+  float* energy;                /* Per frame, as speedyBandEnergy */
+  float* bin_max;               /* Largest bin of each frame */
+  float* hysteresis;            /* Energy hysteresis of each frame */
+  float* difference;            /* For one divisor, see speedyRunSweep */
+};
+
+typedef struct {
+  speedyBatchSlice batch;       /* Private stream, input and frame range */
+  speedySweep sweep;
+} speedySweepAnalysisSlice;
+
+static void* speedySweepAnalyzeSlice(void* arg) {
+  speedySweepAnalysisSlice* slice = (speedySweepAnalysisSlice*)arg;
+  speedySweep sweep = slice->sweep;
+  const int length = sweep->length;
+  int64_t frame;
+  for (frame = slice->batch.first_frame; frame < slice->batch.last_frame;
+       frame++) {
+    float* spectrogram = speedyBatchFrameSpectrogram(&slice->batch, frame);
+    sweep->energy[frame] = speedyBandEnergy(spectrogram, length,
+                                            &sweep->bin_max[frame]);
+    memcpy(&sweep->spectra[frame*length], spectrogram, sizeof(float)*length);
+  }
+  return NULL;
+}
+
+void speedyDestroySweep(speedySweep sweep) {
+  if (sweep) {
+    free(sweep->spectra);
+    free(sweep->energy);
+    free(sweep->bin_max);
+    free(sweep->hysteresis);
+    free(sweep->difference);
+    free(sweep);
+  }
+}
+
+speedySweep speedyCreateSweep(speedyStream stream, const float input[],
+                              int64_t sample_count, int thread_count) {
+  assert(stream);
+  const int64_t frame_count = speedyBatchFrameCount(stream, sample_count);
+  if (frame_count == 0) {
+    return NULL;
+  }
+  assert(input);
+#ifndef SPEEDY_PTHREADS
+  thread_count = 1;
+#endif
+  if (thread_count < 1) {
+    thread_count = 1;
+  }
+  if (thread_count > frame_count) {
+    thread_count = (int)frame_count;
+  }
+  speedySweep sweep = (speedySweep)calloc(1, sizeof(struct speedySweepStruct));
+  if (!sweep) {
+    return NULL;
+  }
+  sweep->sample_rate = stream->sample_rate;
+  sweep->power_of_two_fft = stream->power_of_two_fft;
+  sweep->frame_count = frame_count;
+  sweep->length = stream->fft_size/2;
+  sweep->spectra = (float*)malloc(sizeof(float) * frame_count * sweep->length);
+  sweep->energy = (float*)malloc(sizeof(float) * frame_count);
+  sweep->bin_max = (float*)malloc(sizeof(float) * frame_count);
+  sweep->hysteresis = (float*)malloc(sizeof(float) * frame_count);
+  sweep->difference = (float*)malloc(sizeof(float) * frame_count);
+  speedySweepAnalysisSlice* slices = (speedySweepAnalysisSlice*)calloc(
+      thread_count, sizeof(speedySweepAnalysisSlice));
+  /* For the energy filter and hysteresis, as in a new stream. */
+  speedyStream energy_stream = speedyCreateStreamWithFFT(
+      stream->sample_rate, stream->power_of_two_fft);
+  int ok = sweep->spectra && sweep->energy && sweep->bin_max &&
+      sweep->hysteresis && sweep->difference && slices && energy_stream;
+  int i;
+  for (i=0; ok && i < thread_count; i++) {
+    speedyBatchSlice* slice = &slices[i].batch;
+    slices[i].sweep = sweep;
+    slice->stream = speedyCreateStreamWithFFT(stream->sample_rate,
+                                              stream->power_of_two_fft);
+    if (!slice->stream) {
+      ok = 0;
+      break;
+    }
+    slice->stream->preemphasis_factor = stream->preemphasis_factor;
+    slice->input = input;
+    slice->frame_step = speedyInputFrameStep(stream);
+    slice->first_frame = frame_count*i/thread_count;
+    slice->last_frame = frame_count*(i+1)/thread_count;
+    slice->initial_preemph_state = 0.0;
+  }
+
+  if (ok) {
+    speedyRunThreads(speedySweepAnalyzeSlice, slices,
+                     sizeof(speedySweepAnalysisSlice), thread_count);
+    /* The energy filter and hysteresis, as in speedyComputeTensionBatch. */
+    const int lookahead = stream->lookahead;
+    energy_stream->lookahead = lookahead;
+    int64_t t;
+    for (t = 0; t < frame_count + lookahead; t++) {
+      if (t < frame_count) {
+        speedyUpdateLocalEnergy(energy_stream, sweep->energy[t], t);
+      } else {
+        speedyAddToHysteresisBuffer(energy_stream, 0.0, t);
+      }
+      if (t >= lookahead) {
+        sweep->hysteresis[t - lookahead] =
+            speedyEvaluateHysteresis(energy_stream, t - lookahead);
+      }
+    }
+  }
+
+  if (slices) {
+    for (i=0; i < thread_count; i++) {
+      if (slices[i].batch.stream) {
+        speedyDestroyStream(slices[i].batch.stream);
+      }
+    }
+    free(slices);
+  }
+  if (energy_stream) {
+    speedyDestroyStream(energy_stream);
+  }
+  if (!ok) {
+    speedyDestroySweep(sweep);
+    return NULL;
+  }
+  return sweep;
+}
+
+int64_t speedySweepFrameCount(speedySweep sweep) {
+  assert(sweep);
+  return sweep->frame_count;
+}
+
+typedef struct {
+  speedySweep sweep;
+  float divisor;
+  int64_t first_frame;          /* Range of frames [first_frame, last_frame) */
+  int64_t last_frame;
+  float* normalized;            /* Scratch, 2*length */
+} speedySweepDifferenceSlice;
+
+/* The spectral difference of each frame, as in speedyBatchAnalyzeSlice.
+ * Frame 0 follows the zeros of a new stream, so no bin is above threshold.
+ */
+static void* speedySweepDifferenceSliceRun(void* arg) {
+  speedySweepDifferenceSlice* slice = (speedySweepDifferenceSlice*)arg;
+  speedySweep sweep = slice->sweep;
+  const int length = sweep->length;
+  int64_t frame;
+  for (frame = slice->first_frame; frame < slice->last_frame; frame++) {
+    if (frame == 0) {
+      sweep->difference[0] = 0.0;
+      continue;
+    }
+    const float* spectrogram = &sweep->spectra[frame*length];
+    float bin_threshold = sweep->bin_max[frame];
+    bin_threshold /= slice->divisor;
+    sweep->difference[frame] = speedyNormalizedLogDifference(
+        spectrogram, spectrogram - length,
+        speedyInverseNorm(sweep->energy[frame]),
+        speedyInverseNorm(sweep->energy[frame-1]), bin_threshold,
+        slice->normalized, slice->normalized + length, length);
+  }
+  return NULL;
+}
+
+typedef struct {
+  speedySweep sweep;
+  speedyStream stream;          /* Private, for the filter states */
+  const float* parameters;
+  const int* sets;              /* Parameter sets [first_set, last_set) */
+  int first_set;
+  int last_set;
+  float R_g;
+  float duration_feedback_strength;
+  float* tension;
+  float* durations;
+} speedySweepEvaluateSlice;
+
+/* The sequential pass of speedyComputeTensionBatch for each parameter set,
+ * then the output duration at R_g.
+ */
+static void* speedySweepEvaluateSliceRun(void* arg) {
+  speedySweepEvaluateSlice* slice = (speedySweepEvaluateSlice*)arg;
+  speedySweep sweep = slice->sweep;
+  speedyStream stream = slice->stream;
+  int k;
+  for (k = slice->first_set; k < slice->last_set; k++) {
+    const int set = slice->sets[k];
+    speedySetTuningParameters(
+        stream, &slice->parameters[set*kSpeedyTuningParameterCount]);
+    speedyResetStream(stream, NULL);
+    float* track = slice->tension ?
+        &slice->tension[set*sweep->frame_count] : NULL;
+    float current_duration = 0.0, desired_duration = 0.0;
+    int64_t t;
+    for (t = 0; t < sweep->frame_count; t++) {
+      s_energy_hysteresis = sweep->hysteresis[t];
+      if (!speedySkipLowEnergyFrame(stream, sweep->energy[t], t)) {
+        speedyUpdateSpeechChanges(stream, sweep->difference[t]);
+      }
+      float tension = speedyTensionFromFeatures(stream);
+      if (track) {
+        track[t] = tension;
+      }
+      speedySpeedFromTension(tension, slice->R_g,
+                             slice->duration_feedback_strength,
+                             &current_duration, &desired_duration);
+    }
+    if (slice->durations) {
+      slice->durations[set] = current_duration;
+    }
+  }
+  return NULL;
+}
+
+int speedyRunSweep(speedySweep sweep, const float parameters[],
+                   int parameter_set_count, float R_g,
+                   float duration_feedback_strength, float tension[],
+                   float durations[], int thread_count) {
+  assert(sweep);
+  assert(parameters || parameter_set_count == 0);
+#ifndef SPEEDY_PTHREADS
+  thread_count = 1;
+#endif
+  if (thread_count < 1) {
+    thread_count = 1;
+  }
+  const int length = sweep->length;
+  int* sets = (int*)malloc(sizeof(int) * (parameter_set_count + 1));
+  int* done = (int*)calloc(parameter_set_count + 1, sizeof(int));
+  speedySweepDifferenceSlice* differences = (speedySweepDifferenceSlice*)
+      calloc(thread_count, sizeof(speedySweepDifferenceSlice));
+  speedySweepEvaluateSlice* evaluations = (speedySweepEvaluateSlice*)
+      calloc(thread_count, sizeof(speedySweepEvaluateSlice));
+  int ok = sets && done && differences && evaluations;
+  int i;
+  for (i=0; ok && i < thread_count; i++) {
+    differences[i].sweep = sweep;
+    differences[i].normalized = (float*)malloc(sizeof(float) * 2 * length);
+    evaluations[i].sweep = sweep;
+    evaluations[i].stream = speedyCreateStreamWithFFT(sweep->sample_rate,
+                                                      sweep->power_of_two_fft);
+    evaluations[i].parameters = parameters;
+    evaluations[i].sets = sets;
+    evaluations[i].R_g = R_g;
+    evaluations[i].duration_feedback_strength = duration_feedback_strength;
+    evaluations[i].tension = tension;
+    evaluations[i].durations = durations;
+    ok = differences[i].normalized && evaluations[i].stream;
+  }
+
+  /* One group of parameter sets per distinct bin threshold divisor. */
+  int first;
+  for (first = 0; ok && first < parameter_set_count; first++) {
+    if (done[first]) {
+      continue;
+    }
+    const float divisor = parameters[first*kSpeedyTuningParameterCount + 2];
+    int set_count = 0;
+    int set;
+    for (set = first; set < parameter_set_count; set++) {
+      if (!done[set] &&
+          parameters[set*kSpeedyTuningParameterCount + 2] == divisor) {
+        sets[set_count++] = set;
+        done[set] = 1;
+      }
+    }
+    int threads = thread_count < sweep->frame_count ?
+        thread_count : (int)sweep->frame_count;
+    for (i=0; i < threads; i++) {
+      differences[i].divisor = divisor;
+      differences[i].first_frame = sweep->frame_count*i/threads;
+      differences[i].last_frame = sweep->frame_count*(i+1)/threads;
+    }
+    speedyRunThreads(speedySweepDifferenceSliceRun, differences,
+                     sizeof(speedySweepDifferenceSlice), threads);
+    threads = thread_count < set_count ? thread_count : set_count;
+    for (i=0; i < threads; i++) {
+      evaluations[i].first_set = set_count*i/threads;
+      evaluations[i].last_set = set_count*(i+1)/threads;
+    }
+    speedyRunThreads(speedySweepEvaluateSliceRun, evaluations,
+                     sizeof(speedySweepEvaluateSlice), threads);
+  }
+
+  if (differences) {
+    for (i=0; i < thread_count; i++) {
+      free(differences[i].normalized);
+    }
+    free(differences);
+  }
+  if (evaluations) {
+    for (i=0; i < thread_count; i++) {
+      if (evaluations[i].stream) {
+        speedyDestroyStream(evaluations[i].stream);
+      }
+    }
+    free(evaluations);
+  }
+  free(sets);
+  free(done);
+  return ok;
+}
+
 void speedySetPreemphasisFactor(speedyStream stream, float factor) {
   assert(stream);
   stream->preemphasis_factor = factor;
@@ -841,3 +2070,87 @@ void speedySetSpeechChangeCapMultiplier(speedyStream stream, float multiplier) {
   assert(stream);
   stream->speech_change_cap_multiplier = multiplier;
 }
+
+void speedySetLookahead(speedyStream stream, int frames) {
+  assert(stream);
+  if (frames < 0) {
+    frames = 0;
+  } else if (frames > kTemporalHysteresisFuture) {
+    frames = kTemporalHysteresisFuture;
+  }
+  stream->lookahead = frames;
+}
+
+int speedyGetLookahead(speedyStream stream) {
+  assert(stream);
+  return stream->lookahead;
+}
+
+void speedySetSilenceGate(speedyStream stream, int enabled) {
+  assert(stream);
+  stream->silence_gate = enabled != 0;
+}
+
+int speedyGetSilenceGate(speedyStream stream) {
+  assert(stream);
+  return stream->silence_gate;
+}
+
+void speedyGetTuningParameters(speedyStream stream,
+                               float parameters[kSpeedyTuningParameterCount]) {
+  assert(stream);
+  parameters[0] = stream->preemphasis_factor;
+  parameters[1] = stream->low_energy_threshold_scale;
+  parameters[2] = stream->bin_threshold_divisor;
+  parameters[3] = stream->tension_weight_energy;
+  parameters[4] = stream->tension_weight_speech;
+  parameters[5] = stream->tension_offset_energy;
+  parameters[6] = stream->tension_offset_speech;
+  parameters[7] = stream->speech_change_cap_multiplier;
+}
+
+void speedySetTuningParameters(speedyStream stream,
+                               const float parameters[kSpeedyTuningParameterCount]) {
+  assert(stream);
+  speedySetPreemphasisFactor(stream, parameters[0]);
+  speedySetLowEnergyThresholdScale(stream, parameters[1]);
+  speedySetBinThresholdDivisor(stream, parameters[2]);
+  speedySetTensionWeights(stream, parameters[3], parameters[4]);
+  speedySetTensionOffsets(stream, parameters[5], parameters[6]);
+  speedySetSpeechChangeCapMultiplier(stream, parameters[7]);
+}
+
+int64_t speedyStatsClock(void) {
+#ifdef  SPEEDY_STATS
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec*1000000000 + now.tv_nsec;
+#else
+  return 0;
+#endif
+}
+
+void speedyStatsAddTime(speedyStats* stats, int stage, int64_t start) {
+  assert(stage >= 0 && stage < kSpeedyStageCount);
+  stats->stage_nanoseconds[stage] += speedyStatsClock() - start;
+  stats->stage_calls[stage]++;
+}
+
+int speedyGetStats(speedyStream stream, speedyStats* stats) {
+  assert(stream);
+  assert(stats);
+#ifdef  SPEEDY_STATS
+  *stats = stream->stats;
+  return 1;
+#else
+  memset(stats, 0, sizeof(*stats));
+  return 0;
+#endif
+}
+
+void speedyResetStats(speedyStream stream) {
+  assert(stream);
+#ifdef  SPEEDY_STATS
+  memset(&stream->stats, 0, sizeof(stream->stats));
+#endif
+}
@@ -59,7 +59,41 @@ typedef struct speedyStreamStruct* speedyStream;
  * allocate the stream.
  */
 speedyStream speedyCreateStream(int sample_rate);
+/* Like speedyCreateStream, but use the power of two FFT size at or above twice
+ * the window (512 at kSpeedyAnalysisRate) and rescale the long-term energy and
+ * spectral difference means to it, so its tensions stay comparable.
+ */
+#define kSpeedyAnalysisRate 16000
+speedyStream speedyCreatePowerOfTwoStream(int sample_rate);
 void speedyDestroyStream(speedyStream stream);
+/* Streams with the same window and FFT sizes share one analysis window, and
+ * reuse the FFT plans of destroyed streams, so after the first one creating a
+ * stream only allocates its buffers.  These tables are kept after the last
+ * such stream is destroyed; free the unused ones with this.
+ */
+void speedyFreeCachedTables(void);
+
+/* The slowly changing state of a stream: its energy and spectral difference
+ * filters and the duration feedback loop.  Save one (for example every few
+ * seconds of playback) so a seek can restart from it instead of from the
+ * long-term defaults.
+ */
+typedef struct {
+  float energy_lp;               /* Energy low pass filter state */
+  float emphasis_weighted_lpf;   /* Spectral difference filter state */
+  float current_duration;        /* Seconds of output so far */
+  float desired_duration;        /* Seconds of output wanted so far */
+} speedyCheckpoint;
+
+/* Reset a stream for a seek, reusing all its storage.  The next frame sent to
+ * speedyAddData is treated like the first one of a new stream, though its
+ * at_time need not be 0.  The tuning parameters are kept.  If checkpoint isn't NULL the
+ * filters and duration feedback are restored from it, otherwise they start
+ * from their defaults, as in a new stream.
+ */
+void speedyResetStream(speedyStream stream,
+                       const speedyCheckpoint* checkpoint);
+void speedyGetCheckpoint(speedyStream stream, speedyCheckpoint* checkpoint);
 
 /* Data sent to Speedy must have this number of samples, and the output tension
  * is returned with the given frame step.
@@ -81,10 +115,58 @@ void speedyAddDataShort(speedyStream stream, const int16_t input[],
  * provided to speedyAddData is frame time 0, then the next is 1.
  */
 int speedyComputeTension(speedyStream stream, int64_t at_time, float* tension);
+
+/* Offline analysis of a whole mono signal (of sample_count samples) at once.
+ * Frame t starts at sample t*speedyInputFrameStep(), and there are
+ * speedyBatchFrameCount() frames.  Fill in the tension for every frame and,
+ * if features isn't NULL, the kFeatureValueCount features for every frame
+ * (frame-major).  The results match the speedyAddData/speedyComputeTension
+ * loop over the same frames of a new stream, except that the last
+ * speedyGetLookahead() frames (which that loop never finishes) see zero
+ * energy past the end of the input.  Built with SPEEDY_PTHREADS, the
+ * per-frame spectral analysis is split over thread_count threads.  Use the
+ * stream only for this call (plus the setters and
+ * speedyComputeSpeedFromTension), not for streaming data too.  Return 0 only
+ * if we are out of memory.
+ */
+int64_t speedyBatchFrameCount(speedyStream stream, int64_t sample_count);
+int speedyComputeTensionBatch(speedyStream stream, const float input[],
+                              int64_t sample_count, float tension[],
+                              float features[], int thread_count);
 float speedyComputeSpeedFromTension(float tension, float R_g,
                                     float duration_feedback_strength,
                                     speedyStream stream);
+
+/* Parameter sweeps, for tuning.  A sweep holds what the tuning parameters
+ * (other than the preemphasis factor) don't change, computed once from a
+ * whole mono signal as by speedyComputeTensionBatch on a new stream with the
+ * preemphasis factor and lookahead of this one: the spectrogram of every frame
+ * and the frame energies and energy hysteresis.  It keeps fft_size/2 floats
+ * per frame, about 130 KB per second of input at 22050 Hz.  The silence gate
+ * isn't used.  Return NULL if there are no frames or we are out of memory.
+ */
+struct speedySweepStruct;
+typedef struct speedySweepStruct* speedySweep;
+speedySweep speedyCreateSweep(speedyStream stream, const float input[],
+                              int64_t sample_count, int thread_count);
+void speedyDestroySweep(speedySweep sweep);
+int64_t speedySweepFrameCount(speedySweep sweep);
+/* Evaluate parameter_set_count sets of kSpeedyTuningParameterCount tuning
+ * parameters (in speedyGetTuningParameters order; the preemphasis factor is
+ * ignored).  Fill in, if not NULL, the tension track of each set (set-major,
+ * speedySweepFrameCount() frames each, the same as speedyComputeTensionBatch
+ * with those parameters) and its output duration in seconds at speed R_g,
+ * from speedyComputeSpeedFromTension over the track.  The spectral difference
+ * is computed once per distinct bin threshold divisor; built with
+ * SPEEDY_PTHREADS, it and the parameter sets are split over thread_count
+ * threads.  Return 0 only if we are out of memory.
+ */
+int speedyRunSweep(speedySweep sweep, const float parameters[],
+                   int parameter_set_count, float R_g,
+                   float duration_feedback_strength, float tension[],
+                   float durations[], int thread_count);
 int64_t speedyGetCurrentTime(speedyStream stream);
+int speedyGetSampleRate(speedyStream stream);
 void speedySetPreemphasisFactor(speedyStream stream, float factor);
 void speedySetLowEnergyThresholdScale(speedyStream stream, float scale);
 void speedySetBinThresholdDivisor(speedyStream stream, float divisor);
@@ -93,12 +175,73 @@ void speedySetTensionWeights(speedyStream stream, float energy_weight,
 void speedySetTensionOffsets(speedyStream stream, float energy_offset,
                              float speech_offset);
 void speedySetSpeechChangeCapMultiplier(speedyStream stream, float multiplier);
+/* The tension of frame t is computed once frame t+lookahead has been added:
+ * kTemporalHysteresisFuture frames by default, as in the paper.  A shorter
+ * lookahead lowers the latency.  The future half of the hysteresis then only
+ * looks at the frames that have arrived (with the same taper), so it reacts
+ * later to a coming rise in energy.  A lookahead of 0 makes the analysis
+ * causal; the spectral difference and the filters are causal already.  The
+ * lookahead is clamped to [0, kTemporalHysteresisFuture] and kept by
+ * speedyResetStream; set it before adding data.
+ */
+void speedySetLookahead(speedyStream stream, int frames);
+int speedyGetLookahead(speedyStream stream);
+/* The silence gate finds frames clearly below the low energy threshold from
+ * their time-domain energy and skips their FFT; they are skipped as low
+ * energy frames anyway.  Their energy is computed in another order, so
+ * tensions change only by float rounding.  The spectrogram of a gated frame
+ * (speedyGetSpectrogram and the history) and its normalized spectrograms are
+ * zeros, which is why it is off by default.  Set it before adding data.
+ */
+void speedySetSilenceGate(speedyStream stream, int enabled);
+int speedyGetSilenceGate(speedyStream stream);
+/* Return the values set above, in this order: preemphasis factor, low energy
+ * threshold scale, bin threshold divisor, energy and speech tension weights,
+ * energy and speech tension offsets and the speech change cap multiplier.
+ */
+#define kSpeedyTuningParameterCount 8
+void speedyGetTuningParameters(speedyStream stream,
+                               float parameters[kSpeedyTuningParameterCount]);
+/* Set all of them at once, e.g. to copy them to another stream. */
+void speedySetTuningParameters(speedyStream stream,
+                               const float parameters[kSpeedyTuningParameterCount]);
+
+/* Per-stage cost counters for the streaming path (speedyAddData,
+ * speedyComputeTension and speedyComputeSpeedFromTension; the batch analysis
+ * is not counted).  They are kept only when the library is built with
+ * SPEEDY_STATS defined; otherwise speedyGetStats fills in zeros and returns 0.
+ * Times are monotonic-clock nanoseconds, summed over all calls.  The SOLA
+ * stage and the last two fields are kept by sonic2 (see sonicGetSpeedyStats).
+ */
+#define kSpeedyStagePreemphasis         0
+#define kSpeedyStageSpectrogram         1
+#define kSpeedyStageLocalEnergy         2
+#define kSpeedyStageHysteresis          3
+#define kSpeedyStageSpectralDifference  4
+#define kSpeedyStageTensionToSpeed      5
+#define kSpeedyStageSola                6
+#define kSpeedyStageCount               7
+typedef struct {
+  int64_t stage_nanoseconds[kSpeedyStageCount];
+  int64_t stage_calls[kSpeedyStageCount];
+  int64_t skipped_frames;          /* Low energy frames, no spectral change */
+  int64_t gated_frames;            /* Of those, the ones with no FFT */
+  int64_t missing_tension_frames;  /* Played with tension 0, not analyzed */
+  int buffered_frames_high_water;  /* Most frames waiting in the sonic2 ring */
+} speedyStats;
+int speedyGetStats(speedyStream stream, speedyStats* stats);
+void speedyResetStats(speedyStream stream);
 
 /* The following functions are NOT designed to be user callable.  They are
  * defined here to make the internals of this function available for testing.
  */
 float* speedySpectrogram(speedyStream stream, float input[]);
 int speedyFFTSize(speedyStream stream);
+/* Number of bins in each spectrogram slice returned below.  This is
+ * fft_size/2+1 when built with SPEEDY_REAL_FFT (only the non-negative
+ * frequencies are computed), and fft_size otherwise.
+ */
+int speedySpectrogramSize(speedyStream stream);
 float speedyBinToFreq(speedyStream stream, int bin_number);
 int speedyFreqToBin(speedyStream stream, float freq);
 
@@ -129,6 +272,21 @@ float speedyGetSpeechChanges(speedyStream stream);
 float speedyNormalizeByEnergy(const float* spectrogram, float* normalized,
                                int length);
 
+/* Instrumentation shared with soniclib.c.  SPEEDY_STATS_START declares the
+ * start time of a stage and SPEEDY_STATS_END adds the time since then to the
+ * given stage; both compile to nothing without SPEEDY_STATS.
+ */
+int64_t speedyStatsClock(void);
+void speedyStatsAddTime(speedyStats* stats, int stage, int64_t start);
+#ifdef  SPEEDY_STATS
+#define SPEEDY_STATS_START(start) int64_t start = speedyStatsClock()
+#define SPEEDY_STATS_END(stats, stage, start) \
+  speedyStatsAddTime((stats), (stage), (start))
+#else
+#define SPEEDY_STATS_START(start)
+#define SPEEDY_STATS_END(stats, stage, start)
+#endif  /* SPEEDY_STATS */
+
 /* A simple structure to implement a digital first order filter. */
 struct FirstOrderFilterStruct;
 typedef struct FirstOrderFilterStruct* FirstOrderFilter;
@@ -0,0 +1,259 @@
+//  Copyright 2024 Speedy WASM Contributors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Benchmarks for the speedy analysis and the sonic2 write path.
+ *
+ * Each benchmark reports per_frame (the time per 10 ms Speedy frame) and
+ * x_realtime (seconds of audio processed per second), for the sample rates
+ * and channel counts we ship.  Run it with
+ *   make bench
+ * or, to pick benchmarks or a data directory,
+ *   ./speedy_bench --benchmark_filter=SonicWrite [test_data/]
+ * The inputs are test_data/tapestry.wav (16 kHz mono) for mono and
+ * test_data/capture_1_00x.wav (48 kHz stereo) for stereo, resampled to each
+ * rate.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+extern "C" {
+#include "wave.h"
+#include "sonic2.h"
+#include "speedy.h"
+}
+
+namespace {
+
+std::string data_dir = "test_data/";
+
+constexpr int kSampleRates[] = {16000, 22050, 44100, 48000};
+constexpr int kChunkSize = 128;     // Like an AudioWorklet quantum
+
+// Read a whole wave file as floats, interleaved.
+std::vector<float> ReadWaveFile(const std::string& file_name, int* sample_rate,
+                                int* channel_count) {
+  std::vector<float> samples;
+  waveFile fp = openInputWaveFile(file_name.c_str(), sample_rate,
+                                  channel_count);
+  if (!fp) {
+    return samples;
+  }
+  std::vector<short> buffer(1024 * *channel_count);
+  int sample_count;
+  while ((sample_count = readFromWaveFile(fp, &buffer[0], 1024)) > 0) {
+    for (int i = 0; i < sample_count * *channel_count; i++) {
+      samples.push_back(buffer[i] / 32768.0f);
+    }
+  }
+  closeWaveFile(fp);
+  return samples;
+}
+
+// Linearly resample interleaved audio and mix or copy it to channel_count
+// channels.  Good enough for timing.
+std::vector<float> Convert(const std::vector<float>& input, int input_rate,
+                           int input_channels, int sample_rate,
+                           int channel_count) {
+  const int64_t input_length = input.size() / input_channels;
+  const int64_t length = input_length * sample_rate / input_rate;
+  std::vector<float> output(length * channel_count);
+  for (int64_t i = 0; i < length; i++) {
+    double position = static_cast<double>(i) * input_rate / sample_rate;
+    int64_t j = std::min<int64_t>(position, input_length - 2);
+    float fraction = position - j;
+    for (int c = 0; c < channel_count; c++) {
+      int k = c % input_channels;
+      output[i * channel_count + c] =
+          (1 - fraction) * input[j * input_channels + k] +
+          fraction * input[(j + 1) * input_channels + k];
+    }
+  }
+  return output;
+}
+
+// The benchmark input at a given format, cached across benchmarks.
+const std::vector<float>& TestSound(int sample_rate, int channel_count) {
+  static std::map<std::pair<int, int>, std::vector<float>> cache;
+  auto key = std::make_pair(sample_rate, channel_count);
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    int file_rate, file_channels;
+    std::string name = channel_count == 1 ? "tapestry.wav" : "capture_1_00x.wav";
+    std::vector<float> samples = ReadWaveFile(data_dir + name, &file_rate,
+                                              &file_channels);
+    if (!samples.empty()) {
+      samples = Convert(samples, file_rate, file_channels, sample_rate,
+                        channel_count);
+    }
+    it = cache.emplace(key, std::move(samples)).first;
+  }
+  return it->second;
+}
+
+void SetFrameCounters(benchmark::State& state, int64_t frames,
+                      double audio_seconds) {
+  state.counters["per_frame"] = benchmark::Counter(
+      frames, benchmark::Counter::kIsIterationInvariantRate |
+      benchmark::Counter::kInvert);
+  state.counters["x_realtime"] = benchmark::Counter(
+      audio_seconds, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Time speedyAddData alone, over every frame of the sound.
+void BM_SpeedyAddData(benchmark::State& state) {
+  const int sample_rate = state.range(0);
+  const std::vector<float>& input = TestSound(sample_rate, 1);
+  if (input.empty()) {
+    state.SkipWithError("Can't read the test sound");
+    return;
+  }
+  speedyStream stream = speedyCreateStream(sample_rate);
+  const int frame_step = speedyInputFrameStep(stream);
+  const int64_t frame_count = speedyBatchFrameCount(stream, input.size());
+  for (auto _ : state) {
+    speedyResetStream(stream, nullptr);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int64_t t = 0; t < frame_count; t++) {
+      speedyAddData(stream, &input[t * frame_step], t);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    state.SetIterationTime(std::chrono::duration<double>(end - start).count());
+  }
+  SetFrameCounters(state, frame_count, input.size() / double(sample_rate));
+  speedyDestroyStream(stream);
+}
+
+// Time speedyComputeTension alone; the speedyAddData calls are not counted.
+void BM_SpeedyComputeTension(benchmark::State& state) {
+  const int sample_rate = state.range(0);
+  const std::vector<float>& input = TestSound(sample_rate, 1);
+  if (input.empty()) {
+    state.SkipWithError("Can't read the test sound");
+    return;
+  }
+  speedyStream stream = speedyCreateStream(sample_rate);
+  const int frame_step = speedyInputFrameStep(stream);
+  const int64_t frame_count = speedyBatchFrameCount(stream, input.size());
+  int64_t tension_count = 0;
+  for (auto _ : state) {
+    speedyResetStream(stream, nullptr);
+    std::chrono::duration<double> elapsed(0);
+    int64_t output_time = 0;
+    float tension;
+    tension_count = 0;
+    for (int64_t t = 0; t < frame_count; t++) {
+      speedyAddData(stream, &input[t * frame_step], t);
+      auto start = std::chrono::high_resolution_clock::now();
+      if (speedyComputeTension(stream, output_time, &tension)) {
+        output_time++;
+        tension_count++;
+      }
+      elapsed += std::chrono::high_resolution_clock::now() - start;
+      benchmark::DoNotOptimize(tension);
+    }
+    state.SetIterationTime(elapsed.count());
+  }
+  SetFrameCounters(state, tension_count, input.size() / double(sample_rate));
+  speedyDestroyStream(stream);
+}
+
+// Time the whole sonicWriteFloatToStream path (analysis, speed computation
+// and SOLA), reading the output as it comes, like a player does.
+void BM_SonicWrite(benchmark::State& state) {
+  const int sample_rate = state.range(0);
+  const int channel_count = state.range(1);
+  const float nonlinear = state.range(2);
+  const bool decimated = state.range(3);
+  const std::vector<float>& input = TestSound(sample_rate, channel_count);
+  if (input.empty()) {
+    state.SkipWithError("Can't read the test sound");
+    return;
+  }
+  const int64_t sample_count = input.size() / channel_count;
+  std::vector<float> output(4 * kChunkSize * channel_count);
+  for (auto _ : state) {
+    state.PauseTiming();
+    sonicStream stream = sonicCreateStream(sample_rate, channel_count);
+    if (decimated) {
+      sonicEnableDecimatedAnalysis(stream);
+    }
+    sonicSetSpeed(stream, 2.0);
+    sonicEnableNonlinearSpeedup(stream, nonlinear);
+    state.ResumeTiming();
+    for (int64_t t = 0; t < sample_count; t += kChunkSize) {
+      int count = std::min<int64_t>(kChunkSize, sample_count - t);
+      sonicWriteFloatToStream(stream, &input[t * channel_count], count);
+      while (sonicReadFloatFromStream(stream, &output[0], 4 * kChunkSize) > 0) {
+      }
+    }
+    sonicFlushStream(stream);
+    while (sonicReadFloatFromStream(stream, &output[0], 4 * kChunkSize) > 0) {
+    }
+    state.PauseTiming();
+    sonicDestroyStream(stream);
+    state.ResumeTiming();
+  }
+  const int frame_step = sample_rate / 100;
+  SetFrameCounters(state, sample_count / frame_step,
+                   sample_count / double(sample_rate));
+}
+
+void SampleRateArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int sample_rate : kSampleRates) {
+    benchmark->Arg(sample_rate);
+  }
+}
+
+// Sample rate, channel count, linear (0) or nonlinear (1) speedup, and for
+// nonlinear speedup full rate (0) or decimated (1) analysis.
+void SonicWriteArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"rate", "channels", "nonlinear", "decimated"});
+  for (int sample_rate : kSampleRates) {
+    for (int channel_count : {1, 2}) {
+      benchmark->Args({sample_rate, channel_count, 0, 0});
+      benchmark->Args({sample_rate, channel_count, 1, 0});
+      benchmark->Args({sample_rate, channel_count, 1, 1});
+    }
+  }
+}
+
+BENCHMARK(BM_SpeedyAddData)->Apply(SampleRateArgs)->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SpeedyComputeTension)->Apply(SampleRateArgs)->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SonicWrite)->Apply(SonicWriteArgs)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  if (argc > 1) {
+    data_dir = argv[1];
+    if (!data_dir.empty() && data_dir.back() != '/') {
+      data_dir += '/';
+    }
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,234 @@
+/* Speedy tension sidecar files
+   Copyright 2022
+   Google
+
+   This file is licensed under the Apache 2.0 license.
+*/
+
+#include <assert.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "speedy_sidecar.h"
+
+static const char kSidecarMagic[4] = {'S', 'P', 'D', 'T'};
+
+struct speedySidecarStruct {
+  const unsigned char* data;   /* The whole file */
+  size_t size;
+  int mapped;                  /* Whether data came from mmap */
+  const speedySidecarHeader* header;
+  const void* tension;         /* float or int16_t, by header->encoding */
+  const float* features;
+};
+
+/* Bytes of tension data, padded so the features stay float aligned. */
+static size_t sidecarTensionBytes(int encoding, int64_t frame_count) {
+  size_t bytes = frame_count * (encoding == kSpeedySidecarInt16 ?
+                                sizeof(int16_t) : sizeof(float));
+  return (bytes + 3) & ~(size_t)3;
+}
+
+/* Write the tensions as int16, spreading [min, max] over the whole range. */
+static int sidecarWriteQuantizedTension(FILE* fp, speedySidecarHeader* header,
+                                        const float tension[],
+                                        int64_t frame_count) {
+  float min_tension = frame_count ? tension[0] : 0.0f;
+  float max_tension = min_tension;
+  int64_t i;
+  for (i=1; i < frame_count; i++) {
+    if (tension[i] < min_tension) min_tension = tension[i];
+    if (tension[i] > max_tension) max_tension = tension[i];
+  }
+  header->tension_offset = 0.5f*(min_tension + max_tension);
+  header->tension_scale = (max_tension - min_tension)/65534.0f;
+  if (header->tension_scale <= 0.0f) {
+    header->tension_scale = 1.0f;
+  }
+  if (fwrite(header, sizeof(*header), 1, fp) != 1) {
+    return 0;
+  }
+  for (i=0; i < frame_count; i++) {
+    int16_t q = (int16_t)lrintf((tension[i] - header->tension_offset)/
+                                header->tension_scale);
+    if (fwrite(&q, sizeof(q), 1, fp) != 1) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int speedySidecarWrite(const char* file_name, speedyStream stream,
+                       const float tension[], const float features[],
+                       int64_t frame_count, int encoding) {
+  assert(stream);
+  assert(encoding == kSpeedySidecarFloat32 || encoding == kSpeedySidecarInt16);
+  if (frame_count < 0 || frame_count > (int64_t)UINT32_MAX) {
+    return 0;
+  }
+  speedySidecarHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kSidecarMagic, sizeof(header.magic));
+  header.version = kSpeedySidecarVersion;
+  header.header_size = sizeof(header);
+  header.sample_rate = speedyGetSampleRate(stream);
+  header.frame_step = speedyInputFrameStep(stream);
+  header.frame_rate = header.sample_rate/(float)header.frame_step;
+  header.frame_count = (uint32_t)frame_count;
+  header.hysteresis_future = speedyGetLookahead(stream);
+  header.hysteresis_past = kTemporalHysteresisPast;
+  header.encoding = encoding;
+  header.feature_count = features ? kFeatureValueCount : 0;
+  header.tension_scale = 1.0f;
+  header.tension_offset = 0.0f;
+  speedyGetTuningParameters(stream, header.tuning);
+
+  FILE* fp = fopen(file_name, "wb");
+  if (!fp) {
+    return 0;
+  }
+  int ok;
+  if (encoding == kSpeedySidecarInt16) {
+    ok = sidecarWriteQuantizedTension(fp, &header, tension, frame_count);
+  } else {
+    ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+        fwrite(tension, sizeof(float), frame_count, fp) == (size_t)frame_count;
+  }
+  static const char kPadding[4] = {0, 0, 0, 0};
+  size_t written = frame_count * (encoding == kSpeedySidecarInt16 ?
+                                  sizeof(int16_t) : sizeof(float));
+  size_t padding = sidecarTensionBytes(encoding, frame_count) - written;
+  if (ok && padding) {
+    ok = fwrite(kPadding, 1, padding, fp) == padding;
+  }
+  if (ok && features) {
+    size_t count = frame_count * kFeatureValueCount;
+    ok = fwrite(features, sizeof(float), count, fp) == count;
+  }
+  if (fclose(fp) != 0) {
+    ok = 0;
+  }
+  return ok;
+}
+
+speedySidecar speedySidecarParse(const void* data, size_t size) {
+  const speedySidecarHeader* header = (const speedySidecarHeader*)data;
+  if (!data || ((uintptr_t)data & 3) || size < sizeof(*header) ||
+      memcmp(header->magic, kSidecarMagic, sizeof(kSidecarMagic)) != 0 ||
+      header->version < kSpeedySidecarVersion ||
+      header->header_size < sizeof(*header) || (header->header_size & 3) ||
+      (header->encoding != kSpeedySidecarFloat32 &&
+       header->encoding != kSpeedySidecarInt16)) {
+    return NULL;
+  }
+  size_t tension_bytes = sidecarTensionBytes(header->encoding,
+                                             header->frame_count);
+  size_t feature_bytes = (size_t)header->frame_count * header->feature_count *
+      sizeof(float);
+  if (size < header->header_size + tension_bytes + feature_bytes) {
+    return NULL;
+  }
+  speedySidecar sidecar = (speedySidecar)calloc(1, sizeof(*sidecar));
+  if (!sidecar) {
+    return NULL;
+  }
+  sidecar->data = (const unsigned char*)data;
+  sidecar->size = size;
+  sidecar->header = header;
+  sidecar->tension = sidecar->data + header->header_size;
+  if (header->feature_count) {
+    sidecar->features = (const float*)(sidecar->data + header->header_size +
+                                       tension_bytes);
+  }
+  return sidecar;
+}
+
+speedySidecar speedySidecarOpen(const char* file_name) {
+  int fd = open(file_name, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    close(fd);
+    return NULL;
+  }
+  size_t size = file_stat.st_size;
+  void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  /* The mapping stays valid. */
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+  speedySidecar sidecar = speedySidecarParse(data, size);
+  if (!sidecar) {
+    munmap(data, size);
+    return NULL;
+  }
+  sidecar->mapped = 1;
+  return sidecar;
+}
+
+void speedySidecarClose(speedySidecar sidecar) {
+  if (!sidecar) {
+    return;
+  }
+  if (sidecar->mapped) {
+    munmap((void*)sidecar->data, sidecar->size);
+  }
+  free(sidecar);
+}
+
+const speedySidecarHeader* speedySidecarGetHeader(speedySidecar sidecar) {
+  assert(sidecar);
+  return sidecar->header;
+}
+
+int64_t speedySidecarFrameCount(speedySidecar sidecar) {
+  assert(sidecar);
+  return sidecar->header->frame_count;
+}
+
+float speedySidecarGetTension(speedySidecar sidecar, int64_t frame) {
+  assert(sidecar);
+  assert(frame >= 0 && frame < sidecar->header->frame_count);
+  if (sidecar->header->encoding == kSpeedySidecarInt16) {
+    return ((const int16_t*)sidecar->tension)[frame] *
+        sidecar->header->tension_scale + sidecar->header->tension_offset;
+  }
+  return ((const float*)sidecar->tension)[frame];
+}
+
+void speedySidecarDecodeTension(speedySidecar sidecar, float tension[]) {
+  assert(sidecar);
+  int64_t frame_count = sidecar->header->frame_count;
+  if (sidecar->header->encoding == kSpeedySidecarFloat32) {
+    memcpy(tension, sidecar->tension, frame_count * sizeof(float));
+    return;
+  }
+  const int16_t* q = (const int16_t*)sidecar->tension;
+  float scale = sidecar->header->tension_scale;
+  float offset = sidecar->header->tension_offset;
+  int64_t i;
+  for (i=0; i < frame_count; i++) {
+    tension[i] = q[i]*scale + offset;
+  }
+}
+
+const float* speedySidecarGetFloatTension(speedySidecar sidecar) {
+  assert(sidecar);
+  if (sidecar->header->encoding != kSpeedySidecarFloat32) {
+    return NULL;
+  }
+  return (const float*)sidecar->tension;
+}
+
+const float* speedySidecarGetFeatures(speedySidecar sidecar) {
+  assert(sidecar);
+  return sidecar->features;
+}
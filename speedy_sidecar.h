@@ -0,0 +1,98 @@
+//  Copyright 2022 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SPEEDY_SPEEDY_SIDECAR_H_
+#define SPEEDY_SPEEDY_SIDECAR_H_
+
+/*
+ * A compact binary file holding the speedy tension (and optionally the
+ * features) for every frame of a sound, so the analysis can be done once at
+ * ingest and shipped next to the audio.  Play it back with
+ * sonicSetTensionTrack().
+ *
+ * The file is little-endian:
+ *   speedySidecarHeader (header_size bytes, 72 in version 1)
+ *   frame_count tensions, float32 or int16 (see encoding), padded to 4 bytes
+ *   frame_count*feature_count float32 features, frame-major (optional)
+ * Readers skip header bytes they don't know about, so later versions can
+ * extend the header.  js/speedy-sidecar.js reads the same format.
+ */
+
+#include <stddef.h>
+
+#include "speedy.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define kSpeedySidecarVersion 1
+#define kSpeedySidecarFloat32 0   /* Tension stored as float */
+#define kSpeedySidecarInt16   1   /* Tension stored as q, tension=q*scale+offset */
+
+/* All fields are naturally aligned, so there is no padding. */
+typedef struct {
+  char magic[4];                 /* "SPDT" */
+  uint16_t version;              /* kSpeedySidecarVersion */
+  uint16_t header_size;          /* Bytes, the tension data starts here */
+  uint32_t sample_rate;
+  uint32_t frame_step;           /* Samples between frames */
+  float frame_rate;              /* Frames per second */
+  uint32_t frame_count;
+  int16_t hysteresis_future;     /* speedyGetLookahead, in frames */
+  int16_t hysteresis_past;       /* kTemporalHysteresisPast, in frames */
+  uint16_t encoding;             /* kSpeedySidecarFloat32 or kSpeedySidecarInt16 */
+  uint16_t feature_count;        /* Features per frame, 0 if none stored */
+  float tension_scale;           /* Only used by kSpeedySidecarInt16 */
+  float tension_offset;
+  float tuning[kSpeedyTuningParameterCount];  /* See speedyGetTuningParameters */
+} speedySidecarHeader;
+
+/* Write the tension of frame_count frames (e.g. from speedyComputeTensionBatch)
+ * to a sidecar file.  The header describes the stream that computed them.  If
+ * features isn't NULL, also store its kFeatureValueCount features per frame.
+ * Return 0 if the file can't be written.
+ */
+int speedySidecarWrite(const char* file_name, speedyStream stream,
+                       const float tension[], const float features[],
+                       int64_t frame_count, int encoding);
+
+struct speedySidecarStruct;  /* Defined internally in speedy_sidecar.c */
+typedef struct speedySidecarStruct* speedySidecar;
+
+/* Map a sidecar file into memory.  Return NULL if it can't be read or isn't a
+ * valid sidecar.
+ */
+speedySidecar speedySidecarOpen(const char* file_name);
+/* Read a sidecar already in memory, without copying it.  The data must be
+ * 4-byte aligned and outlive the returned sidecar.
+ */
+speedySidecar speedySidecarParse(const void* data, size_t size);
+void speedySidecarClose(speedySidecar sidecar);
+
+const speedySidecarHeader* speedySidecarGetHeader(speedySidecar sidecar);
+int64_t speedySidecarFrameCount(speedySidecar sidecar);
+float speedySidecarGetTension(speedySidecar sidecar, int64_t frame);
+/* Decode all speedySidecarFrameCount() tensions. */
+void speedySidecarDecodeTension(speedySidecar sidecar, float tension[]);
+/* The stored tensions, without a copy, or NULL if they are quantized. */
+const float* speedySidecarGetFloatTension(speedySidecar sidecar);
+/* The stored features (frame-major), or NULL if there are none. */
+const float* speedySidecarGetFeatures(speedySidecar sidecar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SPEEDY_SPEEDY_SIDECAR_H_ */
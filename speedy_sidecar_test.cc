@@ -0,0 +1,156 @@
+//  Copyright 2022 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "speedy_sidecar.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"  // Needed for external testing
+#include "speedy.h"
+
+namespace {
+
+constexpr int kSampleRate = 22050;
+
+class SpeedySidecarTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    stream_ = speedyCreateStream(kSampleRate);
+    // One second of tone bursts separated by silence, so the tension moves.
+    std::vector<float> input(kSampleRate);
+    for (int i = 0; i < input.size(); i++) {
+      float envelope = (i / 2205) % 2 ? 0.0 : 0.5;
+      input[i] = envelope * sin(2 * M_PI * 440.0 * i / kSampleRate);
+    }
+    int frame_count = speedyBatchFrameCount(stream_, input.size());
+    tension_.resize(frame_count);
+    features_.resize(frame_count * kFeatureValueCount);
+    ASSERT_TRUE(speedyComputeTensionBatch(stream_, &input[0], input.size(),
+                                          &tension_[0], &features_[0], 1));
+  }
+
+  void TearDown() override {
+    speedyDestroyStream(stream_);
+  }
+
+  std::string FileName(const std::string& name) {
+    return ::testing::TempDir() + name;
+  }
+
+  speedyStream stream_;
+  std::vector<float> tension_;
+  std::vector<float> features_;
+};
+
+TEST_F(SpeedySidecarTest, TestFloatRoundTrip) {
+  speedySetTensionWeights(stream_, 0.6, 0.3);
+  std::string file_name = FileName("speedy_float.spdt");
+  ASSERT_TRUE(speedySidecarWrite(file_name.c_str(), stream_, &tension_[0],
+                                 &features_[0], tension_.size(),
+                                 kSpeedySidecarFloat32));
+
+  speedySidecar sidecar = speedySidecarOpen(file_name.c_str());
+  ASSERT_TRUE(sidecar != NULL);
+  const speedySidecarHeader* header = speedySidecarGetHeader(sidecar);
+  EXPECT_EQ(header->version, kSpeedySidecarVersion);
+  EXPECT_EQ(header->sample_rate, kSampleRate);
+  EXPECT_EQ(header->frame_step, speedyInputFrameStep(stream_));
+  EXPECT_NEAR(header->frame_rate, 100.0, 0.5);
+  EXPECT_EQ(header->hysteresis_future, kTemporalHysteresisFuture);
+  EXPECT_EQ(header->hysteresis_past, kTemporalHysteresisPast);
+  EXPECT_EQ(header->feature_count, kFeatureValueCount);
+  EXPECT_FLOAT_EQ(header->tuning[3], 0.6);
+  EXPECT_FLOAT_EQ(header->tuning[4], 0.3);
+
+  ASSERT_EQ(speedySidecarFrameCount(sidecar), tension_.size());
+  const float* stored = speedySidecarGetFloatTension(sidecar);
+  ASSERT_TRUE(stored != NULL);
+  const float* features = speedySidecarGetFeatures(sidecar);
+  ASSERT_TRUE(features != NULL);
+  for (int i = 0; i < tension_.size(); i++) {
+    ASSERT_EQ(stored[i], tension_[i]);
+    ASSERT_EQ(speedySidecarGetTension(sidecar, i), tension_[i]);
+  }
+  for (int i = 0; i < features_.size(); i++) {
+    ASSERT_EQ(features[i], features_[i]);
+  }
+  speedySidecarClose(sidecar);
+}
+
+TEST_F(SpeedySidecarTest, TestQuantizedRoundTrip) {
+  std::string file_name = FileName("speedy_int16.spdt");
+  ASSERT_TRUE(speedySidecarWrite(file_name.c_str(), stream_, &tension_[0],
+                                 NULL, tension_.size(), kSpeedySidecarInt16));
+
+  speedySidecar sidecar = speedySidecarOpen(file_name.c_str());
+  ASSERT_TRUE(sidecar != NULL);
+  const speedySidecarHeader* header = speedySidecarGetHeader(sidecar);
+  EXPECT_EQ(header->encoding, kSpeedySidecarInt16);
+  EXPECT_EQ(header->feature_count, 0);
+  EXPECT_TRUE(speedySidecarGetFloatTension(sidecar) == NULL);
+  EXPECT_TRUE(speedySidecarGetFeatures(sidecar) == NULL);
+
+  float min_tension = tension_[0], max_tension = tension_[0];
+  for (float t : tension_) {
+    min_tension = std::min(min_tension, t);
+    max_tension = std::max(max_tension, t);
+  }
+  EXPECT_GT(max_tension, min_tension);
+  std::vector<float> decoded(speedySidecarFrameCount(sidecar));
+  ASSERT_EQ(decoded.size(), tension_.size());
+  speedySidecarDecodeTension(sidecar, &decoded[0]);
+  for (int i = 0; i < tension_.size(); i++) {
+    ASSERT_NEAR(decoded[i], tension_[i], (max_tension - min_tension)/65534.0)
+        << "Frame " << i;
+  }
+  speedySidecarClose(sidecar);
+}
+
+TEST_F(SpeedySidecarTest, TestRejectsBadData) {
+  std::vector<float> buffer(64);
+  EXPECT_TRUE(speedySidecarParse(&buffer[0], buffer.size()*sizeof(float)) ==
+              NULL);
+  EXPECT_TRUE(speedySidecarOpen(FileName("no_such_file.spdt").c_str()) ==
+              NULL);
+
+  // A header that promises more frames than the file holds.
+  std::string file_name = FileName("speedy_short.spdt");
+  ASSERT_TRUE(speedySidecarWrite(file_name.c_str(), stream_, &tension_[0],
+                                 NULL, tension_.size(), kSpeedySidecarFloat32));
+  speedySidecar sidecar = speedySidecarOpen(file_name.c_str());
+  ASSERT_TRUE(sidecar != NULL);
+  const speedySidecarHeader* header = speedySidecarGetHeader(sidecar);
+  size_t size = header->header_size + tension_.size()*sizeof(float);
+  std::vector<float> copy(size/sizeof(float));
+  memcpy(&copy[0], header, size);
+  speedySidecarClose(sidecar);
+  sidecar = speedySidecarParse(&copy[0], size);
+  ASSERT_TRUE(sidecar != NULL);
+  speedySidecarClose(sidecar);
+  EXPECT_TRUE(speedySidecarParse(&copy[0], size - sizeof(float)) == NULL);
+}
+
+}  // namespace
+
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
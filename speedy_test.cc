@@ -170,6 +170,9 @@ class SpeedyTest : public ::testing::Test {
     stream_ = speedyCreateStream(sampleRate);
   }
 
+  // Read test_data/tapestry.wav, scaled to [-1, 1).
+  std::vector<float> LoadTapestry(int* sample_rate);
+
   speedyStream stream_;
 };
 
@@ -189,6 +192,19 @@ std::vector<int16_t> ReadWaveFile(const std::string& fileName, int* sampleRate,
   return outputVector;
 }
 
+std::vector<float> SpeedyTest::LoadTapestry(int* sample_rate) {
+  std::string fullFileName =
+      ::testing::SrcDir() +
+      "test_data/tapestry.wav";
+  int numChannels;
+  auto tapestryInts = ReadWaveFile(fullFileName, sample_rate, &numChannels);
+  std::vector<float> tapestryVector;
+  for (int16_t sample : tapestryInts) {
+    tapestryVector.push_back(sample/32768.0);
+  }
+  return tapestryVector;
+}
+
 constexpr int kSampleRate = 22050;
 
 /* For a sinusoid input, does the spectrogram calculation put the peak in the
@@ -253,6 +269,36 @@ TEST_F(SpeedyTest, TestSpectrogram) {
   delete[] input;
 }
 
+// Make sure the spectrogram slice has the advertised number of bins, and that
+// all of them (in either the complex or the real-input FFT build) agree with a
+// direct DFT of the windowed input.
+TEST_F(SpeedyTest, TestSpectrogramSize) {
+  Initialize(kSampleRate);
+  const int window_size = speedyInputFrameSize(stream_);
+  const int fft_size = speedyFFTSize(stream_);
+  const int spectrogram_size = speedySpectrogramSize(stream_);
+#ifdef  SPEEDY_REAL_FFT
+  ASSERT_EQ(spectrogram_size, fft_size/2 + 1);
+#else
+  ASSERT_EQ(spectrogram_size, fft_size);
+#endif
+
+  std::vector<float> input(window_size);
+  for (int i = 0; i < window_size; i++) {
+    input[i] = sin(0.3*i) + 0.5*cos(1.7*i) + 0.01*(i % 7);
+  }
+  float* spectrogram = speedySpectrogram(stream_, &input[0]);
+  for (int k = 0; k < spectrogram_size; k++) {
+    double real = 0.0, imag = 0.0;
+    for (int i = 0; i < window_size; i++) {
+      double window = 0.54 - 0.46*cos(2*M_PI*i / (window_size-1.0));
+      real += input[i]*window*cos(2*M_PI*i*k/fft_size);
+      imag -= input[i]*window*sin(2*M_PI*i*k/fft_size);
+    }
+    EXPECT_NEAR(spectrogram[k], sqrt(real*real + imag*imag), 1e-3) << k;
+  }
+}
+
 
 // Check the preemphasis filter in the simplest case, a big buffer of data.
 // Make sure it has the right impulse response.
@@ -483,6 +529,7 @@ TEST_F(SpeedyTest, TestTension) {
   const int window_size = speedyInputFrameSize(stream_);
   const int frame_count = (kSampleCount-window_size)/kStepSize + 1;
   const int fft_size = speedyFFTSize(stream_);
+  const int spectrogram_size = speedySpectrogramSize(stream_);
   float* tension = new float[frame_count];
 
   // Write out the experiment parameters.
@@ -502,7 +549,8 @@ TEST_F(SpeedyTest, TestTension) {
     if (speedyComputeTension(stream_, output_time, &tension[output_time])) {
       // Write out one spectrogram slice.  Convert index (f) to Matlab indexing
       float* spectrogram = speedyGetSpectrogram(stream_);
-      debug.Write1DColumn("spectrogram", spectrogram, fft_size, output_time);
+      debug.Write1DColumn("spectrogram", spectrogram, spectrogram_size,
+                          output_time);
       // Write out one spectrogram slice.  Convert index (f) to Matlab indexing
       float* normalized_spectrogram = speedyGetNormalizedSpectrogram(stream_);
       debug.Write1DColumn("normalized_spectrogram", normalized_spectrogram,
@@ -650,6 +698,328 @@ TEST_F(SpeedyTest, TestRealSpeechNormalized) {
   EXPECT_NEAR(average_speed, Rg, Rg/10.0);
 }
 
+// The batch analysis (with several threads, when built with SPEEDY_PTHREADS)
+// should give exactly the same tensions and features as the streaming loop,
+// for all the frames that the loop finishes.
+TEST_F(SpeedyTest, TestBatchTension) {
+  int sampleRate;
+  std::vector<float> tapestryVector = LoadTapestry(&sampleRate);
+
+  Initialize(sampleRate);
+  const int step = speedyInputFrameStep(stream_);
+  const int frame_count = speedyBatchFrameCount(stream_,
+                                                tapestryVector.size());
+  ASSERT_EQ(frame_count,
+            (tapestryVector.size() - speedyInputFrameSize(stream_))/step + 1);
+
+  std::vector<float> tension, features;
+  int output_time = 0;
+  for (int input_time = 0; input_time < frame_count; input_time++) {
+    float new_tension;
+    speedyAddData(stream_, &tapestryVector[input_time*step], input_time);
+    if (speedyComputeTension(stream_, output_time, &new_tension)) {
+      tension.push_back(new_tension);
+      float* state = speedyGetInternalState(stream_);
+      features.insert(features.end(), state, state + kFeatureValueCount);
+      output_time++;
+    }
+  }
+  ASSERT_EQ(tension.size(), frame_count - kTemporalHysteresisFuture);
+
+  for (int thread_count : {1, 4}) {
+    speedyStream batch_stream = speedyCreateStream(sampleRate);
+    std::vector<float> batch_tension(frame_count);
+    std::vector<float> batch_features(frame_count*kFeatureValueCount);
+    ASSERT_TRUE(speedyComputeTensionBatch(batch_stream, &tapestryVector[0],
+                                          tapestryVector.size(),
+                                          &batch_tension[0],
+                                          &batch_features[0], thread_count));
+    for (int i = 0; i < tension.size(); i++) {
+      ASSERT_EQ(batch_tension[i], tension[i]) << "Frame " << i << " with " <<
+          thread_count << " threads";
+    }
+    for (int i = 0; i < features.size(); i++) {
+      ASSERT_EQ(batch_features[i], features[i]) << "Feature " << i << " with " <<
+          thread_count << " threads";
+    }
+    for (int i = tension.size(); i < frame_count; i++) {
+      EXPECT_TRUE(std::isfinite(batch_tension[i]));
+    }
+    speedyDestroyStream(batch_stream);
+  }
+}
+
+/* A parameter sweep gives the same tension tracks as the batch analysis with
+ * each parameter set, and the durations speedyComputeSpeedFromTension would.
+ */
+TEST_F(SpeedyTest, TestParameterSweep) {
+  int sampleRate;
+  std::vector<float> tapestryVector = LoadTapestry(&sampleRate);
+
+  Initialize(sampleRate);
+  float defaults[kSpeedyTuningParameterCount];
+  speedyGetTuningParameters(stream_, defaults);
+  std::vector<float> parameters;
+  for (float divisor : {100.0f, 50.0f}) {
+    for (float scale : {0.04f, 0.08f}) {
+      for (float weight : {0.5f, 0.7f}) {
+        std::vector<float> set(defaults, defaults + kSpeedyTuningParameterCount);
+        set[1] = scale;
+        set[2] = divisor;
+        set[3] = weight;
+        parameters.insert(parameters.end(), set.begin(), set.end());
+      }
+    }
+  }
+  const int set_count = parameters.size()/kSpeedyTuningParameterCount;
+
+  speedySweep sweep = speedyCreateSweep(stream_, &tapestryVector[0],
+                                        tapestryVector.size(), 4);
+  ASSERT_TRUE(sweep);
+  const int frame_count = speedySweepFrameCount(sweep);
+  ASSERT_EQ(frame_count, speedyBatchFrameCount(stream_, tapestryVector.size()));
+  std::vector<float> tension(set_count*frame_count), durations(set_count);
+  for (int thread_count : {1, 3}) {
+    ASSERT_TRUE(speedyRunSweep(sweep, &parameters[0], set_count, 2.0, 0.1,
+                               &tension[0], &durations[0], thread_count));
+    for (int set = 0; set < set_count; set++) {
+      speedyStream batch_stream = speedyCreateStream(sampleRate);
+      speedySetTuningParameters(batch_stream,
+                                &parameters[set*kSpeedyTuningParameterCount]);
+      std::vector<float> batch_tension(frame_count);
+      ASSERT_TRUE(speedyComputeTensionBatch(batch_stream, &tapestryVector[0],
+                                            tapestryVector.size(),
+                                            &batch_tension[0], nullptr, 1));
+      for (int i = 0; i < frame_count; i++) {
+        ASSERT_EQ(tension[set*frame_count + i], batch_tension[i]) <<
+            "Frame " << i << " of set " << set << " with " << thread_count <<
+            " threads";
+        speedyComputeSpeedFromTension(batch_tension[i], 2.0, 0.1, batch_stream);
+      }
+      speedyCheckpoint checkpoint;
+      speedyGetCheckpoint(batch_stream, &checkpoint);
+      EXPECT_EQ(durations[set], checkpoint.current_duration) << "Set " << set;
+      speedyDestroyStream(batch_stream);
+    }
+  }
+  speedyDestroySweep(sweep);
+}
+
+/* A shorter lookahead gives each tension that many frames after its data, and
+ * the batch analysis still matches the streaming one.
+ */
+TEST_F(SpeedyTest, TestLookahead) {
+  int sampleRate;
+  std::vector<float> tapestryVector = LoadTapestry(&sampleRate);
+
+  Initialize(sampleRate);
+  EXPECT_EQ(speedyGetLookahead(stream_), kTemporalHysteresisFuture);
+  speedySetLookahead(stream_, kTemporalHysteresisFuture + 1);
+  EXPECT_EQ(speedyGetLookahead(stream_), kTemporalHysteresisFuture);
+  speedySetLookahead(stream_, -1);
+  EXPECT_EQ(speedyGetLookahead(stream_), 0);
+
+  const int step = speedyInputFrameStep(stream_);
+  const int frame_count = speedyBatchFrameCount(stream_,
+                                                tapestryVector.size());
+  std::vector<float> full_tension;
+  for (int lookahead : {kTemporalHysteresisFuture, 3, 0}) {
+    speedyResetStream(stream_, NULL);
+    speedySetLookahead(stream_, lookahead);
+    std::vector<float> tension;
+    for (int input_time = 0; input_time < frame_count; input_time++) {
+      float new_tension;
+      speedyAddData(stream_, &tapestryVector[input_time*step], input_time);
+      if (speedyComputeTension(stream_, tension.size(), &new_tension)) {
+        tension.push_back(new_tension);
+        ASSERT_EQ(tension.size() - 1 + lookahead, input_time);
+      }
+    }
+    ASSERT_EQ(tension.size(), frame_count - lookahead);
+
+    speedyStream batch_stream = speedyCreateStream(sampleRate);
+    speedySetLookahead(batch_stream, lookahead);
+    std::vector<float> batch_tension(frame_count);
+    ASSERT_TRUE(speedyComputeTensionBatch(batch_stream, &tapestryVector[0],
+                                          tapestryVector.size(),
+                                          &batch_tension[0], nullptr, 1));
+    speedyDestroyStream(batch_stream);
+    for (int i = 0; i < tension.size(); i++) {
+      ASSERT_EQ(batch_tension[i], tension[i]) << "Frame " << i <<
+          " with a lookahead of " << lookahead;
+    }
+
+    if (lookahead == kTemporalHysteresisFuture) {
+      full_tension = tension;
+    } else {
+      // Still mostly the same track, just less ready for what's coming.
+      double difference = 0;
+      for (int i = 0; i < tension.size() && i < full_tension.size(); i++) {
+        difference += fabs(tension[i] - full_tension[i]);
+      }
+      double mean_difference = difference/full_tension.size();
+      EXPECT_GT(mean_difference, 0.0);
+      EXPECT_LT(mean_difference, 0.5) << "Lookahead " << lookahead;
+    }
+  }
+}
+
+/* The silence gate skips the FFT of quiet frames without changing the tensions
+ * by more than rounding, and the batch analysis gates the same frames.
+ */
+TEST_F(SpeedyTest, TestSilenceGate) {
+  int sampleRate;
+  std::vector<float> tapestryVector = LoadTapestry(&sampleRate);
+  // Speech with two half second pauses, faint noise and digital silence.
+  std::vector<float> input;
+  const size_t pause = sampleRate/2;
+  for (size_t i = 0; i < tapestryVector.size(); i++) {
+    if (i == tapestryVector.size()/3) {
+      for (size_t j = 0; j < pause; j++) {
+        input.push_back(1e-4*((j*7919) % 201 - 100)/100.0);
+      }
+    } else if (i == 2*tapestryVector.size()/3) {
+      input.insert(input.end(), pause, 0.0f);
+    }
+    input.push_back(tapestryVector[i]);
+  }
+
+  Initialize(sampleRate);
+  EXPECT_FALSE(speedyGetSilenceGate(stream_));
+  const int step = speedyInputFrameStep(stream_);
+  const int frame_count = speedyBatchFrameCount(stream_, input.size());
+  const int spectrogram_size = speedySpectrogramSize(stream_);
+  std::vector<float> tension[2];
+  int gated_count = 0;
+  for (int gate = 0; gate < 2; gate++) {
+    speedyResetStream(stream_, NULL);
+    speedySetSilenceGate(stream_, gate);
+    int output_time = 0;
+    for (int input_time = 0; input_time < frame_count; input_time++) {
+      float new_tension;
+      speedyAddData(stream_, &input[input_time*step], input_time);
+      const float* spectrogram = speedyGetSpectrogram(stream_);
+      if (gate && std::all_of(spectrogram, spectrogram + spectrogram_size,
+                              [](float bin) { return bin == 0.0f; })) {
+        gated_count++;
+      }
+      if (speedyComputeTension(stream_, output_time, &new_tension)) {
+        tension[gate].push_back(new_tension);
+        output_time++;
+      }
+    }
+  }
+  // Most of the pauses, and none of the speech.
+  EXPECT_GT(gated_count, 80);
+  EXPECT_LT(gated_count, 120);
+  ASSERT_EQ(tension[1].size(), tension[0].size());
+  for (int i = 0; i < tension[0].size(); i++) {
+    ASSERT_NEAR(tension[1][i], tension[0][i], 1e-4) << "Frame " << i;
+  }
+
+  for (int thread_count : {1, 4}) {
+    speedyStream batch_stream = speedyCreateStream(sampleRate);
+    speedySetSilenceGate(batch_stream, 1);
+    std::vector<float> batch_tension(frame_count);
+    ASSERT_TRUE(speedyComputeTensionBatch(batch_stream, &input[0],
+                                          input.size(), &batch_tension[0],
+                                          nullptr, thread_count));
+    speedyDestroyStream(batch_stream);
+    for (int i = 0; i < tension[1].size(); i++) {
+      ASSERT_EQ(batch_tension[i], tension[1][i]) << "Frame " << i << " with " <<
+          thread_count << " threads";
+    }
+  }
+}
+
+/* After a reset, a stream should analyze a sound exactly like a new stream. */
+TEST_F(SpeedyTest, TestResetStream) {
+  int sampleRate;
+  std::vector<float> tapestryVector = LoadTapestry(&sampleRate);
+
+  Initialize(sampleRate);
+  const int step = speedyInputFrameStep(stream_);
+  const int frame_count = speedyBatchFrameCount(stream_,
+                                                tapestryVector.size());
+  std::vector<float> tension[2];
+  for (int pass = 0; pass < 2; pass++) {
+    int output_time = 0;
+    for (int input_time = 0; input_time < frame_count; input_time++) {
+      float new_tension;
+      speedyAddData(stream_, &tapestryVector[input_time*step], input_time);
+      if (speedyComputeTension(stream_, output_time, &new_tension)) {
+        tension[pass].push_back(new_tension);
+        float speed = speedyComputeSpeedFromTension(new_tension, 2.0, 0.1,
+                                                    stream_);
+        EXPECT_GT(speed, 0.0);
+        output_time++;
+      }
+    }
+    speedyCheckpoint checkpoint;
+    speedyGetCheckpoint(stream_, &checkpoint);
+    EXPECT_GT(checkpoint.current_duration, 0.0);
+    speedyResetStream(stream_, NULL);
+    speedyGetCheckpoint(stream_, &checkpoint);
+    EXPECT_EQ(checkpoint.current_duration, 0.0);
+    EXPECT_EQ(speedyGetCurrentTime(stream_), 0);
+  }
+  ASSERT_EQ(tension[0].size(), frame_count - kTemporalHysteresisFuture);
+  ASSERT_EQ(tension[1].size(), tension[0].size());
+  for (int i = 0; i < tension[0].size(); i++) {
+    ASSERT_EQ(tension[1][i], tension[0][i]) << "Frame " << i;
+  }
+}
+
+// Streams of the same size share their window and reuse plans; none of that
+// should change their spectrograms, before or after the cache is freed.
+TEST_F(SpeedyTest, TestSharedTables) {
+  constexpr int kSampleRate = 22050;
+  speedyStream first = speedyCreateStream(kSampleRate);
+  speedyStream second = speedyCreateStream(kSampleRate);
+  ASSERT_TRUE(first);
+  ASSERT_TRUE(second);
+  const int size = speedyInputFrameSize(first);
+  const int bins = speedySpectrogramSize(first);
+  std::vector<float> input(size);
+  for (int i = 0; i < size; i++) {
+    input[i] = sin(2*M_PI*440*i/kSampleRate);
+  }
+  std::vector<float> expected(speedySpectrogram(first, &input[0]),
+                              speedySpectrogram(first, &input[0]) + bins);
+  const float* spectrogram = speedySpectrogram(second, &input[0]);
+  for (int i = 0; i < bins; i++) {
+    ASSERT_EQ(spectrogram[i], expected[i]) << "Bin " << i;
+  }
+
+  // The next stream gets the first one's plan.
+  speedyDestroyStream(first);
+  speedyStream third = speedyCreateStream(kSampleRate);
+  ASSERT_TRUE(third);
+  spectrogram = speedySpectrogram(third, &input[0]);
+  for (int i = 0; i < bins; i++) {
+    ASSERT_EQ(spectrogram[i], expected[i]) << "Bin " << i;
+  }
+
+  // Freeing the cache keeps the tables still in use.
+  speedyFreeCachedTables();
+  spectrogram = speedySpectrogram(second, &input[0]);
+  for (int i = 0; i < bins; i++) {
+    ASSERT_EQ(spectrogram[i], expected[i]) << "Bin " << i;
+  }
+  speedyDestroyStream(second);
+  speedyDestroyStream(third);
+  speedyFreeCachedTables();
+
+  // And a stream after that builds them again.
+  speedyStream fourth = speedyCreateStream(kSampleRate);
+  ASSERT_TRUE(fourth);
+  spectrogram = speedySpectrogram(fourth, &input[0]);
+  for (int i = 0; i < bins; i++) {
+    ASSERT_EQ(spectrogram[i], expected[i]) << "Bin " << i;
+  }
+  speedyDestroyStream(fourth);
+}
+
 float MeasureExcessDuration(float feedbackStrength){
   std::string fullFileName =
       ::testing::SrcDir() +
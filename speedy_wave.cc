@@ -13,13 +13,27 @@
 // limitations under the License.
 
 #include <assert.h>
+#include <dirent.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <utility>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
 #include <vector>
 #include "sonic.h"
 
@@ -27,6 +41,7 @@ extern "C" {
 #include "wave.h"
 #include "sonic2.h"
 #include "speedy.h"
+#include "speedy_sidecar.h"
 }
 
 double speed = 3.0;
@@ -35,6 +50,12 @@ double nonlinear = 1.0;
 double normalization_time = 0.0;   /* Seconds, 0 turns it off. */
 double desired_length = 0.0;
 int match_nonlinear = false;
+int sidecar_int16 = false;
+std::string sidecar_file_name;
+speedySidecar tension_track = NULL;
+std::string batch_name;             /* Manifest file or directory */
+std::string output_dir_name;
+int thread_count = 0;               /* 0 means one per core */
 
 /*
  * A simple application that time-compresses one speech file.
@@ -62,6 +83,17 @@ int match_nonlinear = false;
      --nonlinear 0.0 --speed 3 --match_nonlinear --output /tmp/tap_matched.wav
    # To see the computed tension and the resulting speedup, add these arguments
      --tension_file /tmp/tension.txt --speed_file /tmp/speed.txt
+   # Analyze once into a binary sidecar, then play it back without analysis
+   ../../blaze-bin/speedy_wave \
+     --input test_data/tapestry.wav \
+     --sidecar_file /tmp/tapestry.spdt --speed 3 --output /tmp/tap_nl.wav
+   ../../blaze-bin/speedy_wave \
+     --input test_data/tapestry.wav \
+     --tension_track /tmp/tapestry.spdt --speed 2 --output /tmp/tap_nl2.wav
+   # Compress every .wav file in a directory (or listed in a manifest file,
+   # one name per line) on 8 threads, into another directory
+   ../../blaze-bin/speedy_wave \
+     --batch test_data --output_dir /tmp/fast --threads 8 --speed 3
 */
 
 
@@ -123,6 +155,60 @@ void normalizedSpectrogramSaver(sonicStream myStream, int time,
 
 
 
+/*
+ * Analyze a whole sound file (downmixed to mono) with the batch Speedy API and
+ * store the tension and features of every frame in a binary sidecar file
+ * (see speedy_sidecar.h), quantized to 16 bits if int16 is set.
+ */
+void write_sidecar(const std::string& input_file_name,
+                   const std::string& output_file_name, int int16) {
+  int sampleRate, numChannels;
+  waveFile waveInputFp = openInputWaveFile(input_file_name.c_str(),
+                                           &sampleRate, &numChannels);
+  if (!waveInputFp) {
+    std::cerr << "Can't open " << input_file_name << " for speedy input." <<
+        std::endl;
+    exit(-1);
+  }
+  const int maxSamples = 1000;
+  int16_t* inputBuffer = new int16_t[numChannels*maxSamples];
+  std::vector<float> mono;
+  int framesRead;
+  while ((framesRead = readFromWaveFile(waveInputFp, inputBuffer,
+                                        maxSamples)) > 0) {
+    for (int i = 0; i < framesRead; i++) {
+      float sum = 0.0;
+      for (int c = 0; c < numChannels; c++) {
+        sum += inputBuffer[i*numChannels + c];
+      }
+      mono.push_back(sum/(32768.0*numChannels));
+    }
+  }
+  delete[] inputBuffer;
+  closeWaveFile(waveInputFp);
+
+  speedyStream stream = speedyCreateStream(sampleRate);
+  int64_t frame_count = speedyBatchFrameCount(stream, mono.size());
+  std::vector<float> tension(frame_count);
+  std::vector<float> features(frame_count*kFeatureValueCount);
+  if (frame_count > 0 &&
+      !speedyComputeTensionBatch(stream, &mono[0], mono.size(), &tension[0],
+                                 &features[0], 4)) {
+    std::cerr << "Out of memory analyzing " << input_file_name << std::endl;
+    exit(-1);
+  }
+  if (!speedySidecarWrite(output_file_name.c_str(), stream, tension.data(),
+                          features.data(), frame_count,
+                          int16 ? kSpeedySidecarInt16 : kSpeedySidecarFloat32)) {
+    std::cerr << "Can't write the sidecar file " << output_file_name <<
+        std::endl;
+    exit(-1);
+  }
+  speedyDestroyStream(stream);
+  printf("Wrote the tension of %lld frames to %s.\n", (long long)frame_count,
+         output_file_name.c_str());
+}
+
 /*
  * Compress a sound and return the actual compression length.
  *
@@ -176,6 +262,12 @@ double compress_sound(const std::string& input_file_name, double speed,
 
   sonicEnableNonlinearSpeedup(mySonicStream, nonlinear > 0.0);
   sonicSetDurationFeedbackStrength(mySonicStream, duration_feedback_strength);
+  if (tension_track) {
+    // Play back the precomputed tension instead of analyzing the input.
+    std::vector<float> track(speedySidecarFrameCount(tension_track));
+    speedySidecarDecodeTension(tension_track, track.data());
+    sonicSetTensionTrack(mySonicStream, track.data(), track.size());
+  }
   if (nonlinear > 0.0 && !output_file_name.empty()) {
     // If we are generating non-linear output, output the debug data if wanted.
     sonicTensionCallback(mySonicStream, tensionSaver);
@@ -241,13 +333,380 @@ double compress_sound(const std::string& input_file_name, double speed,
                              totalFramesProducedBySpeedy;
 }
 
+/*
+ * Batch mode.  Each worker thread takes the next file, maps it into memory,
+ * runs it through its own sonicStream and writes the output through a large
+ * stdio buffer.  With --match_nonlinear the linear pass reuses the samples
+ * already in memory and the speed measured by the nonlinear pass, so the
+ * input is read and analyzed only once.  Every pass gets a new stream, since
+ * libsonic keeps some state across a seek and the output shouldn't depend on
+ * which files a worker happened to compress before; with the speedy tables
+ * cached, that only costs the stream's buffers.
+ */
+
+/* A 16-bit PCM wave file mapped into memory. */
+struct MappedWave {
+  int sample_rate = 0;
+  int channel_count = 0;
+  const int16_t* samples = NULL;     /* Interleaved, in the mapping */
+  int64_t frame_count = 0;           /* Multi-channel samples */
+  void* map = MAP_FAILED;
+  size_t map_size = 0;
+};
+
+static uint32_t read_le32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_le16(const uint8_t* p) {
+  return p[0] | (p[1] << 8);
+}
+
+/* Map a wave file and find its format and data chunks.  The samples are used
+ * in place, so this assumes a little-endian host, as wave files are.  Return
+ * false, with a message in error, if the file can't be read or isn't 16-bit
+ * PCM.
+ */
+bool map_wave_file(const std::string& file_name, MappedWave* wave,
+                   std::string* error) {
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    *error = "can't open it";
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) < 0 || info.st_size < 12) {
+    close(fd);
+    *error = "it is too short";
+    return false;
+  }
+  wave->map_size = info.st_size;
+  wave->map = mmap(NULL, wave->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (wave->map == MAP_FAILED) {
+    *error = "can't map it";
+    return false;
+  }
+  madvise(wave->map, wave->map_size, MADV_SEQUENTIAL);
+  const uint8_t* bytes = static_cast<const uint8_t*>(wave->map);
+  const uint8_t* end = bytes + wave->map_size;
+  if (memcmp(bytes, "RIFF", 4) || memcmp(bytes + 8, "WAVE", 4)) {
+    *error = "it isn't a wave file";
+    return false;
+  }
+  int bits_per_sample = 0, format = 0;
+  for (const uint8_t* chunk = bytes + 12; end - chunk >= 8;) {
+    uint64_t size = read_le32(chunk + 4);
+    const uint8_t* body = chunk + 8;
+    if (!memcmp(chunk, "fmt ", 4) && size >= 16 && end - body >= 16) {
+      format = read_le16(body);
+      wave->channel_count = read_le16(body + 2);
+      wave->sample_rate = read_le32(body + 4);
+      bits_per_sample = read_le16(body + 14);
+      if (format == 0xFFFE && size >= 26 && end - body >= 26) {
+        format = read_le16(body + 24);   /* WAVE_FORMAT_EXTENSIBLE subformat */
+      }
+    } else if (!memcmp(chunk, "data", 4)) {
+      /* Streaming writers may leave the size unset, so stop at the end. */
+      size = std::min<uint64_t>(size, end - body);
+      if (format != 1 || bits_per_sample != 16 || wave->channel_count <= 0 ||
+          wave->sample_rate <= 0) {
+        *error = "it isn't 16-bit PCM";
+        return false;
+      }
+      wave->samples = reinterpret_cast<const int16_t*>(body);
+      wave->frame_count = size / (2 * wave->channel_count);
+      return true;
+    }
+    chunk = body + size + (size & 1);
+  }
+  *error = "it has no data";
+  return false;
+}
+
+void unmap_wave_file(MappedWave* wave) {
+  if (wave->map != MAP_FAILED) {
+    munmap(wave->map, wave->map_size);
+    wave->map = MAP_FAILED;
+  }
+}
+
+/* Writes a 16-bit PCM wave file through a large buffer, filling in the sizes
+ * in the header when closed.
+ */
+class BufferedWaveWriter {
+ public:
+  static constexpr size_t kBufferSize = 1 << 20;
+
+  bool open(const std::string& file_name, int sample_rate, int channel_count) {
+    fp_ = fopen(file_name.c_str(), "wb");
+    if (!fp_) {
+      return false;
+    }
+    setvbuf(fp_, NULL, _IOFBF, kBufferSize);
+    channel_count_ = channel_count;
+    frame_count_ = 0;
+    uint8_t header[44] = {0};
+    memcpy(header, "RIFF", 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put_le32(header + 16, 16);
+    put_le16(header + 20, 1);                    /* PCM */
+    put_le16(header + 22, channel_count);
+    put_le32(header + 24, sample_rate);
+    put_le32(header + 28, sample_rate * channel_count * 2);
+    put_le16(header + 32, channel_count * 2);
+    put_le16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    return fwrite(header, sizeof(header), 1, fp_) == 1;
+  }
+
+  bool write(const int16_t* samples, int frame_count) {
+    frame_count_ += frame_count;
+    return fwrite(samples, 2 * channel_count_, frame_count, fp_) ==
+        static_cast<size_t>(frame_count);
+  }
+
+  /* Return false if any write failed. */
+  bool close() {
+    const uint32_t data_size = frame_count_ * 2 * channel_count_;
+    uint8_t size[4];
+    bool ok = !ferror(fp_);
+    put_le32(size, 36 + data_size);
+    ok = ok && fseek(fp_, 4, SEEK_SET) == 0 && fwrite(size, 4, 1, fp_) == 1;
+    put_le32(size, data_size);
+    ok = ok && fseek(fp_, 40, SEEK_SET) == 0 && fwrite(size, 4, 1, fp_) == 1;
+    ok = fclose(fp_) == 0 && ok;
+    fp_ = NULL;
+    return ok;
+  }
+
+ private:
+  static void put_le32(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+      p[i] = value >> (8 * i);
+    }
+  }
+
+  static void put_le16(uint8_t* p, uint16_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+  }
+
+  FILE* fp_ = NULL;
+  int channel_count_ = 0;
+  int64_t frame_count_ = 0;
+};
+
+/* Compress a mapped sound with a new stream, writing the output to writer if
+ * it isn't NULL.  Return the number of output frames, or -1 if we are out of
+ * memory.
+ */
+int64_t run_stream(const MappedWave& wave, double speed, double nonlinear,
+                   double duration_feedback_strength,
+                   std::vector<int16_t>* output, BufferedWaveWriter* writer) {
+  const int kChunkFrames = 8192;
+  sonicStream stream = sonicCreateStream(wave.sample_rate, wave.channel_count);
+  if (!stream) {
+    return -1;
+  }
+  sonicSetSpeed(stream, speed);
+  sonicEnableNonlinearSpeedup(stream, nonlinear > 0.0);
+  sonicSetDurationFeedbackStrength(stream, duration_feedback_strength);
+  output->resize(4096 * wave.channel_count);
+  const int output_frames = output->size() / wave.channel_count;
+  int64_t total = 0;
+  int frames;
+  for (int64_t t = 0; t < wave.frame_count; t += kChunkFrames) {
+    int count = std::min<int64_t>(kChunkFrames, wave.frame_count - t);
+    sonicWriteShortToStream(stream, wave.samples + t * wave.channel_count,
+                            count);
+    while ((frames = sonicReadShortFromStream(stream, output->data(),
+                                              output_frames)) > 0) {
+      total += frames;
+      if (writer) {
+        writer->write(output->data(), frames);
+      }
+    }
+  }
+  sonicFlushStream(stream);
+  while ((frames = sonicReadShortFromStream(stream, output->data(),
+                                            output_frames)) > 0) {
+    total += frames;
+    if (writer) {
+      writer->write(output->data(), frames);
+    }
+  }
+  sonicDestroyStream(stream);
+  return total;
+}
+
+/* The files named by a manifest (one per line, # starts a comment) or the
+ * .wav files in a directory, sorted.
+ */
+std::vector<std::string> list_batch_files(const std::string& name) {
+  std::vector<std::string> files;
+  struct stat info;
+  if (stat(name.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+    DIR* dir = opendir(name.c_str());
+    if (dir) {
+      struct dirent* entry;
+      while ((entry = readdir(dir)) != NULL) {
+        std::string file = entry->d_name;
+        if (file.size() > 4 && file.compare(file.size() - 4, 4, ".wav") == 0) {
+          files.push_back(name + "/" + file);
+        }
+      }
+      closedir(dir);
+    }
+    std::sort(files.begin(), files.end());
+  } else {
+    std::ifstream manifest(name);
+    std::string line;
+    while (std::getline(manifest, line)) {
+      line.erase(0, line.find_first_not_of(" \t"));
+      line.erase(line.find_last_not_of(" \t\r") + 1);
+      if (!line.empty() && line[0] != '#') {
+        files.push_back(line);
+      }
+    }
+  }
+  return files;
+}
+
+/* Name the output of each file of a batch: output_dir plus its file name.
+ * Opening an output truncates it, and the inputs are mapped while the outputs
+ * are written, so an output that is one of the inputs (the same file, by
+ * device and inode) is rejected, as is the output of a second input with the
+ * same file name.  rejected gets the reason, or stays empty.
+ */
+void name_batch_outputs(const std::vector<std::string>& files,
+                        const std::string& output_dir,
+                        std::vector<std::string>* output_names,
+                        std::vector<std::string>* rejected) {
+  std::set<std::pair<dev_t, ino_t>> inputs;
+  struct stat info;
+  for (const std::string& file : files) {
+    if (stat(file.c_str(), &info) == 0) {
+      inputs.insert(std::make_pair(info.st_dev, info.st_ino));
+    }
+  }
+  std::map<std::string, size_t> first_with_name;
+  output_names->resize(files.size());
+  rejected->assign(files.size(), std::string());
+  for (size_t i = 0; i < files.size(); i++) {
+    std::string& output_name = (*output_names)[i];
+    output_name = output_dir + "/" +
+        files[i].substr(files[i].find_last_of('/') + 1);
+    auto first = first_with_name.insert(std::make_pair(output_name, i));
+    if (!first.second) {
+      (*rejected)[i] = "its output " + output_name + " is also that of " +
+          files[first.first->second];
+    } else if (stat(output_name.c_str(), &info) == 0 &&
+               inputs.count(std::make_pair(info.st_dev, info.st_ino))) {
+      (*rejected)[i] = "its output " + output_name + " is an input";
+    }
+  }
+}
+
+/*
+ * Compress every file of a batch on worker threads, into output_dir (keeping
+ * the file names), and print the throughput.  Files rejected by
+ * name_batch_outputs() are skipped.  Return the number of files that failed.
+ */
+int compress_batch(const std::vector<std::string>& files,
+                   const std::string& output_dir, double speed,
+                   double nonlinear, double duration_feedback_strength,
+                   int threads) {
+  std::atomic<size_t> next_file(0);
+  std::atomic<int> failures(0);
+  std::mutex print_lock;
+  double total_input_seconds = 0.0, total_output_seconds = 0.0;
+  std::vector<std::string> output_names, rejected;
+  name_batch_outputs(files, output_dir, &output_names, &rejected);
+
+  auto worker = [&]() {
+    std::vector<int16_t> output;
+    size_t index;
+    while ((index = next_file++) < files.size()) {
+      const std::string& input_name = files[index];
+      const std::string& output_name = output_names[index];
+      MappedWave wave;
+      std::string error = rejected[index];
+      BufferedWaveWriter writer;
+      double input_seconds = 0.0, output_seconds = 0.0, file_speed = speed;
+      bool ok = error.empty() && map_wave_file(input_name, &wave, &error);
+      if (ok && match_nonlinear) {
+        // Measure the nonlinear speed, then match it linearly below.
+        int64_t frames = run_stream(wave, speed, 1.0,
+                                    duration_feedback_strength, &output, NULL);
+        if (frames > 0) {
+          file_speed = static_cast<double>(wave.frame_count) / frames;
+        }
+      }
+      if (ok && !writer.open(output_name, wave.sample_rate,
+                             wave.channel_count)) {
+        ok = false;
+        error = "can't open " + output_name;
+      }
+      if (ok) {
+        int64_t frames = run_stream(wave, file_speed,
+                                    match_nonlinear ? 0.0 : nonlinear,
+                                    duration_feedback_strength, &output,
+                                    &writer);
+        if (!writer.close() || frames < 0) {
+          ok = false;
+          error = frames < 0 ? "out of memory" : "can't write " + output_name;
+        }
+        input_seconds = wave.frame_count / static_cast<double>(wave.sample_rate);
+        output_seconds = frames / static_cast<double>(wave.sample_rate);
+      }
+      unmap_wave_file(&wave);
+
+      std::lock_guard<std::mutex> lock(print_lock);
+      if (ok) {
+        total_input_seconds += input_seconds;
+        total_output_seconds += output_seconds;
+        printf("%s: %.1f s to %.1f s (%gX)\n", input_name.c_str(),
+               input_seconds, output_seconds, input_seconds / output_seconds);
+      } else {
+        failures++;
+        fprintf(stderr, "%s: Skipped, %s.\n", input_name.c_str(),
+                error.c_str());
+      }
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; i++) {
+    workers.emplace_back(worker);
+  }
+  for (auto& thread : workers) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  const int done = files.size() - failures;
+  printf("Compressed %d files (%d failed) on %d threads in %.2f s: "
+         "%.2f files/s, %.1f s of audio at %.1fX real time, %.1f s of output.\n",
+         done, failures.load(), threads, seconds, done / seconds,
+         total_input_seconds, total_input_seconds / seconds,
+         total_output_seconds);
+  return failures;
+}
+
 int main(int argc, char** argv) {
   std::string input_file_name;
   std::string output_file_name;
   static const char* usage = "Usage: %s [--speed 3.0]\n"
                 "\t[--nonlinear 1.0] [--match_nonlinear]\n"
                 "\t[--tension_file filename] [--speed_file filename]\n"
+                "\t[--sidecar_file filename [--sidecar_int16]]\n"
+                "\t[--tension_track sidecar_filename]\n"
                 "\t--input sound.wav --output fastsound.wav\n"
+                "\tor, for many files at once,\n"
+                "\t--batch manifest_or_directory --output_dir directory\n"
+                "\t[--threads count]\n"
                 "\t [set nonlinear to 0.0 to get a linear speedup.]\n";
 
   if (argc <= 1) {
@@ -259,6 +718,7 @@ int main(int argc, char** argv) {
       {
         /* These options set a flag. */
         {"match_nonlinear", no_argument, &match_nonlinear, 1},
+        {"sidecar_int16", no_argument, &sidecar_int16, 1},
         {"linear",        no_argument, NULL, 'l'},    /* Default is nonlinear */
         /* The remaining options have a value and don’t set a flag.
            We distinguish them by their values (last field). */
@@ -273,6 +733,11 @@ int main(int argc, char** argv) {
         {"spectrogram_file", optional_argument, NULL, 'S'},
         {"duration_feedback_strength", optional_argument, NULL, 'd'},
         {"normalized_spectrogram_file", optional_argument, NULL, 'N'},
+        {"sidecar_file",  optional_argument, NULL, 'c'},
+        {"tension_track", optional_argument, NULL, 'T'},
+        {"batch",         required_argument, NULL, 'b'},
+        {"output_dir",    required_argument, NULL, 'D'},
+        {"threads",       required_argument, NULL, 'j'},
         {0, 0, 0, 0}
       };
     /* getopt_long stores the option index here. */
@@ -406,12 +871,73 @@ int main(int argc, char** argv) {
         assert(normalized_spectrogram_fp);
         break;
 
+    case 'c':           /* Binary tension sidecar file name */
+        assert(optarg || argv[optind]);
+        if (optarg) {
+          sidecar_file_name = optarg;
+        } else {
+          sidecar_file_name = argv[optind];
+        }
+        break;
+
+    case 'T':           /* Play back the tension in this sidecar file */
+        assert(optarg || argv[optind]);
+        if (optarg) {
+          tension_track = speedySidecarOpen(optarg);
+        } else {
+          tension_track = speedySidecarOpen(argv[optind]);
+        }
+        if (!tension_track) {
+          fprintf(stderr, "%s: Can't read the tension track.\n", argv[0]);
+          exit(1);
+        }
+        break;
+
+    case 'b':           /* Manifest file or directory of files to compress */
+        batch_name = optarg;
+        break;
+
+    case 'D':           /* Directory for the batch output */
+        output_dir_name = optarg;
+        break;
+
+    case 'j':           /* Batch worker threads */
+        thread_count = atoi(optarg);
+        assert(thread_count >= 0);
+        break;
+
     default:
         fprintf(stderr, "%s: Unknown command line option (%d).\n", argv[0], c);
         fprintf(stderr, usage, argv[0]);
         exit(1);
     }
   }
+  if (!batch_name.empty()) {
+    if (output_dir_name.empty()) {
+      printf("%s: Must specify an output directory.\n", argv[0]);
+      exit(1);
+    }
+    if (tension_fp || speed_fp || features_fp || spectrogram_fp ||
+        normalized_spectrogram_fp || tension_track ||
+        !sidecar_file_name.empty() || desired_length > 0) {
+      printf("%s: Debug files, sidecars and --length work on single files "
+             "only.\n", argv[0]);
+      exit(1);
+    }
+    std::vector<std::string> files = list_batch_files(batch_name);
+    if (files.empty()) {
+      printf("%s: No files to compress in %s.\n", argv[0],
+             batch_name.c_str());
+      exit(1);
+    }
+    if (thread_count == 0) {
+      thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    thread_count = std::min<int>(thread_count, files.size());
+    int failures = compress_batch(files, output_dir_name, speed, nonlinear,
+                                  duration_feedback_strength, thread_count);
+    exit(failures ? 1 : 0);
+  }
   if (output_file_name.length() <= 0) {
     printf("%s: Must specify an output file name.\n", argv[0]);
     exit(1);
@@ -421,6 +947,10 @@ int main(int argc, char** argv) {
     exit(1);
   }
 
+  if (!sidecar_file_name.empty()) {
+    write_sidecar(input_file_name, sidecar_file_name, sidecar_int16);
+  }
+
   if (match_nonlinear) {
     // Figure out what speed we get with non-linear speedup.
     speed = compress_sound(input_file_name, speed, 1.0,
@@ -468,4 +998,5 @@ int main(int argc, char** argv) {
 
   compress_sound(input_file_name, speed, nonlinear,
                  duration_feedback_strength, output_file_name);
+  speedySidecarClose(tension_track);
 }